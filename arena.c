@@ -0,0 +1,181 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Bump allocator: see arena.h .  An Arena must be used by one thread
+  at a time.
+*/
+
+#include <stdlib.h>
+
+#include "arena.h"
+
+/**
+ | - ArenaAlign: the blocks are aligned as the most demanding of these
+ |   types;
+ | - ArenaChunk: a chunk of memory; "used" bytes of its "size" ones
+ |   have been handed out.  The chunks in use are linked from the most
+ |   recent one, "current"; the released ones are in the list "spare";
+ |   "held" is the size of all the chunks in use.
+**/
+
+typedef union uArenaAlign {
+  long    l;
+  double  d;
+  void   *p;
+} ArenaAlign;
+
+typedef struct sArenaChunk {
+  struct sArenaChunk *next;
+  size_t              size;
+  size_t              used;
+  ArenaAlign          data[1];
+} ArenaChunk;
+
+struct sArena {
+  size_t      chunkSize;
+  ArenaChunk *current;
+  ArenaChunk *spare;
+  size_t      held;
+  ArenaStats  stats;
+};
+
+Arena *arenaOpen(
+  size_t chunkSize
+){
+
+  /**
+   | Creates an empty arena, whose chunks will be of "chunkSize" bytes
+   | (ARENA_CHUNK if 0); returns 0 if out of memory.
+  **/
+
+  Arena *pA;
+
+  if ((pA = calloc(1, sizeof(Arena))) == 0) {
+    return 0;
+  }
+  pA->chunkSize = chunkSize > 0 ? chunkSize : ARENA_CHUNK;
+  return pA;
+}
+
+void *arenaAlloc(
+  Arena  *pA,
+  size_t  size
+){
+
+  /**
+   | Returns "size" bytes, suitably aligned for any object, or 0 if out
+   | of memory.  A new chunk is taken from the spare ones if the first
+   | of them is large enough, or obtained from malloc(3).
+  **/
+
+  ArenaChunk *pC = pA->current;
+  void       *p;
+
+  size = (size + sizeof(ArenaAlign) - 1) / sizeof(ArenaAlign)
+         * sizeof(ArenaAlign);
+
+  if (pC == 0 || pC->size - pC->used < size) {
+    if (pA->spare != 0 && pA->spare->size >= size) {
+      pC = pA->spare;
+      pA->spare = pC->next;
+      pA->stats.reused++;
+    } else {
+      size_t cSize = size > pA->chunkSize ? size : pA->chunkSize;
+
+      if ((pC = malloc(sizeof(ArenaChunk) + cSize)) == 0) {
+        return 0;
+      }
+      pC->size = cSize;
+      pA->stats.chunks++;
+    }
+    pC->used    = 0;
+    pC->next    = pA->current;
+    pA->current = pC;
+    pA->held   += pC->size;
+    if (pA->held > pA->stats.peak) {
+      pA->stats.peak = pA->held;
+    }
+  }
+
+  p         = (char *) pC->data + pC->used;
+  pC->used += size;
+
+  pA->stats.allocs++;
+  pA->stats.bytes += size;
+  return p;
+}
+
+ArenaMark arenaMark(
+  Arena *pA
+){
+
+  /**
+   | The current position of the arena.
+  **/
+
+  ArenaMark mark;
+
+  mark.chunk = pA->current;
+  mark.used  = pA->current != 0 ? pA->current->used : 0;
+  return mark;
+}
+
+void arenaRelease(
+  Arena     *pA,
+  ArenaMark  mark
+){
+
+  /**
+   | Releases all the blocks handed out after "mark" was taken: the
+   | chunks obtained since then are moved to the spare ones.
+  **/
+
+  while (pA->current != mark.chunk) {
+    ArenaChunk *pC = pA->current;
+
+    pA->current = pC->next;
+    pA->held   -= pC->size;
+    pC->next    = pA->spare;
+    pA->spare   = pC;
+  }
+  if (mark.chunk != 0) {
+    mark.chunk->used = mark.used;
+  }
+}
+
+void arenaStats(
+  const Arena *pA,
+  ArenaStats  *pS
+){
+  *pS = pA->stats;
+}
+
+void arenaClose(
+  Arena *pA
+){
+
+  /**
+   | Frees the arena and all of its memory.
+  **/
+
+  ArenaMark empty;
+
+  if (pA == 0) {
+    return;
+  }
+
+  empty.chunk = 0;
+  empty.used  = 0;
+  arenaRelease(pA, empty);
+
+  while (pA->spare != 0) {
+    ArenaChunk *pC = pA->spare;
+
+    pA->spare = pC->next;
+    free(pC);
+  }
+  free(pA);
+}
@@ -0,0 +1,65 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Bump allocator.  The memory of an Arena is obtained from malloc(3)
+  in large chunks, and handed out by advancing a pointer; it is never
+  freed piece by piece, but released back to a mark, all together: in
+  time proportional to the number of chunks.  The released chunks are
+  kept for reuse, so that an arena that is repeatedly filled and
+  released stops calling malloc(3) once it has grown to its working
+  size.
+*/
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - ARENA_CHUNK: default size of the chunks, in bytes (larger requests
+ |   get a chunk of their own);
+ | - ArenaMark: a point to which the arena may be released, as
+ |   returned by arenaMark(); an arena is created empty, and releasing
+ |   it to a mark taken when empty releases all of its memory;
+ | - ArenaStats: counters, since the arena was created, of the blocks
+ |   allocated and of their total size; of the chunks obtained from
+ |   malloc(3) and of those reused instead; and the largest amount of
+ |   memory held at once.
+**/
+
+#define ARENA_CHUNK (64 * 1024)
+
+typedef struct sArena Arena;
+
+typedef struct sArenaMark {
+  struct sArenaChunk *chunk;
+  size_t              used;
+} ArenaMark;
+
+typedef struct sArenaStats {
+  unsigned long allocs;
+  unsigned long bytes;
+  unsigned long chunks;
+  unsigned long reused;
+  unsigned long peak;
+} ArenaStats;
+
+Arena     *arenaOpen(size_t);
+void      *arenaAlloc(Arena *, size_t);
+ArenaMark  arenaMark(Arena *);
+void       arenaRelease(Arena *, ArenaMark);
+void       arenaStats(const Arena *, ArenaStats *);
+void       arenaClose(Arena *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Compares two sets of benchmark results written by run.sh.
+#
+# Usage: compare.sh OLD.jsonl NEW.jsonl
+#
+# For every program, mode and cache state, prints the median wall time
+# of the runs in both files, and their ratio (new / old): a ratio above
+# 1 is a slowdown.  The runs are grouped whatever their version: every
+# file should hold the results of one version, on the same tree.
+
+if [ $# -ne 2 ]; then
+  sed -n '5s/^# //p' "$0" >&2
+  exit 1
+fi
+
+awk '
+  function field(line, name,    m) {
+    if (match(line, "\"" name "\":(\"[^\"]*\"|[0-9]+)") == 0) return ""
+    m = substr(line, RSTART + length(name) + 3, RLENGTH - length(name) - 3)
+    gsub(/"/, "", m)
+    return m
+  }
+
+  function median(key, set,    n, i, j, t, v) {
+    n = count[set, key]
+    for (i = 1;  i <= n;  i++) v[i] = wall[set, key, i]
+    for (i = 2;  i <= n;  i++) {
+      for (j = i;  j > 1  &&  v[j - 1] > v[j];  j--) {
+        t = v[j];  v[j] = v[j - 1];  v[j - 1] = t
+      }
+    }
+    return n % 2 ? v[(n + 1) / 2] : (v[n / 2] + v[n / 2 + 1]) / 2
+  }
+
+  FNR == 1 { set++ }
+
+  /^\{/ {
+    key = field($0, "engine") " " field($0, "mode") " " field($0, "cache")
+    if (!(key in seen)) { seen[key] = 1;  keys[++nKeys] = key }
+    wall[set, key, ++count[set, key]] = field($0, "wall_ns") + 0
+  }
+
+  END {
+    printf "%-20s %12s %12s %8s\n", "run", "old (ms)", "new (ms)", "ratio"
+    for (k = 1;  k <= nKeys;  k++) {
+      key = keys[k]
+      if (count[1, key] == 0 || count[2, key] == 0) continue
+      old = median(key, 1);  new = median(key, 2)
+      printf "%-20s %12.1f %12.1f %8.3f\n", key, old / 1e6, new / 1e6,
+             (old > 0 ? new / old : 0)
+    }
+  }
+' "$1" "$2"
@@ -0,0 +1,292 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Synthetic tree generator for the benchmarks: the command
+
+    mktree [-d depth] [-f fanout] [-n families] [-s stale%] [-o orphan%]
+           [-r readonly%] [-b backup%] [-x extra] [-z size] [-S seed] DIR
+
+  creates under DIR (that must not exist) a tree of directories "depth"
+  levels deep, each one with "fanout" subdirectories; every directory
+  holds "families" TeX file families and "extra" files that are not
+  relevant.  A family is a .tex source (missing in "orphan"% of them)
+  and a random set of the files derived from it, some with a multi-dot
+  extension (.synctex.gz, .toc.old); some sources have a multi-dot
+  base name too.  In "stale"% of the families the derived files are
+  newer than their source, and have to be removed; in the others the
+  source is newer.  "readonly"% of the derived files are read only,
+  "backup"% of the sources have an editor backup (.tex~).  The derived
+  files are given a random (sparse) size up to "size" bytes.
+
+  The same seed gives the same tree.  When done, a summary of what has
+  been created is written on the standard output, as a JSON object.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+ | - BASE_TIME: modification time of the .tex sources; the derived files
+ |   are one hour newer (stale) or older (fresh);
+ | - MAX_NAME: the size of the buffer for the file names (twice the
+ |   longest base name).
+**/
+
+#define BASE_TIME  1262304000L          /* 2010-01-01 00:00:00 UTC */
+#define SKEW       3600L
+#define MAX_NAME   64
+
+/**
+ | The derived files, with the probability (percent) of each of them
+ | in a family.
+**/
+
+typedef struct sDerived {
+  const char *ext;
+  int         percent;
+} Derived;
+
+static const Derived derived[] = {
+  {".aux",        100},
+  {".log",        100},
+  {".pdf",         80},
+  {".synctex.gz",  60},
+  {".out",         50},
+  {".toc",         40},
+  {".bbl",         30},
+  {".blg",         30},
+  {".bcf",         20},
+  {".toc.old",     10},
+  {".lof",         10},
+  {".lot",         10},
+  {".idx",          5},
+  {".ilg",          5},
+  {".ind",          5},
+  {".dvi",          5},
+  {".nav",          5},
+  {".snm",          5}
+};
+
+#define N_DERIVED (sizeof(derived) / sizeof(derived[0]))
+
+/**
+ | - the parameters given on the command line;
+ | - "seed", the state of the random generator, and its initial value;
+ | - the counters written in the summary.
+**/
+
+static int           depth      = 3;
+static int           fanout     = 8;
+static int           families   = 20;
+static int           stalePct   = 70;
+static int           orphanPct  = 5;
+static int           roPct      = 5;
+static int           backupPct  = 10;
+static int           extra      = 5;
+static long          maxSize    = 0;
+static unsigned long seed       = 1;
+static unsigned long firstSeed;
+static char         *programName;
+
+static unsigned long nDirs, nFiles, nStale, nFresh, nOrphans, nReadOnly,
+                     nBackups, nBytes;
+
+static void   fill(int, int);
+static void   makeFile(int, const char *, time_t, mode_t, long);
+static long   rnd(long);
+static void   syntax(void);
+
+int main(
+  int   argc,
+  char *argv[]
+){
+  int c, dirFd;
+
+  programName = argv[0];
+
+  while ((c = getopt(argc, argv, "d:f:n:s:o:r:b:x:z:S:h")) != -1) {
+    switch (c) {
+      case 'd': depth     = atoi(optarg);                break;
+      case 'f': fanout    = atoi(optarg);                break;
+      case 'n': families  = atoi(optarg);                break;
+      case 's': stalePct  = atoi(optarg);                break;
+      case 'o': orphanPct = atoi(optarg);                break;
+      case 'r': roPct     = atoi(optarg);                break;
+      case 'b': backupPct = atoi(optarg);                break;
+      case 'x': extra     = atoi(optarg);                break;
+      case 'z': maxSize   = atol(optarg);                break;
+      case 'S': seed      = strtoul(optarg, 0, 10);      break;
+      default:  syntax();
+    }
+  }
+  if (optind != argc - 1 || depth < 0 || fanout < 0 || families < 0 ||
+      extra < 0 || maxSize < 0) {
+    syntax();
+  }
+
+  if (mkdir(argv[optind], 0755) != 0 ||
+      (dirFd = open(argv[optind], O_RDONLY | O_DIRECTORY)) < 0) {
+    fprintf(stderr, "%s: cannot create \"%s\": %s\n", programName,
+            argv[optind], strerror(errno));
+    return EXIT_FAILURE;
+  }
+  firstSeed = seed;
+  fill(dirFd, depth);
+
+  printf("{\"depth\":%d,\"fanout\":%d,\"families\":%d,\"seed\":%lu,"
+         "\"dirs\":%lu,\"files\":%lu,\"stale\":%lu,\"fresh\":%lu,"
+         "\"orphans\":%lu,\"read_only\":%lu,\"backups\":%lu,"
+         "\"bytes\":%lu}\n", depth, fanout, families, firstSeed, nDirs, nFiles,
+         nStale, nFresh, nOrphans, nReadOnly, nBackups, nBytes);
+  return EXIT_SUCCESS;
+}
+
+static void fill(
+  int dirFd,
+  int levels
+){
+
+  /**
+   | Fills the directory "dirFd" (and closes it), then creates and
+   | fills its subdirectories if "levels" are left.  The counters of
+   | the stale, fresh and orphan files count the derived files.
+  **/
+
+  char name[MAX_NAME];
+  int  i, j;
+
+  nDirs++;
+
+  for (i = 0;   i < families;   i++) {
+    char   base[MAX_NAME / 2];
+    int    orphan = rnd(100) < orphanPct;
+    int    stale  = rnd(100) < stalePct;
+    time_t when   = BASE_TIME + (stale ? SKEW : -SKEW);
+
+    if (rnd(5) == 0) {
+      sprintf(base, "chap%d.part%ld", i, rnd(10));
+    } else {
+      sprintf(base, "doc%d", i);
+    }
+
+    if (! orphan) {
+      sprintf(name, "%s.tex", base);
+      makeFile(dirFd, name, BASE_TIME, 0644, 0);
+      if (rnd(100) < backupPct) {
+        sprintf(name, "%s.tex~", base);
+        makeFile(dirFd, name, BASE_TIME, 0644, 0);
+        nBackups++;
+      }
+    }
+
+    for (j = 0;   j < (int) N_DERIVED;   j++) {
+      mode_t mode = 0644;
+
+      if (rnd(100) >= derived[j].percent) {
+        continue;
+      }
+      if (rnd(100) < roPct) {
+        mode = 0444;
+        nReadOnly++;
+      }
+      sprintf(name, "%s%s", base, derived[j].ext);
+      makeFile(dirFd, name, when, mode,
+               (rnd(32768) * 65536L + rnd(65536)) % (maxSize + 1));
+
+      if (orphan) {
+        nOrphans++;
+      } else if (stale) {
+        nStale++;
+      } else {
+        nFresh++;
+      }
+    }
+  }
+
+  for (i = 0;   i < extra;   i++) {
+    sprintf(name, i % 2 == 0 ? "fig%d.png" : "notes%d.txt", i);
+    makeFile(dirFd, name, BASE_TIME, 0644, 0);
+  }
+
+  if (levels > 0) {
+    for (i = 0;   i < fanout;   i++) {
+      int subFd;
+
+      sprintf(name, "d%d", i);
+      if (mkdirat(dirFd, name, 0755) != 0 ||
+          (subFd = openat(dirFd, name, O_RDONLY | O_DIRECTORY)) < 0) {
+        fprintf(stderr, "%s: cannot create directory \"%s\": %s\n",
+                programName, name, strerror(errno));
+        exit(EXIT_FAILURE);
+      }
+      fill(subFd, levels - 1);
+    }
+  }
+  close(dirFd);
+}
+
+static void makeFile(
+  int         dirFd,
+  const char *name,
+  time_t      when,
+  mode_t      mode,
+  long        size
+){
+
+  /**
+   | Creates the file "name" in "dirFd", "size" bytes long, with
+   | permissions "mode" and modification time "when".
+  **/
+
+  struct timespec times[2];
+  int             fd;
+
+  times[0].tv_sec  = times[1].tv_sec  = when;
+  times[0].tv_nsec = times[1].tv_nsec = 0;
+
+  if ((fd = openat(dirFd, name, O_WRONLY | O_CREAT | O_EXCL, mode)) < 0 ||
+      (size > 0 && ftruncate(fd, size) != 0) ||
+      futimens(fd, times) != 0) {
+    fprintf(stderr, "%s: cannot create \"%s\": %s\n", programName, name,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+  nFiles++;
+  nBytes += size;
+}
+
+static long rnd(
+  long n
+){
+
+  /**
+   | Returns a pseudo-random number from 0 to n-1, the same on every
+   | system for the same seed (a 32 bit linear congruential generator,
+   | as in the C standard).
+  **/
+
+  seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+  return (long) ((seed >> 16) % (unsigned long) n);
+}
+
+static void syntax(void)
+{
+  fprintf(stderr,
+    "Usage: %s [-d depth] [-f fanout] [-n families] [-s stale%%]\n"
+    "          [-o orphan%%] [-r readonly%%] [-b backup%%] [-x extra]\n"
+    "          [-z size] [-S seed] DIR\n", programName);
+  exit(EXIT_FAILURE);
+}
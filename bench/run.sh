@@ -0,0 +1,132 @@
+#!/bin/sh
+#
+# End-to-end benchmark of the two versions of lintex: the C one
+# (../lintex) and the C++ one (../cxx/ltx), or those named by the
+# environment variables LINTEX and LTX.
+#
+# Usage: run.sh [-d depth] [-f fanout] [-n families] [-z size]
+#               [-k repeats] [-w workdir] [-- mktree options]
+#
+# A tree is built once by mktree (see mktree.c) in the work directory;
+# then every program is timed, "repeats" times, in pretend mode (on
+# the tree itself, that is not touched) and in real mode (on a fresh
+# copy of the tree, made before the clock starts), with cold caches
+# (all the page, dentry and inode caches are dropped before the run:
+# this needs root, otherwise the cold runs are skipped) and with warm
+# ones (after a run in pretend mode).  The C++ version has no pretend
+# mode, and is timed in real mode only.
+#
+# The results are written on the standard output, one JSON object per
+# run (NDJSON): the version of the sources, the date, the host, the
+# program, the mode, the caches, the repeat, the tree (the summary of
+# mktree), the wall time in nanoseconds, the exit status, and the
+# statistics of the program itself (--stats=json).  They are meant to
+# be appended to a file, to track the regressions between releases
+# (see compare.sh).  The progress is reported on the standard error.
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+LINTEX=${LINTEX:-$here/../lintex}
+LTX=${LTX:-$here/../cxx/ltx}
+MKTREE=${MKTREE:-$here/mktree}
+
+depth=3
+fanout=8
+families=20
+size=4096
+repeats=3
+work=${TMPDIR:-/tmp}/lintex-bench.$$
+
+while getopts d:f:n:z:k:w: opt; do
+  case $opt in
+    d) depth=$OPTARG ;;
+    f) fanout=$OPTARG ;;
+    n) families=$OPTARG ;;
+    z) size=$OPTARG ;;
+    k) repeats=$OPTARG ;;
+    w) work=$OPTARG ;;
+    *) sed -n '7,8s/^# //p' "$0" >&2; exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+for prog in "$LINTEX" "$LTX" "$MKTREE"; do
+  if [ ! -x "$prog" ]; then
+    echo "$0: $prog not found (make bench builds it)" >&2
+    exit 1
+  fi
+done
+
+mkdir -p "$work"
+trap 'chmod -R u+w "$work" 2>/dev/null; rm -rf "$work"' EXIT INT TERM
+
+version=$(git -C "$here" describe --always --dirty 2>/dev/null || echo unknown)
+host=$(uname -n)
+date=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+
+echo "Building the tree..." >&2
+tree=$("$MKTREE" -d "$depth" -f "$fanout" -n "$families" -z "$size" "$@" \
+       "$work/master")
+echo "  $tree" >&2
+
+# Drops the caches, if allowed to.
+
+cold=yes
+if ! (sync && echo 3 > /proc/sys/vm/drop_caches) 2>/dev/null; then
+  echo "Cannot drop the caches (not root?): no cold runs" >&2
+  cold=no
+fi
+
+# run ENGINE PROGRAM MODE CACHE REPEAT: one timed run, and its record.
+
+run() {
+  engine=$1 prog=$2 mode=$3 cache=$4 rep=$5
+
+  if [ "$mode" = real ]; then
+    rm -rf "$work/scratch"
+    cp -a "$work/master" "$work/scratch"
+    dir=$work/scratch
+  else
+    dir=$work/master
+  fi
+  opts=-r
+  [ "$engine" = c ] && [ "$mode" = pretend ] && opts="-r -p"
+
+  if [ "$cache" = cold ]; then
+    sync
+    echo 3 > /proc/sys/vm/drop_caches
+  else
+    "$LINTEX" -r -p "$dir" > /dev/null 2>&1 || :
+  fi
+
+  start=$(date +%s%N)
+  status=0
+  "$prog" $opts --stats=json "$dir" > /dev/null 2> "$work/stderr" ||
+    status=$?
+  end=$(date +%s%N)
+
+  stats=$(grep '^{' "$work/stderr" | tail -n 1)
+  printf '{"version":"%s","date":"%s","host":"%s","engine":"%s",' \
+         "$version" "$date" "$host" "$engine"
+  printf '"mode":"%s","cache":"%s","repeat":%d,"tree":%s,' \
+         "$mode" "$cache" "$rep" "$tree"
+  printf '"wall_ns":%d,"exit":%d,"stats":%s}\n' \
+         $((end - start)) "$status" "${stats:-null}"
+  echo "  $engine $mode $cache #$rep: $(( (end - start) / 1000000 )) ms" >&2
+}
+
+for engine in c cxx; do
+  if [ "$engine" = c ]; then prog=$LINTEX; else prog=$LTX; fi
+  for mode in pretend real; do
+    [ "$engine" = cxx ] && [ "$mode" = pretend ] && continue
+    for cache in cold warm; do
+      [ "$cache" = cold ] && [ "$cold" = no ] && continue
+      rep=1
+      while [ "$rep" -le "$repeats" ]; do
+        run "$engine" "$prog" "$mode" "$cache" "$rep"
+        rep=$((rep + 1))
+      done
+    done
+  done
+done
@@ -12,18 +12,32 @@
 // -------------------------------------------------------------------
 
 #include <algorithm>
+#include <list>
 #include <iterator>
+#include <sstream>
 #include <vector>
+#include <cstdlib>
 #include <cstring>
-#include "ltx.hh"               // Includes: functional, iostream, string
-#include "cleandir.hh"          // Includes: string
+#include "ltx.hh"               // Includes: functional, iostream, string,
+                                //           sink.h, stats.h
+#include "cleandir.hh"          // Includes: cstddef, string
 #include "cleanup.hh"           // Includes: string
-#include "file.hh"              // Includes: list, map, string, utility, ctime
+#include "file.hh"              // Includes: cstddef, string, vector, ctime,
+                                //           sys/types.h, spill.h
+#include "pool.hh"              // Includes: deque, vector, pthread.h
+#include "../dents.h"           // Includes: stddef.h
+#include "../mstat.h"           // Includes: time.h, sys/types.h
+#include "../prune.h"
+#include "../rules.h"           // Includes: stddef.h
+#include "../sufx.h"            // Includes: stddef.h, stdint.h, dents.h
+#include "../visited.h"         // Includes: sys/types.h
 
 extern "C" {
   #include <dirent.h>
-  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
   #include <sys/types.h>
+  #include <sys/stat.h>
 }
 
 using std::cerr;
@@ -34,28 +48,104 @@ using std::string;
 // Local variables
 
 namespace {
-  // In "re" are defined the extensions of the files relevant for
-  // LaTeX; ".tex" is missing, being handled separately.  THIS ARRAY
-  // MUST BE SORTED IN ASCENDING ORDER.
-
-  const char * re[] = {
-    ".aux", ".dvi", ".idx", ".ilg", ".ind",
-    ".lof", ".log", ".lot", ".pdf", ".ps",
-    ".toc"
+  // The extensions of the files relevant for LaTeX ("texExtensions",
+  // see file.hh) are compiled, together with ".tex" and the trailing
+  // string of the backup files, in the rule set "texRules" (see
+  // rules.h) before the first scan; the identifier of an extension is
+  // its index in "texExtensions", or "texId".
+
+  const char tex[] = ".tex";
+  const int  texId(-2);
+
+  Rules * texRules = 0;
+
+  // The subdirectories never visited with "-r": by name (the defaults
+  // and those given with "--prune"), or holding a marker file; see
+  // prune.h.  Compiled with "texRules".
+
+  const char * pruneNames[]   = { ".git", ".hg", ".svn", "node_modules" };
+  const char * pruneMarkers[] = { "CACHEDIR.TAG", ".lintexignore" };
+
+  Prune * dirPrune = 0;
+
+  // The directories already scanned, shared by all the threads: a
+  // directory reached again (through a symbolic link, a bind mount or
+  // another target) is skipped.
+
+  Visited * visited = 0;
+
+  // The device of the directory being cleaned, with "--one-file-system",
+  // and the type of its file system, with "--fs-policy"
+
+  dev_t         rootDev  = 0;
+  unsigned long rootType = 0;
+
+  // A subdirectory to be scanned, and the type of its file system (0 if
+  // not known, or without "--fs-policy")
+
+  struct subDir {
+    string        name;
+    unsigned long fsType;
   };
-  const size_t nRE = sizeof(re) / sizeof(re[0]);
-  std::vector<string> texExts(re, re + nRE);
 
-  const string tex(".tex");
-  const string dot(".");
+  // Number of directory entries classified together
+
+  const size_t batchSize(256);
+
+  // What a directory entry has been found to be, by its name alone
+
+  enum fileKind { kNone, kBackup, kTex, kRelevant };
+
+  // An entry whose metadata are needed, put aside while the directory
+  // is read: its name has been copied at "nameOff" in a buffer shared
+  // by all of them, "where" is the position of the extension and "id"
+  // its identifier.
 
-  const size_t filename_max = 256;
+  struct pendingFile {
+    size_t   nameOff;
+    size_t   where;
+    int      id;
+    fileKind kind;
+  };
+
+  // What a thread needs to scan directories: the metadata backend, the
+  // directory reader and the statistics (if required: the global ones
+  // for the sequential traversal, that uses one of them; otherwise its
+  // own, added to the global ones when closed); with "--max-memory",
+  // where the files of a directory are spilled, and the share of the
+  // budget that the thread may use.
+
+  struct scanner {
+    Mstat * pM;
+    Dents * pD;
+    Stats * pS;
+    Spill * pX;
+    size_t  budget;
+  };
+
+  scanner seqScanner = { 0, 0, 0, 0, 0 };
 }
 
 // Local functions (declarations)
 
 namespace {
-  void check_file(const string &, const time_t, currDir &);
+  bool     below(int);
+  fileKind classify(const DentsEntry &, const SufxInfo &, size_t &, int &);
+  void     compile_rules();
+  bool     cross_mount(int, const string &, dev_t, subDir &);
+  unsigned long limit(unsigned long);
+  void     add_file(const char *, const pendingFile &, const MstatReq &,
+                    currDir &);
+  void     scan_one(const string &, unsigned long, const scanner &, Sink *,
+                    std::ostream &, std::list<subDir> &);
+  void     settle(const string &, int, const struct stat &, bool,
+                  unsigned long, const scanner &, Sink *, std::ostream &,
+                  std::list<subDir> &, std::vector<pendingFile> &,
+                  std::vector<MstatReq> &, std::vector<char> &, currDir &);
+  void     scan_seq(const subDir &, int);
+  void     scan_tree(const string &);
+  scanner  open_scanner(bool, unsigned);
+  void     close_scanner(scanner &);
 }
 
 // Code
@@ -63,168 +153,632 @@ namespace {
 void scan_dir(
   const string & name
 ) {
-  // Scans the directory "name", building the related instantiation of
-  // the class "currDir" containing all the informations for the
-  // relevant files; then calls "clean_dir" to perform the actual
-  // cleanup.  If the "-r" options has been specified, recurses over
-  // all the directories under the current one.
+  // Cleans the directory "name"; if the "-r" options has been
+  // specified, recurses over all the directories under the current
+  // one: sequentially, or on a pool of "ltx::jobs" threads.  While
+  // watching (see ltx.cxx), every directory is cleaned on its own.
+
+  if (texRules == 0) compile_rules();
+  if (visited == 0  &&  (visited = visitedOpen()) == 0) {
+    cerr << ltx::progname << ": couldn't obtain heap memory\n";
+    std::exit(1);
+  }
 
-#if defined(DEBUG)
-  static bool firstTime(true);
-
-  if (firstTime) {
-    cout << "--------------------Relevant extensions ("
-         << nRE << ")\n";
-    copy(texExts.begin(), texExts.end(),
-         std::ostream_iterator<string>(cout, " "));
-    cout << std::endl;
-    firstTime = false;
+  bool        recurse = ltx::recurse  &&  ! ltx::watching;
+  struct stat st;
+
+  rootDev  = stat(name.c_str(), &st) == 0 ? st.st_dev : 0;
+  rootType = ltx::fsPolicy != 0 ? fsTypeAt(AT_FDCWD, name.c_str()) : 0;
+
+  if (recurse  &&  ltx::jobs > 1) {
+    scan_tree(name);
+    return;
   }
 
-  cout << "--------------------scan_dir called for \""
-       << name << "\"\n";
-#endif // DEBUG
+  if (seqScanner.pM == 0) seqScanner = open_scanner(false, 1);
 
-  DIR * pDir;
+  subDir root = { name, rootType };
 
-  if ((pDir = opendir( name.c_str() )) != 0) {
+  scan_seq(root, 0);
+}
 
-    string fullName(name);
-    if (*(fullName.rbegin()) != '/') fullName.append("/");
+bool relevant_name(
+  const char * name,
+  size_t       len
+) {
+  // Tells whether a change to the file "name" (of length "len") may
+  // need a cleanup: i.e., if it has a relevant extension (".tex"
+  // included) or is a backup file.
 
-    currDir             thisDir(fullName);
-    std::list<string>   subDirs;
-    struct dirent     * pDe;
+  if (texRules == 0) compile_rules();
 
-    // Reads every file: skips null inodes (already deleted
-    // files), and the two special files "." and ".." .
+  RulesMatch match;
 
-    while ((pDe = readdir(pDir)) != 0) {
-      if (pDe->d_ino == 0) continue;
+  rulesMatch(texRules, name, len, &match);
+  return match.id != -1  ||  (match.backup != 0  &&  len > match.backup);
+}
+
+namespace {
+  void compile_rules()
+  {
+    // Compiles the rules used by "classify", and the prune rules:
+    // called before any thread is started, they are only read
+    // afterwards.
+
+    bool ok = (texRules = rulesNew()) != 0  &&
+              rulesAdd(texRules, tex, RULE_REMOVE, texId) >= 0  &&
+              (dirPrune = pruneNew()) != 0;
+
+    for (size_t i = 0;  ok  &&  i < sizeof(pruneNames) / sizeof(char *);
+         i++) {
+      ok = pruneAdd(dirPrune, pruneNames[i], PRUNE_NAME) == 0;
+    }
+    for (size_t i = 0;  ok  &&  i < sizeof(pruneMarkers) / sizeof(char *);
+         i++) {
+      ok = pruneAdd(dirPrune, pruneMarkers[i], PRUNE_MARKER) == 0;
+    }
+    std::list<string>::const_iterator iter;
+    for (iter = ltx::prunes.begin();  ok  &&  iter != ltx::prunes.end();
+         iter++) {
+      ok = pruneAdd(dirPrune, iter->c_str(), PRUNE_NAME) == 0;
+    }
+
+    for (size_t i = 0;  ok  &&  i < nTexExtensions;  i++) {
+      ok = rulesAdd(texRules, texExtensions[i], RULE_REMOVE, i) >= 0;
+    }
+    if (ok  &&  ltx::lTrailEd > 0) {
+      ok = rulesAdd(texRules, ltx::trailEd.c_str(), RULE_BACKUP, 0) >= 0;
+    }
+
+    if (! ok  ||  rulesCompile(texRules) != 0  ||
+        pruneCompile(dirPrune) != 0) {
+      cerr << ltx::progname << ": couldn't obtain heap memory\n";
+      std::exit(1);
+    }
+  }
+
+  scanner open_scanner(
+    bool     own,
+    unsigned shares
+  ) {
+    // Opens the metadata backend required on the command line (the
+    // synchronous one, if io_uring is not available; or, with
+    // "--stat-threads", a pool of threads), and a directory reader
+    // with a buffer of the required size; if statistics are required,
+    // uses the global ones or (if "own") new ones.  With "--max-memory",
+    // the files of a directory may be spilled too: the budget is shared
+    // by the "shares" scanners working at once, and half of a share
+    // goes to the files held, half to those being spilled.
+
+    scanner sc;
+
+    sc.budget = ltx::maxMemory / shares / 2;
+    if (ltx::maxMemory > 0  &&  sc.budget < SPILL_MIN) sc.budget = SPILL_MIN;
+
+    if (ltx::ioUring) {
+      sc.pM = mstatOpen(MSTAT_URING);
+    } else {
+      sc.pM = mstatOpen(ltx::statThreads > 1 ? MSTAT_POOL : MSTAT_SYNC);
+      if (sc.pM != 0) mstatThreads(sc.pM, ltx::statThreads);
+    }
+    sc.pD = dentsOpen(ltx::dirBuffer);
+    sc.pS = (own  &&  ltx::stats != 0) ? statsOpen() : ltx::stats;
+    sc.pX = sc.budget > 0 ? spillOpen(sc.budget) : 0;
+
+    if (sc.pM == 0  ||  sc.pD == 0  ||  (ltx::stats != 0  &&  sc.pS == 0)  ||
+        (sc.budget > 0  &&  sc.pX == 0)) {
+      cerr << ltx::progname << ": couldn't obtain heap memory\n";
+      std::exit(1);
+    }
+    mstatStats(sc.pM, sc.pS);
+    return sc;
+  }
+
+  void close_scanner(
+    scanner & sc
+  ) {
+    mstatClose(sc.pM);
+    dentsClose(sc.pD);
+    spillClose(sc.pX);
+    if (sc.pS != ltx::stats) {
+      statsMerge(ltx::stats, sc.pS);
+      statsClose(sc.pS);
+    }
+  }
+
+  bool below(
+    int depth
+  ) {
+    // Tells whether the subdirectories of a directory "depth" levels
+    // below the one given are to be scanned ("--max-depth").
+
+    return ltx::maxDepth < 0  ||  depth < ltx::maxDepth;
+  }
+
+  unsigned long limit(
+    unsigned long fsType
+  ) {
+    // How many metadata requests may be in flight on a file system of
+    // type "fsType" (0: no limit), as required by "--fs-policy"
+
+    int level = ltx::fsPolicy != 0 ? fsPolicyOf(ltx::fsPolicy, fsType)
+                                   : FS_ALLOW;
+
+    return level > 0 ? level : 0;
+  }
+
+  void scan_seq(
+    const subDir & dir,
+    int            depth
+  ) {
+    // Sequential traversal: the directory "dir", "depth" levels below
+    // the one given, and then its subdirectories.
+
+    std::list<subDir> subDirs;
+
+    mstatLimit(seqScanner.pM, limit(dir.fsType));
+    scan_one(dir.name, dir.fsType, seqScanner, ltx::output, cerr, subDirs);
+
+    if (ltx::recurse  &&  ! ltx::watching  &&  below(depth)) {
+      std::list<subDir>::const_iterator iter;
+
+      for (iter = subDirs.begin();  iter != subDirs.end();  iter++) {
+        scan_seq(*iter, depth + 1);
+      }
+    }
+  }
+
+  // Parallel traversal: every directory is a task on a work-stealing
+  // pool.  The output of each task is kept in a "dirResult" node (the
+  // messages about the files in a memory sink), and the nodes are
+  // linked in the same order in which the sequential traversal would
+  // visit the directories; when the pool is done, the tree of results
+  // is printed depth-first, so that the output does not depend on the
+  // thread scheduling.  Every worker has its own
+  // metadata backend, directory reader and statistics.  The number of
+  // workers scanning the file systems of a given type at once may be
+  // limited ("--fs-policy").
+
+  struct dirResult {
+    Sink                   * out;
+    string                   err;
+    std::vector<dirResult *> children;
+  };
+
+  class scanTask : public poolTask {
+  private:
+    subDir                        _dir;
+    int                           _depth;
+    dirResult                   * _result;
+    const std::vector<scanner>  & _scanners;
+
+  public:
+    scanTask(const subDir & dir, int depth, dirResult * result,
+             const std::vector<scanner> & scanners)
+      : _dir(dir), _depth(depth), _result(result), _scanners(scanners) {}
+
+    void run(workPool & pool, unsigned me) {
+      std::ostringstream err;
+      std::list<subDir>  subDirs;
+
+      if ((_result->out = sinkOpen(0, ltx::format)) == 0) {
+        cerr << ltx::progname << ": couldn't obtain heap memory\n";
+        std::exit(1);
+      }
+      if (ltx::fsPolicy != 0) fsPolicyEnter(ltx::fsPolicy, _dir.fsType);
+      mstatLimit(_scanners[me].pM, limit(_dir.fsType));
+      scan_one(_dir.name, _dir.fsType, _scanners[me], _result->out, err,
+               subDirs);
+      if (ltx::fsPolicy != 0) fsPolicyLeave(ltx::fsPolicy, _dir.fsType);
+      _result->err = err.str();
+      if (! below(_depth)) subDirs.clear();
+
+      // All the children are linked before any of them is queued:
+      // after that, this node is never touched again by a worker.
+
+      std::list<subDir>::const_iterator iter;
+
+      _result->children.reserve(subDirs.size());
+      for (iter = subDirs.begin();  iter != subDirs.end();  iter++) {
+        _result->children.push_back(new dirResult);
+      }
+
+      size_t i = 0;
+      for (iter = subDirs.begin();  iter != subDirs.end();  iter++, i++) {
+        pool.push(new scanTask(*iter, _depth + 1, _result->children[i],
+                               _scanners), me);
+      }
+    }
+  };
+
+  void emit(
+    dirResult * pDR
+  ) {
+    sinkAppend(ltx::output, pDR->out);
+    sinkClose(pDR->out);
+    cerr << pDR->err;
+    for (size_t i = 0;  i < pDR->children.size();  i++) {
+      emit(pDR->children[i]);
+    }
+    delete pDR;
+  }
+
+  void scan_tree(
+    const string & name
+  ) {
+    workPool             pool(ltx::jobs);
+    dirResult          * root = new dirResult;
+    std::vector<scanner> scanners;
+
+    for (unsigned i = 0;  i < pool.size();  i++) {
+      scanners.push_back(open_scanner(true, pool.size()));
+    }
+
+    subDir dir = { name, rootType };
+
+    pool.push(new scanTask(dir, 0, root, scanners), 0);
+    pool.run();
+    emit(root);
+
+    for_each(scanners.begin(), scanners.end(), std::ptr_fun(close_scanner));
+  }
+
+  void scan_one(
+    const string      & name,
+    unsigned long       fsType,
+    const scanner     & sc,
+    Sink              * out,
+    std::ostream      & err,
+    std::list<subDir> & subDirs
+  ) {
+    // Scans the directory "name", building the related instantiation
+    // of the class "currDir" containing all the informations for the
+    // relevant files; then calls "clean_files" to perform the actual
+    // cleanup.  Messages are written on "out" and "err"; if the "-r"
+    // option has been specified, the names of the subdirectories are
+    // appended to "subDirs", unless pruned.  Those that are mount points
+    // may be skipped too ("--one-file-system", "--fs-policy"); the
+    // others are on a file system of type "fsType", unless mount points.
+    //
+    // The directory is read in bulk by the reader of "sc", and the
+    // entries are classified by name (a batch at a time, see sufx.h)
+    // and type straight from the reader buffer, without copying them;
+    // those whose metadata are needed are put aside, and the metadata
+    // are asked to the backend of "sc" in a single batch when the whole
+    // directory has been read (or, with "--max-memory", as soon as they
+    // would take more than that).
+    //
+    // A directory already scanned is skipped, unless watching (every
+    // directory is then scanned again when it changes).
 
 #if defined(DEBUG)
-      cout << "Next file: " << pDe->d_name << " - ";
+    static bool firstTime(true);
+
+    if (firstTime) {
+      cout << "--------------------Relevant extensions ("
+           << nTexExtensions << ")\n";
+      copy(texExtensions, texExtensions + nTexExtensions,
+           std::ostream_iterator<const char *>(cout, " "));
+      cout << std::endl;
+      firstTime = false;
+    }
+
+    cout << "--------------------scan_dir called for \""
+         << name << "\"\n";
 #endif // DEBUG
 
-      if (strcmp(pDe->d_name, ".")  == 0) {
+    int         dirFd;
+    struct stat dirSt;
+    bool        guarded = false;
+
+    int phase = statsEnter(sc.pS, STATS_SCAN);
+
+    if ((dirFd = open(name.c_str(), O_RDONLY | O_DIRECTORY)) >= 0  &&
+        ! ltx::watching  &&  fstat(dirFd, &dirSt) == 0) {
+      int isNew = visitedAdd(visited, dirSt.st_dev, dirSt.st_ino);
+
+      guarded = ltx::recurse  &&  (ltx::oneFs  ||  ltx::fsPolicy != 0);
+
+      if (isNew < 0) {
+        cerr << ltx::progname << ": couldn't obtain heap memory\n";
+        std::exit(1);
+      }
+      if (isNew == 0) {
 #if defined(DEBUG)
-        cout << "skipped\n";
+        cout << "already scanned\n";
 #endif // DEBUG
-        continue;
+        close(dirFd);
+        statsEnter(sc.pS, phase);
+        return;
       }
+    }
+
+    if (dirFd >= 0  &&  dentsStart(sc.pD, dirFd) == 0) {
+
+      statsAdd(sc.pS, STATS_DIRS, 1);
+
+      string fullName(name);
+      if (*(fullName.rbegin()) != '/') fullName.append("/");
+
+      currDir                  thisDir(fullName, sc.pX, sc.budget);
+      DentsEntry               batch[batchSize];
+      SufxInfo                 infos[batchSize];
+      std::vector<pendingFile> files;
+      std::vector<MstatReq>    reqs;
+      std::vector<char>        names;
+      long                     got;
+
+      // Reads every file: skips null inodes (already deleted
+      // files), and the two special files "." and ".." .
+
+      while ((got = dentsBatch(sc.pD, batch, batchSize)) > 0) {
+        statsAdd(sc.pS, STATS_ENTRIES, got);
+        statsEnter(sc.pS, STATS_CLASSIFY);
+        sufxClassify(batch, got, ltx::trailEd.data(), ltx::lTrailEd, infos);
+
+        for (long b = 0;  b < got;  b++) {
+          const DentsEntry & de = batch[b];
+
+          if (de.ino == 0) continue;
 
-      if (strcmp(pDe->d_name, "..") == 0) {
 #if defined(DEBUG)
-        cout << "skipped\n";
+          cout << "Next file: " << de.name << " - ";
 #endif // DEBUG
-        continue;
-      }
 
-      // Gets the file related informations with stat(2) (we need file
-      // type and modification time).  If the call to "stat" fails,
-      // the file is not considered.
+          if (strcmp(de.name, ".")  == 0) {
+#if defined(DEBUG)
+            cout << "skipped\n";
+#endif // DEBUG
+            continue;
+          }
 
-      char tName[filename_max];
-      std::strcpy(tName, fullName.c_str());
-      std::strcat(tName, pDe->d_name);
+          if (strcmp(de.name, "..") == 0) {
+#if defined(DEBUG)
+            cout << "skipped\n";
+#endif // DEBUG
+            continue;
+          }
 
-      struct stat sStat;
+          // Directories are told apart from the other files using the
+          // type in the directory entry; a file has to be stat'ed only
+          // when that type is unknown (or is a symbolic link, followed
+          // unless "--no-follow") and the answer matters, or when its
+          // modification time is needed; the subdirectories, when
+          // their device matters.  Backup files of known type are
+          // removed straight away.
 
-      if (stat(tName, &sStat) != 0) {
+          pendingFile pF;
+          MstatReq    req;
+          bool        unknown = (de.type == DT_UNKNOWN  ||
+                                 de.type == DT_LNK);
+
+          pF.kind = classify(de, infos[b], pF.where, pF.id);
+
+          req.op    = MSTAT_NONE;
+          req.isDir = (de.type == DT_DIR);
+
+          if (req.isDir) {
 #if defined(DEBUG)
-        cout << "got error from stat()\n";
-#else
-        cerr << ltx::progname << ": error calling stat("
-             << tName << ")\n";
+            cout << "is a directory\n";
 #endif // DEBUG
+            if (! ltx::recurse) continue;
+            if (guarded) req.op = MSTAT_STAT;
 
-      } else {
-        if (S_ISDIR(sStat.st_mode) != 0) {
+          } else if (pF.kind == kBackup  &&  ! unknown) {
 #if defined(DEBUG)
-          cout << "is a directory\n";
+            cout << "matches the default editor extension\n";
 #endif // DEBUG
+            SinkRecord rec;
 
-          // If needed, push the subdirectory names in the dedicated
-          // list, for future recursion; plain files are handled by
-          // the local procedure check_file().
+            sinkInit(&rec, 0, 0, SINK_REMOVED, SINK_BACKUP);
+            nuke(fullName, de.name, out, sc.pS, rec);
+            continue;
 
-          if (ltx::recurse) subDirs.push_back(tName);
+          } else if (pF.kind != kNone  ||  (unknown  &&  ltx::recurse)) {
+            req.op = (unknown  &&  ! ltx::follow) ? MSTAT_LSTAT : MSTAT_STAT;
 
-        } else {
-          check_file(pDe->d_name, sStat.st_mtime, thisDir);
+          } else {
+#if defined(DEBUG)
+            cout << "not relevant\n";
+#endif // DEBUG
+            continue;
+          }
+
+#if defined(DEBUG)
+          if (req.op != MSTAT_NONE) cout << "put aside\n";
+#endif // DEBUG
+
+          if (sc.budget > 0  &&  ! files.empty()  &&
+              files.size() * (sizeof(pendingFile) + sizeof(MstatReq)) +
+              names.size() > sc.budget) {
+            settle(fullName, dirFd, dirSt, guarded, fsType, sc, out, err,
+                   subDirs, files, reqs, names, thisDir);
+          }
+
+          pF.nameOff = names.size();
+          names.insert(names.end(), de.name, de.name + de.len + 1);
+          files.push_back(pF);
+          reqs.push_back(req);
         }
+        statsEnter(sc.pS, STATS_SCAN);
       }
+
+      if (got < 0) {
+        err << ltx::progname << ": error reading \"" << name << "\"\n";
+      }
+
+      settle(fullName, dirFd, dirSt, guarded, fsType, sc, out, err, subDirs,
+             files, reqs, names, thisDir);
+
+      // Looks if some cleanup has to be performed
+
+      statsEnter(sc.pS, STATS_EXAMINE);
+      clean_files(thisDir, out, sc.pS);
+
+      close(dirFd);
+    } else {
+      if (dirFd >= 0) close(dirFd);
+      err << ltx::progname << ": \"" << name
+          << "\" could not be opened (or is not a directory)\n";
     }
+    statsEnter(sc.pS, phase);
+  }
 
-    // Looks if some cleanup has to be performed
+  void settle(
+    const string             & fullName,
+    int                        dirFd,
+    const struct stat        & dirSt,
+    bool                       guarded,
+    unsigned long              fsType,
+    const scanner            & sc,
+    Sink                     * out,
+    std::ostream             & err,
+    std::list<subDir>        & subDirs,
+    std::vector<pendingFile> & files,
+    std::vector<MstatReq>    & reqs,
+    std::vector<char>        & names,
+    currDir                  & thisDir
+  ) {
+    // Gets the metadata of all the files put aside while scanning the
+    // directory "fullName", open as "dirFd" (see scan_one()), then
+    // forgets them; inserts them in order: the subdirectory names are
+    // pushed, if needed, in the dedicated list, for future recursion;
+    // plain files are handled by the local procedure add_file().  If
+    // the metadata can't be obtained, the file is not considered.
+
+    for (size_t i = 0;  i < files.size();  i++) {
+      reqs[i].name = &names[files[i].nameOff];
+    }
+    statsEnter(sc.pS, STATS_SCAN);
+    if (! reqs.empty()) mstatRun(sc.pM, dirFd, &reqs[0], reqs.size());
+    statsEnter(sc.pS, STATS_CLASSIFY);
 
-    clean_files(thisDir);
+    for (size_t i = 0;  i < files.size();  i++) {
+      const char * fName = reqs[i].name;
 
-    if (ltx::recurse) {
-      for_each(subDirs.begin(), subDirs.end(), std::ptr_fun(scan_dir));
+      if (reqs[i].op != MSTAT_NONE  &&  reqs[i].result < 0) {
+#if defined(DEBUG)
+        cout << fName << ": got error from stat()\n";
+        static_cast<void>(err);
+#else
+        err << ltx::progname << ": error calling stat("
+            << fullName << fName << ")\n";
+#endif // DEBUG
+
+      } else if (reqs[i].isDir) {
+        subDir sub = { fullName + fName, fsType };
+
+        // Whether the mount point is crossed is known first: looking
+        // for the markers goes through it.
+        if (ltx::recurse  &&
+            (! guarded  ||  reqs[i].dev == dirSt.st_dev  ||
+             cross_mount(dirFd, fName, reqs[i].dev, sub))  &&
+            pruneDir(dirPrune, dirFd, fName) == PRUNE_NONE) {
+          subDirs.push_back(sub);
+        }
+
+      } else if (files[i].kind == kBackup) {
+        SinkRecord rec;
+
+        sinkInit(&rec, 0, 0, SINK_REMOVED, SINK_BACKUP);
+        rec.size  = reqs[i].size;
+        rec.mTime = reqs[i].mTime;
+        nuke(fullName, fName, out, sc.pS, rec);
+
+      } else if (files[i].kind != kNone) {
+        add_file(fName, files[i], reqs[i], thisDir);
+      }
     }
 
-    closedir(pDir);
-  } else {
-    cerr << ltx::progname << ": \"" << name
-         << "\" could not be opened (or is not a directory)\n";
+    files.clear();
+    reqs.clear();
+    names.clear();
   }
-}
 
-namespace {
-  void check_file(
+  bool cross_mount(
+    int            dirFd,
     const string & name,
-    const time_t   mTime,
-    currDir      & CDir
+    dev_t          dev,
+    subDir       & sub
   ) {
-    // - If the file "name" matches the trailing string identifying
-    //   backup editor files, is removed;
-    // - if it matches a relevant extension, is inserted in the
-    //   "currDir" instance.
+    // The subdirectory "name" of the directory open as "dirFd" is a
+    // mount point, whose device is "dev": tells whether it has to be
+    // scanned, and sets the type of its file system in "sub".  It is
+    // not opened: its device comes from a statx made with
+    // AT_NO_AUTOMOUNT, and fsTypeAt() does not trigger one either.
 
-    string::size_type where;
+    if (ltx::oneFs  &&  dev != rootDev) {
+#if defined(DEBUG)
+      cout << name << ": on another file system\n";
+#endif // DEBUG
+      return false;
+    }
+    if (ltx::fsPolicy != 0) {
+      sub.fsType = fsTypeAt(dirFd, name.c_str());
+      if (fsPolicyOf(ltx::fsPolicy, sub.fsType) == FS_SKIP) {
+#if defined(DEBUG)
+        const char * type = fsTypeName(sub.fsType);
 
-    if (ltx::lTrailEd > 0) {
-      if ((where = name.rfind(ltx::trailEd)) != string::npos) {
-        if ((where + ltx::lTrailEd) == name.size()) {
-  #if defined(DEBUG)
-          cout << "matches the default editor extension\n";
-  #endif // DEBUG
-          nuke(CDir.getName(), name);
-          return;
-        }
+        cout << name << ": skipped (file system "
+             << (type != 0 ? type : "of unknown type") << ")\n";
+#endif // DEBUG
+        return false;
       }
     }
+    return true;
+  }
 
-    // Breaks the file name in "basename" and "extension"; and checks
-    // the latter against the known ones (".tex" files are handled
-    // separately).
+  fileKind classify(
+    const DentsEntry & de,
+    const SufxInfo   & si,
+    size_t           & where,
+    int              & id
+  ) {
+    // Tells if the file "de" matches the trailing string identifying
+    // backup editor files (to be removed); or has a relevant extension
+    // (".tex" files are handled separately), starting at "where" and
+    // identified by "id".  The names without any dot, that the suffix
+    // classifier "si" did not find to be backup files, can't match any
+    // rule.
 
-    if ((where = name.find_last_of(dot)) != string::npos) {
-      string       extension = name.substr(where);
-      string       basename  = name.substr(0, where);
-      fileFamily & fF        = CDir.getFileFamily(basename);
+    if (si.lastDot < 0  &&  ! si.backup) return kNone;
 
-      if (extension == tex) {
-        fF.addExtension(mTime, 0);
-  #if defined(DEBUG)
-        cout << "inserted\n";
-  #endif // DEBUG
+    RulesMatch match;
 
-      } else if (binary_search(texExts.begin(), texExts.end(), extension)) {
-        fF.addExtension(mTime, &extension);
-  #if defined(DEBUG)
-        cout << "extension " << extension << " - inserted\n";
-      } else {
-        cout << "extension not relevant\n";
-  #endif // DEBUG
+    rulesMatch(texRules, de.name, de.len, &match);
 
-      }
+    if (match.backup != 0) {
+      where = de.len - match.backup;
+      return kBackup;
+    }
+
+    if (match.id != -1) {
+      where = de.len - match.len;
+      id    = match.id;
+      return match.id == texId ? kTex : kRelevant;
+    }
+
+    return kNone;
+  }
+
+  void add_file(
+    const char        * name,
+    const pendingFile & pF,
+    const MstatReq    & req,
+    currDir           & CDir
+  ) {
+    // Breaks the file name in "basename" and "extension", and inserts
+    // the file, with the metadata in "req", in the "currDir" instance.
+
+    CDir.addFile(name, pF.where, req.mTime, req.size,
+                 pF.kind == kTex ? -1 : pF.id);
 
   #if defined(DEBUG)
+    if (pF.kind == kTex) {
+      cout << name << " - inserted\n";
     } else {
-      cout << "no extension\n";
-  #endif // DEBUG
+      cout << name << " - extension " << name + pF.where << " - inserted\n";
     }
+  #endif // DEBUG
   }
 }
@@ -14,8 +14,10 @@
 #ifndef CLEANDIR_H_
 #define CLEANDIR_H_
 
+#include <cstddef>
 #include <string>
 
 void scan_dir(const std::string &);
+bool relevant_name(const char *, size_t);
 
 #endif // CLEANDIR_H_
@@ -13,9 +13,19 @@
 
 #include <cstdio>
 #include <cctype>
-#include "ltx.hh"               // Includes: functional, iostream, string
-#include "file.hh"              // Includes: list, map, string, utility, ctime
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include "ltx.hh"               // Includes: functional, iostream, string,
+                                //           sink.h, stats.h
+#include "file.hh"              // Includes: cstddef, string, vector, ctime,
+                                //           sys/types.h, spill.h
 #include "cleanup.hh"           // Includes: string
+#include "../unlinkq.h"
+
+extern "C" {
+  #include <fcntl.h>
+}
 
 using std::cin;
 using std::cout;
@@ -23,36 +33,176 @@ using std::string;
 
 namespace {
   const int answerLength(64);
+
+  // The asynchronous deletion queue (if --async-unlink was given), and
+  // the current directory as known to it: the queued file names are
+  // relative to the latter.
+
+  UnlinkQ * unlinkQ = 0;
+  UqDir   * cwdDir  = 0;
+
+  void judge(const string &, const fileFamily &, Sink *, Stats *);
+  void report(void *, const char *, const char *, int, int);
 }
 
 void clean_files(
-  const currDir & dir
+  currDir & dir,
+  Sink    * out,
+  Stats   * pS
+) {
+  // Loops over all the file families stored in "dir", sorted by
+  // basename, and decides the fate of their files (see judge()): from
+  // memory, or as the spilled entries are merged.  Messages are
+  // written on "out", statistics kept in "pS".
+
+  if (dir.spilled()) {
+    fileFamily family;
+    long       n;
+
+    while ((n = dir.nextFamily(family)) > 0) {
+      judge(dir.getName(), family, out, pS);
+    }
+    if (n < 0) {
+      std::cerr << ltx::progname << ": cannot merge the files of "
+                << dir.getName() << ": " << std::strerror(errno) << '\n';
+    }
+    return;
+  }
+
+  std::vector<const fileFamily *> families;
+
+  dir.getFamilies(families);
+
+  for (size_t i = 0;  i < families.size();  i++) {
+    judge(dir.getName(), *families[i], out, pS);
+  }
+}
+
+void nuke(
+  const string & dirName,
+  const string & fileName,
+  Sink         * out,
+  Stats        * pS,
+  SinkRecord   & rec
+) {
+  // Removes the file "fileName" from the directory "dirName", that
+  // "rec" describes (its path is filled in here); the time spent is
+  // charged to the "delete" phase of "pS".  The removal is recorded
+  // on "out" only if it succeeds; otherwise the error goes to the
+  // standard error.  If the preprocessor symbol 'DEBUG' is defined,
+  // the file is not actually removed: but a message is written on
+  // "out", informing that the Finger Of Death has been raised to him.
+
+  string target = dirName + fileName;
+
+  rec.dir  = dirName.c_str();
+  rec.name = fileName.c_str();
+
+  int phase = statsEnter(pS, STATS_DELETE);
+
+#if defined(DEBUG)
+  rec.action = SINK_PRETEND;
+  sinkEvent(out, &rec, "FOD: %s\n", target.c_str());
+  statsEnter(pS, phase);
+#else
+  if (unlinkQ != 0) {
+    if (unlinkqPut(unlinkQ, cwdDir, target.c_str(), rec.reason) != 0) {
+      std::cerr << ltx::progname << ": couldn't obtain heap memory\n";
+      std::exit(1);
+    }
+    if (rec.size > 0) statsAdd(pS, STATS_BYTES, rec.size);
+    statsEnter(pS, phase);
+    return;
+  }
+
+  double start = pS != 0 ? statsClock() : 0.0;
+  int    err   = remove(target.c_str()) == 0 ? 0 : errno;
+
+  if (pS != 0) {
+    statsAdd(pS, STATS_UNLINKS, 1);
+    statsLatency(pS, STATS_UNLINK, statsClock() - start);
+  }
+  if (err != 0) {
+    std::cerr << ltx::progname << ": cannot remove " << target
+              << ": " << std::strerror(err) << '\n';
+  } else {
+    statsAdd(pS, STATS_REMOVED, 1);
+    if (rec.size > 0) statsAdd(pS, STATS_BYTES, rec.size);
+    sinkEvent(out, &rec, "%s has been removed.\n", target.c_str());
+  }
+  statsEnter(pS, phase);
+#endif // DEBUG
+}
+
+void start_unlink_queue(
+  unsigned nWorkers
 ) {
-  // Loops over all the file families stored in "dir", then loops over
-  // all the extensions in this file family; if a ".tex" file with a
-  // modification time former than the modification time of the target
-  // file exists, the file is removed.
+  // From now on, nuke() only queues the files: "nWorkers" threads will
+  // remove them, while the scan goes on.  The messages are printed on
+  // the standard output by this thread, in order, when further files
+  // are queued and when the queue is stopped.  The unlink calls are
+  // counted in the global statistics, if any.
+
+  if ((unlinkQ = unlinkqOpen(nWorkers, ltx::ioUring, report, 0)) == 0  ||
+      (cwdDir  = unlinkqDir(unlinkQ, AT_FDCWD, "")) == 0) {
+    std::cerr << ltx::progname << ": cannot start the deletion threads\n";
+    std::exit(1);
+  }
+  unlinkqStats(unlinkQ, ltx::stats);
+}
+
+void stop_unlink_queue()
+{
+  // Waits for all the queued files, then stops the deletion threads.
+
+  if (unlinkQ == 0) return;
+
+  unlinkqRelease(unlinkQ, cwdDir);
+  unlinkqClose(unlinkQ);
+  unlinkQ = 0;
+  cwdDir  = 0;
+}
+
+namespace {
+  void judge(
+    const string     & dirName,
+    const fileFamily & family,
+    Sink             * out,
+    Stats            * pS
+  ) {
+    // Loops over all the extensions in the file family "family", of the
+    // directory "dirName" (in the order of the table "texExtensions");
+    // if a ".tex" file with a modification time former than the
+    // modification time of the target file exists, the file is removed.
 
-  fileCollection::const_iterator iter, iterEnd = dir.end();
+    unsigned mask = family.mask();
+    string   fullName;
 
-  for (iter = dir.begin();  iter != iterEnd;  iter++) {
+    for (size_t id = 0;  mask != 0;  id++, mask >>= 1) {
 
-    const fileFamily                   * pFF = iter->second;
-    std::list<extInfo>::const_iterator   jter;
-    std::list<extInfo>::const_iterator   jterEnd = pFF->end();
+      if ((mask & 1) == 0) continue;
 
-    for (jter = pFF->begin();  jter != jterEnd;  jter++) {
+      fullName.assign(family.base(), family.baseLength());
+      fullName.append(texExtensions[id]);
 
-      string fullName = iter->first + jter->first;
+      SinkRecord rec;
 
-      if (pFF->hasTex()) {
-        if (difftime(jter->second, pFF->texMtime()) > 0.0) {
+      sinkInit(&rec, dirName.c_str(), fullName.c_str(),
+               SINK_REMOVED, SINK_STALE);
+      rec.size  = family.size(id);
+      rec.mTime = family.mTime(id);
+
+      if (family.hasTex()) {
+        rec.texMtime = family.texMtime();
+
+        if (difftime(family.mTime(id), family.texMtime()) > 0.0) {
 
           if (ltx::confirm) {
             char answer[answerLength], c;
 
+            sinkFlush(out);             // What precedes, before asking
             do {
-              cout << "Remove " << dir.getName()
+              cout << "Remove " << dirName
                    << fullName << " (y|n) ? ";
               cin.get(answer, answerLength);
               if (cin.gcount() < answerLength-1 ) {
@@ -62,37 +212,43 @@ void clean_files(
             } while (c != 'y'  &&  c != 'n');
             if (c != 'y') continue;
           }
-          nuke(dir.getName(), fullName);
+          nuke(dirName, fullName, out, pS, rec);
 
         } else {
-          cout << dir.getName() << fullName
-               << " not removed; " << iter->first
-               << ".tex is newer\n";
+          statsAdd(pS, STATS_TEX_NEWER, 1);
+          rec.action = SINK_KEPT;
+          rec.reason = SINK_TEX_NEWER;
+          sinkEvent(out, &rec, "%s%s not removed; %.*s.tex is newer\n",
+                    dirName.c_str(), fullName.c_str(),
+                    static_cast<int>(family.baseLength()), family.base());
         }
       } else {
-        cout << dir.getName() << fullName
-             << " not removed; " << iter->first
-             << ".tex does not exist\n";
+        statsAdd(pS, STATS_NO_TEX, 1);
+        rec.action = SINK_KEPT;
+        rec.reason = SINK_NO_TEX;
+        sinkEvent(out, &rec, "%s%s not removed; %.*s.tex does not exist\n",
+                  dirName.c_str(), fullName.c_str(),
+                  static_cast<int>(family.baseLength()), family.base());
       }
     }
   }
-}
-
-void nuke(
-  const string & dirName,
-  const string & fileName
-) {
-  // Removes the file "fileName" from the directory "dirName".  If the
-  // preprocessor symbol 'DEBUG' is defined, the file is not actually
-  // removed: but a message is printed on the standard output stream,
-  // informing that the Finger Of Death has been raised to him.
 
-  string target = dirName + fileName;
-
-#if defined(DEBUG)
-  cout << "FOD: " << target << std::endl;
-#else
-  remove(target.c_str());
-  cout << target << " has been removed.\n";
-#endif // DEBUG
+  void report(
+    void       *,
+    const char *,
+    const char * target,
+    int          reason,
+    int          err
+  ) {
+    if (err != 0) {
+      std::cerr << ltx::progname << ": cannot remove " << target
+                << ": " << std::strerror(err) << '\n';
+    } else {
+      SinkRecord rec;
+
+      statsAdd(ltx::stats, STATS_REMOVED, 1);
+      sinkInit(&rec, 0, target, SINK_REMOVED, reason);
+      sinkEvent(ltx::output, &rec, "%s has been removed.\n", target);
+    }
+  }
 }
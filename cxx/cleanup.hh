@@ -16,8 +16,13 @@
 
 #include <string>
 #include "file.hh"
+#include "../sink.h"
+#include "../stats.h"
 
-void clean_files(const currDir &);
-void nuke(const std::string &, const std::string &);
+void clean_files(currDir &, Sink *, Stats *);
+void nuke(const std::string &, const std::string &, Sink *, Stats *,
+          SinkRecord &);
+void start_unlink_queue(unsigned);
+void stop_unlink_queue();
 
 #endif // CLEANUP_H_
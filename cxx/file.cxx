@@ -12,59 +12,287 @@
 // -------------------------------------------------------------------
 
 #include <algorithm>
-#include <functional>
-#include <iostream>
-#include "file.hh"              // Includes: list, map, string, utility, ctime
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "file.hh"              // Includes: cstddef, string, vector, ctime,
+                                //           sys/types.h, spill.h
 
-using std::string;
+// The relevant extensions of the files
 
-// Methods for the class fileFamily
+const char * texExtensions[nTexExtensions] = {
+  ".aux", ".dvi", ".idx", ".ilg", ".ind",
+  ".lof", ".log", ".lot", ".pdf", ".ps",
+  ".toc"
+};
+
+// Local constants and functions
+
+namespace {
+  // Minimum size of the arena blocks, and initial number of slots of
+  // the family hash table
+
+  const size_t blockSize(16384);
+  const size_t initialSlots(64);
+
+  unsigned hash(
+    const char * p,
+    size_t       len
+  ) {
+    // FNV-1a
+
+    unsigned h = 2166136261U;
+
+    while (len-- > 0) {
+      h ^= static_cast<unsigned char>(*p++);
+      h *= 16777619U;
+    }
+    return h;
+  }
+
+  bool lessBase(
+    const fileFamily * lhs,
+    const fileFamily * rhs
+  ) {
+    // Same order as for std::string
 
-void fileFamily::addExtension(
-  time_t         mTime,
-  const string * pExtName
+    size_t n = std::min(lhs->baseLength(), rhs->baseLength());
+    int    c = std::memcmp(lhs->base(), rhs->base(), n);
+
+    return c != 0 ? c < 0 : lhs->baseLength() < rhs->baseLength();
+  }
+}
+
+// Methods for the class arena
+
+arena::~arena()
+{
+  clear();
+}
+
+void * arena::allocate(
+  size_t size
 ) {
-  // Insert the file informations in a fileFamily.  "mTime" is the
-  // modification time, "pExtName" points to the file extension or is
-  // NULL for an extension of ".tex" .
+  // Carves "size" bytes, suitably aligned, out of the current block;
+  // a new block is obtained when the current one is full.
 
-  if (pExtName) {
-    _extInfo.push_back( std::make_pair(*pExtName, mTime) );
-  } else {
-    _hasTex   = true;
-    _texMtime = mTime;
+  size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+
+  if (_blocks == 0  ||  _blocks->size - _blocks->used < size) {
+    size_t  n = std::max(size, blockSize);
+    block * b = static_cast<block *>(std::malloc(sizeof(block) + n));
+
+    if (b == 0) throw std::bad_alloc();
+    b->next = _blocks;
+    b->size = n;
+    b->used = 0;
+    _blocks = b;
   }
+
+  void * p = reinterpret_cast<char *>(_blocks->data) + _blocks->used;
+  _blocks->used += size;
+  return p;
 }
 
-// Auxiliary function object for currDir objects
+void arena::clear()
+{
+  // Releases all the blocks.
 
-struct releaseFileFamily
-  : public std::unary_function<fileCollectionElement, void> {
-  void operator() (fileCollectionElement & p) {
-    delete p.second; }
-};
+  while (_blocks != 0) {
+    block * next = _blocks->next;
+    std::free(_blocks);
+    _blocks = next;
+  }
+}
+
+const char * arena::copy(
+  const char * s,
+  size_t       len
+) {
+  // A null terminated copy of the "len" characters at "s"
+
+  char * p = static_cast<char *>(allocate(len + 1));
+
+  std::memcpy(p, s, len);
+  p[len] = '\0';
+  return p;
+}
 
 // Methods for the class currDir
 
 currDir::~currDir()
 {
-  for_each(_dirContent.begin(), _dirContent.end(), releaseFileFamily());
+  delete [] _slots;
+  if (_spilled) spillReset(_spill);
+}
+
+void currDir::grow()
+{
+  // Doubles the hash table, moving the positions to their new slots.
+
+  size_t capacity = _capacity == 0 ? initialSlots : 2 * _capacity;
+  slot * slots    = new slot[capacity];
+
+  for (size_t j = 0;  j < capacity;  j++) slots[j].family = 0;
+
+  for (size_t i = 0;  i < _capacity;  i++) {
+    if (_slots[i].family == 0) continue;
+
+    size_t j = _slots[i].hash & (capacity - 1);
+    while (slots[j].family != 0) j = (j + 1) & (capacity - 1);
+    slots[j] = _slots[i];
+  }
+
+  delete [] _slots;
+  _slots    = slots;
+  _capacity = capacity;
 }
 
 fileFamily & currDir::getFileFamily(
-  const string & base
+  const char * base,
+  size_t       len
+) {
+  // Gets the file family related to the basename "base", of length
+  // "len".  If this is the first file found, the basename is copied
+  // in the arena and a new family is appended, taking a free slot of
+  // the table (that is kept at most half full).
+
+  if (2 * (_families.size() + 1) > _capacity) grow();
+
+  unsigned h = hash(base, len);
+  size_t   i = h & (_capacity - 1);
+
+  while (_slots[i].family != 0) {
+    if (_slots[i].hash == h) {
+      fileFamily & fF = _families[_slots[i].family - 1];
+      if (fF._lBase == len  &&
+          std::memcmp(fF._base, base, len) == 0) return fF;
+    }
+    i = (i + 1) & (_capacity - 1);
+  }
+
+  fileFamily fF;
+
+  fF._base     = _arena.copy(base, len);
+  fF._lBase    = len;
+  _bytes      += len + 1;
+  fF._mask     = 0;
+  fF._texMtime = 0;
+
+  _families.push_back(fF);
+  _slots[i].hash   = h;
+  _slots[i].family = _families.size();
+  return _families.back();
+}
+
+void currDir::addFile(
+  const char * name,
+  size_t       lBase,
+  time_t       mTime,
+  off_t        size,
+  int          id
 ) {
-  // Gets the file family related to the basename "base".  If this is
-  // the first file found, a fileFamily instance is allocated with
-  // "operator new" (and will be later deleted in the currDir class
-  // destructor).
+  // Inserts the file "name", whose basename is given by its first
+  // "lBase" characters, in its family.  "mTime" is the modification
+  // time and "size" the size (not kept for ".tex"); "id" the position
+  // of the extension in "texExtensions", or -1 for ".tex" .  Spilled,
+  // the identifier of the extension is one more than "id".
+
+  if (_spilled) {
+    if (spillAdd(_spill, name, lBase, id + 1, mTime, size, 0) != 0  &&
+        errno == ENOMEM) throw std::bad_alloc();
+    return;
+  }
+
+  fileFamily & fF = getFileFamily(name, lBase);
+
+  if (id < 0) {
+    fF._mask     |= fileFamily::texBit;
+    fF._texMtime  = mTime;
+  } else {
+    fF._mask       |= 1U << id;
+    fF._mTimes[id]  = mTime;
+    fF._sizes[id]   = size;
+  }
+
+  if (_spill != 0  &&
+      _families.capacity() * sizeof(fileFamily) +
+      _capacity * sizeof(slot) + _bytes > _budget) spillFamilies();
+}
+
+void currDir::spillFamilies()
+{
+  // Moves all the families to the spilled entries, and releases their
+  // memory.  An error other than running out of memory is reported by
+  // nextFamily().
+
+  for (size_t i = 0;  i < _families.size();  i++) {
+    const fileFamily & fF = _families[i];
+    int                rc = 0;
+
+    if (fF.hasTex()) {
+      rc |= spillAdd(_spill, fF._base, fF._lBase, 0, fF._texMtime, 0, 0);
+    }
+    for (size_t id = 0;  id < nTexExtensions;  id++) {
+      if (! fF.has(id)) continue;
+      rc |= spillAdd(_spill, fF._base, fF._lBase, id + 1, fF._mTimes[id],
+                     fF._sizes[id], 0);
+    }
+    if (rc != 0  &&  errno == ENOMEM) throw std::bad_alloc();
+  }
+
+  std::vector<fileFamily>().swap(_families);
+  delete [] _slots;
+  _slots    = 0;
+  _capacity = 0;
+  _bytes    = 0;
+  _arena.clear();
+  _spilled  = true;
+}
 
-  fileFamily * retval = _dirContent[ base ];
+void currDir::getFamilies(
+  std::vector<const fileFamily *> & families
+) const {
+  // Fills "families" with all the file families, sorted by basename.
 
-  if (retval == 0) {
-    retval              = new fileFamily;
-    _dirContent[ base ] = retval;
+  families.clear();
+  families.reserve(_families.size());
+  for (size_t i = 0;  i < _families.size();  i++) {
+    families.push_back(&_families[i]);
   }
+  std::sort(families.begin(), families.end(), lessBase);
+}
+
+long currDir::nextFamily(
+  fileFamily & fF
+) {
+  // Once spilled, fills "fF" with the next family, in the order of the
+  // basenames: returns the number of its files, 0 if there are no more
+  // families, -1 (with errno set) if the spilled entries could not be
+  // merged.  The basename is valid until the next call.
+
+  const SpillEntry * family;
+  long               n = spillFamily(_spill, &family);
 
-  return *retval;
+  if (n <= 0) return n;
+
+  fF._base     = family->name;
+  fF._lBase    = std::strlen(family->name);
+  fF._mask     = 0;
+  fF._texMtime = 0;
+
+  for (long i = 0;  i < n;  i++) {
+    if (family[i].ext == 0) {
+      fF._mask     |= fileFamily::texBit;
+      fF._texMtime  = family[i].mTime;
+    } else {
+      size_t id = family[i].ext - 1;
+
+      fF._mask       |= 1U << id;
+      fF._mTimes[id]  = family[i].mTime;
+      fF._sizes[id]   = family[i].size;
+    }
+  }
+  return n;
 }
@@ -14,75 +14,128 @@
 #ifndef FILE_H_
 #define FILE_H_
 
-#include <list>
-#include <map>
+#include <cstddef>
 #include <string>
-#include <utility>
+#include <vector>
 #include <ctime>
 
+extern "C" {
+  #include <sys/types.h>
+}
+
+#include "../spill.h"
+
 // Classes for the handling of directories and files.
 //
-// - The files are abstracted as a basename, an extension and a
-//   modification time: the basename being defined as all the file
-//   name characters up to (but not including) the last "."; and the
-//   extension as the remainder.  A file may have an empty basename or
-//   an empty extension.
+// - The files are abstracted as a basename, an extension, a
+//   modification time and a size: the extension being one of the
+//   relevant ones listed in "texExtensions" (or ".tex"), and the
+//   basename all the file name characters before it.  A file may have
+//   an empty basename.
 //
 // - A "file family" is a set of files having all the same basename
 //   and different extensions.  In this context, an extension of
 //   ".tex" is considered 'special' and is managed separately; the
 //   class "fileFamily" actually contains informations about the
-//   existence of a .tex member and its modification time, plus a list
-//   of all the related files with different extensions.
+//   existence of a .tex member and its modification time, plus the
+//   set of the other extensions found (as a bit mask, bit "i" standing
+//   for texExtensions[i]) and their modification times and sizes.
 //
-// - For the file families, methods are provided to test for the
-//   existence of a .tex; to get its modification time; to add a
-//   member to the family; and to retrieve the list of all the
-//   extensions found.
+// - For the file families, methods are provided to get the basename;
+//   to test for the existence of a .tex; to get its modification
+//   time; and to test for an extension and get its modification time.
+//
+// The basenames of a directory are kept in an "arena", released as a
+// whole with the directory: no memory is allocated for a single file.
 
-typedef std::pair< std::string, time_t > extInfo;
+// The relevant extensions of the files, ".tex" excepted
 
-class fileFamily {
+const size_t         nTexExtensions = 11;
+extern const char  * texExtensions[nTexExtensions];
+
+class arena {
 private:
-  bool               _hasTex;
-  time_t             _texMtime;
-  std::list<extInfo> _extInfo;
+  struct block {
+    block * next;
+    size_t  size;
+    size_t  used;
+    double  data[1];            // Aligned storage; actually "size" bytes
+  };
+
+  block * _blocks;
 
   // Prevents any use of the copy constructor and of the assignment
   // operator
 
-  fileFamily & operator = (const fileFamily & rhs);
-  fileFamily(const fileFamily & rhs);
+  arena & operator = (const arena & rhs);
+  arena(const arena & rhs);
 
 public:
-  fileFamily() : _hasTex(false), _texMtime(0) {}
-  ~fileFamily() {}
+  arena() : _blocks(0) {}
+  ~arena();
 
-  bool   hasTex()   const { return _hasTex;   }
-  time_t texMtime() const { return _texMtime; }
+  void       * allocate(size_t);
+  const char * copy(const char *, size_t);
+  void         clear();
+};
 
-  void addExtension(time_t, const std::string *);
+class fileFamily {
+private:
+  friend class currDir;
+
+  static const unsigned texBit = 1U << nTexExtensions;
 
-  // Const-iterators over all the found extensions
+  const char * _base;
+  unsigned     _lBase;
+  unsigned     _mask;         // Plus "texBit" if there is a .tex
+  time_t       _texMtime;
+  time_t       _mTimes[nTexExtensions];
+  off_t        _sizes[nTexExtensions];
 
-  std::list<extInfo>::const_iterator begin() const {
-    return _extInfo.begin(); }
-  std::list<extInfo>::const_iterator end() const {
-    return _extInfo.end(); }
+public:
+  const char * base()       const { return _base;            }
+  size_t       baseLength() const { return _lBase;           }
+  bool         hasTex()     const { return _mask & texBit;   }
+  time_t       texMtime()   const { return _texMtime;        }
+  unsigned     mask()       const { return _mask & ~texBit;  }
+
+  bool   has(size_t id)    const { return (_mask >> id) & 1; }
+  time_t mTime(size_t id)  const { return _mTimes[id];       }
+  off_t  size(size_t id)   const { return _sizes[id];        }
 };
 
 // A directory is seen as a directory name plus a collection of file
-// families; that collection is implemented as an STL map.  Methods
-// are provided to add a file, to retrieve the directory name, and to
-// iterate over the file families.
-
-typedef std::pair< const std::string, fileFamily * > fileCollectionElement;
-typedef std::map< const std::string, fileFamily * >  fileCollection;
+// families; the families are stored contiguously, and indexed by
+// their basename through an open addressing hash table (with linear
+// probing) of their positions.  Methods are provided to add a file,
+// to retrieve the directory name, and to get the file families
+// sorted by basename.
+//
+// Given a set of spilled entries (see spill.h) and a memory budget,
+// the families that would take more than that are moved to the set,
+// and so are the files added afterwards; the families are then got
+// back one at a time, sorted by basename, as the runs are merged.
 
 class currDir {
 private:
-  std::string    _name;
-  fileCollection _dirContent;
+  struct slot {
+    unsigned hash;
+    unsigned family;            // Position in "_families", plus 1
+  };
+
+  std::string             _name;
+  arena                   _arena;
+  std::vector<fileFamily> _families;
+  slot                  * _slots;
+  size_t                  _capacity;    // A power of 2
+  size_t                  _bytes;       // Taken by the basenames
+  Spill                 * _spill;
+  size_t                  _budget;
+  bool                    _spilled;
+
+  fileFamily & getFileFamily(const char *, size_t);
+  void         grow();
+  void         spillFamilies();
 
   // Prevents any use of the copy constructor and of the assignment
   // operator
@@ -91,18 +144,16 @@ private:
   currDir(const currDir & rhs);
 
 public:
-  currDir(const std::string & dirName) : _name(dirName) { }
+  currDir(const std::string & dirName, Spill * pX = 0, size_t budget = 0)
+    : _name(dirName), _slots(0), _capacity(0), _bytes(0),
+      _spill(pX), _budget(budget), _spilled(false) { }
   ~currDir();
 
-  const std::string & getName() const { return _name; }
-  fileFamily & getFileFamily(const std::string &);
-
-  // Iterators over all the found file families
-
-  fileCollection::const_iterator begin() const {
-    return _dirContent.begin(); }
-  fileCollection::const_iterator end() const {
-    return _dirContent.end(); };
+  const std::string & getName() const { return _name;    }
+  bool                spilled() const { return _spilled; }
+  void addFile(const char *, size_t, time_t, off_t, int);
+  void getFamilies(std::vector<const fileFamily *> &) const;
+  long nextFamily(fileFamily &);
 };
 
 #endif // FILE_H_
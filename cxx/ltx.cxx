@@ -16,12 +16,20 @@
 
 #include <algorithm>
 #include <list>
+#include <cstdlib>
 #include <cstring>
-#include "ltx.hh"               // Includes: functional, iostream, string
-#include "cleandir.hh"          // Includes: string
+#include "ltx.hh"               // Includes: functional, iostream, string,
+                                //           fstype.h, sink.h, stats.h
+#include "cleandir.hh"          // Includes: cstddef, string
+#include "cleanup.hh"           // Includes: string
+#include "../dents.h"           // Includes: stddef.h
+#include "../mstat.h"           // Includes: time.h, sys/types.h
+#include "../watch.h"
 
 extern "C" {
+  #include <errno.h>
   #include <getopt.h>
+  #include <signal.h>
   #include <unistd.h>
 }
 
@@ -37,6 +45,23 @@ namespace ltx {
   string::size_type lTrailEd;
   bool              confirm(false);
   bool              recurse(false);
+  bool              follow(true);
+  int               maxDepth(-1);
+  std::list<string> prunes;
+  bool              oneFs(false);
+  FsPolicy        * fsPolicy(0);
+  unsigned          jobs(1);
+  bool              ioUring(false);
+  unsigned          statThreads(0);
+  unsigned          asyncUnlink(0);
+  size_t            dirBuffer(DENTS_BUFFER);
+  size_t            maxMemory(0);
+  unsigned          watchSettle(0);
+  bool              watching(false);
+  int               format(SINK_TEXT);
+  Sink            * output(0);
+  Stats           * stats(0);
+  bool              statsJson(false);
 }
 
 using namespace ltx;
@@ -44,8 +69,11 @@ using namespace ltx;
 // Local procedures
 
 namespace {
-  char *basename(char *);
+  char *baseName(char *);
   void  syntax();
+  int   relevant(void *, const char *, unsigned long);
+  void  clean_watched(void *, const char *);
+  void  stop_watching(int);
 }
 
 int main(
@@ -53,18 +81,34 @@ int main(
   char *argv[]
 ) {
   std::list<string> targets;
+  bool              wantStats = false;
 
   // Gets the executable name
 
-  progname = argv[0] = basename(argv[0]);
+  progname = argv[0] = baseName(argv[0]);
 
   // Decodes the command line options and arguments
 
-  char          shortOpts[] = "irb::";
+  char          shortOpts[] = "irb::j:";
   struct option longOpts[]  = {
     {"interactive", no_argument,       0, 'i'},
     {"recursive",   no_argument,       0, 'r'},
     {"backup",      optional_argument, 0, 'b'},
+    {"jobs",        required_argument, 0, 'j'},
+    {"io-uring",    no_argument,       0, 'U'},
+    {"follow",      no_argument,       0, 'L'},
+    {"no-follow",   no_argument,       0, 'P'},
+    {"max-depth",   required_argument, 0, 'M'},
+    {"prune",       required_argument, 0, 'N'},
+    {"one-file-system", no_argument,   0, 'X'},
+    {"fs-policy",   required_argument, 0, 'T'},
+    {"stat-threads", optional_argument, 0, 'H'},
+    {"async-unlink", optional_argument, 0, 'A'},
+    {"dir-buffer",  required_argument, 0, 'D'},
+    {"max-memory",  required_argument, 0, 'K'},
+    {"watch",       optional_argument, 0, 'W'},
+    {"format",      required_argument, 0, 'F'},
+    {"stats",       optional_argument, 0, 'S'},
     { 0,            0,                 0,  0}
   };
 
@@ -83,6 +127,160 @@ int main(
         trailEd = optarg ? optarg : "";
         break;
 
+      case 'j': {
+        char *end;
+        long  n = std::strtol(optarg, &end, 10);
+
+        if (*end != '\0'  ||  n < 1) {
+          std::cerr << progname << ": invalid number of jobs \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        jobs = n;
+        break;
+      }
+
+      case 'U':
+        ioUring = true;
+        break;
+
+      case 'L':
+        follow = true;
+        break;
+
+      case 'P':
+        follow = false;
+        break;
+
+      case 'M': {
+        char *end;
+        long  n = std::strtol(optarg, &end, 10);
+
+        if (*end != '\0'  ||  *optarg == '\0'  ||  n < 0) {
+          std::cerr << progname << ": invalid depth \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        maxDepth = n;
+        break;
+      }
+
+      case 'N':
+        prunes.push_back(optarg);
+        break;
+
+      case 'X':
+        oneFs = true;
+        break;
+
+      case 'T':
+        if (fsPolicy == 0  &&  (fsPolicy = fsPolicyNew()) == 0) {
+          std::cerr << progname << ": couldn't obtain heap memory\n";
+          return 1;
+        }
+        if (fsPolicySet(fsPolicy, optarg) != 0) {
+          std::cerr << progname << ": invalid file system policy \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        break;
+
+      case 'H': {
+        long n = MSTAT_THREADS;
+
+        if (optarg) {
+          char *end;
+
+          n = std::strtol(optarg, &end, 10);
+          if (*end != '\0'  ||  n < 1) {
+            std::cerr << progname << ": invalid number of threads \""
+                      << optarg << "\"\n";
+            return 1;
+          }
+        }
+        statThreads = n;
+        break;
+      }
+
+      case 'A': {
+        long n = 1;
+
+        if (optarg) {
+          char *end;
+
+          n = std::strtol(optarg, &end, 10);
+          if (*end != '\0'  ||  n < 1) {
+            std::cerr << progname << ": invalid number of threads \""
+                      << optarg << "\"\n";
+            return 1;
+          }
+        }
+        asyncUnlink = n;
+        break;
+      }
+
+      case 'D': {
+        char *end;
+        long  n = std::strtol(optarg, &end, 10);
+
+        if (*end != '\0'  ||  n < 1) {
+          std::cerr << progname << ": invalid buffer size \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        dirBuffer = n * 1024;
+        break;
+      }
+
+      case 'K': {
+        char *end;
+        long  n = std::strtol(optarg, &end, 10);
+
+        if (*end != '\0'  ||  n < 1) {
+          std::cerr << progname << ": invalid memory budget \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        maxMemory = n * 1024;
+        break;
+      }
+
+      case 'W': {
+        long n = 5;
+
+        if (optarg) {
+          char *end;
+
+          n = std::strtol(optarg, &end, 10);
+          if (*end != '\0'  ||  n < 1) {
+            std::cerr << progname << ": invalid number of seconds \""
+                      << optarg << "\"\n";
+            return 1;
+          }
+        }
+        watchSettle = n;
+        break;
+      }
+
+      case 'F':
+        if ((format = sinkFormat(optarg)) < 0) {
+          std::cerr << progname << ": invalid output format \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        break;
+
+      case 'S':
+        if (optarg  &&  std::strcmp(optarg, "json") == 0) {
+          statsJson = true;
+        } else if (optarg  &&  std::strcmp(optarg, "text") != 0) {
+          std::cerr << progname << ": invalid statistics format \""
+                    << optarg << "\"\n";
+          return 1;
+        }
+        wantStats = true;
+        break;
+
       case 'h':
       case '?':
         syntax();
@@ -103,12 +301,41 @@ int main(
 
   lTrailEd = trailEd.size();
 
+  // Questions to the user can't be asked from more than one thread;
+  // and the removals are queued (and reported) by a single thread.
+
+  if (confirm) jobs = 1;
+  if (jobs > 1) asyncUnlink = 0;
+
   if (targets.empty()) targets.push_back(".");
 
+  // The messages about the files go through a buffered sink, on the
+  // standard output
+
+  if ((output = sinkOpen(stdout, format)) == 0  ||
+      (wantStats  &&  (stats = statsOpen()) == 0)) {
+    std::cerr << progname << ": couldn't obtain heap memory\n";
+    return 1;
+  }
+
 #if defined(DEBUG)
   cout << "--------------------Argument analysis\n";
   cout << "Confirm = " << confirm << endl;
   cout << "Recurse = " << recurse << endl;
+  cout << "Follow = " << follow << endl;
+  cout << "Max depth = " << maxDepth << endl;
+  cout << "Pruned directories:\n";
+  for_each(prunes.begin(), prunes.end(), printBefore("  "));
+  cout << "One file system = " << oneFs << endl;
+  cout << "File system policies = " << (fsPolicy != 0) << endl;
+  cout << "Jobs = " << jobs << endl;
+  cout << "io_uring = " << ioUring << endl;
+  cout << "Stat threads = " << statThreads << endl;
+  cout << "Async unlink = " << asyncUnlink << endl;
+  cout << "Directory buffer = " << dirBuffer << endl;
+  cout << "Memory budget = " << maxMemory << endl;
+  cout << "Watch settle time = " << watchSettle << endl;
+  cout << "Output format = " << format << endl;
   cout << "Trailing editor extension = \"" << trailEd
        << "\" (length " << lTrailEd << ")\n";
   cout << "Target directories:\n";
@@ -116,15 +343,75 @@ int main(
   for_each(targets.begin(), targets.end(), printBefore("  "));
 #endif // DEBUG
 
+  // With --watch, the directories are watched before being scanned,
+  // so that no change is missed
+
+  Watch * watch = 0;
+
+  if (watchSettle > 0) {
+    watch = watchOpen(watchSettle * 1000UL, recurse, relevant,
+                      clean_watched, 0);
+    if (watch == 0) {
+      std::cerr << progname << ": cannot watch directories: "
+                << std::strerror(errno) << endl;
+      return 1;
+    }
+
+    std::list<string>::const_iterator iter;
+
+    for (iter = targets.begin();  iter != targets.end();  iter++) {
+      if (watchAdd(watch, iter->c_str()) != 0) {
+        std::cerr << progname << ": \"" << *iter
+                  << "\" not (entirely) watched: "
+                  << std::strerror(errno) << endl;
+      }
+    }
+  }
+
   // Scans in turn all the wanted directories
 
+  if (asyncUnlink > 0) start_unlink_queue(asyncUnlink);
+
   for_each(targets.begin(), targets.end(), std::ptr_fun(scan_dir));
 
+  stop_unlink_queue();
+
+  // Then, cleans again the directories where TeX-related files are
+  // written, one at a time, until interrupted
+
+  if (watch != 0) {
+    struct sigaction sa;
+
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_watching;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
+
+    sinkFlush(output);
+    watching = true;
+    if (watchRun(watch) != 0) {
+      std::cerr << progname << ": watch failed: "
+                << std::strerror(errno) << endl;
+    }
+    watchClose(watch);
+  }
+
+  statsPrint(stats, stderr, statsJson);
+  statsClose(stats);
+  fsPolicyFree(fsPolicy);
+
+  if (sinkClose(output) != 0) {
+    std::cerr << progname << ": output not written: "
+              << std::strerror(errno) << endl;
+    return 1;
+  }
+
   return 0;
 }
 
 namespace {
-  char *basename(
+  char *baseName(
     char *pc
   ) {
     // Strips the (eventual) path name from the full file name pointed
@@ -135,6 +422,33 @@ namespace {
     return ++p;
   }
 
+  int relevant(
+    void          *,
+    const char    *name,
+    unsigned long  len
+  ) {
+    // While watching, tells whether a change to the file "name" may
+    // need a cleanup.
+
+    return relevant_name(name, len);
+  }
+
+  void clean_watched(
+    void       *,
+    const char *dirName
+  ) {
+    // While watching, cleans the directory "dirName" that has changed.
+
+    scan_dir(dirName);
+    sinkFlush(output);
+  }
+
+  void stop_watching(int)
+  {
+    // Interrupts the watch (SIGINT, SIGTERM), so that the program ends
+    // as usual.
+  }
+
   void syntax()
   {
     cout <<
@@ -157,10 +471,108 @@ namespace {
       "identifying\n";
     cout <<
       "\t\t\t\t  editor backup files.\n";
+    cout <<
+      "\t -j n   | --jobs=n      : with -r, scans the directories using "
+      "n threads;\n";
+    cout <<
+      "\t          --io-uring    : gets the file metadata in batches, "
+      "through\n";
+    cout <<
+      "\t\t\t\t  io_uring (if supported by the kernel);\n";
+    cout <<
+      "\t --follow, --no-follow    : with -r, descends (the default) or not "
+      "into the\n";
+    cout <<
+      "\t\t\t\t  symbolic links to directories; every\n";
+    cout <<
+      "\t\t\t\t  directory is scanned once, however reached;\n";
+    cout <<
+      "\t --max-depth=n            : with -r, descends at most n levels;\n";
+    cout <<
+      "\t --prune=pattern          : with -r, skips the subdirectories "
+      "whose name\n";
+    cout <<
+      "\t\t\t\t  matches the pattern (e.g. \"*.cache\"), besides\n";
+    cout <<
+      "\t\t\t\t  .git, .hg, .svn, node_modules and those\n";
+    cout <<
+      "\t\t\t\t  holding CACHEDIR.TAG or .lintexignore;\n";
+    cout <<
+      "\t --one-file-system        : with -r, skips the file systems "
+      "mounted\n";
+    cout <<
+      "\t\t\t\t  below the given directories;\n";
+    cout <<
+      "\t --fs-policy=type=what    : with -r, skips (skip), allows (allow) "
+      "or\n";
+    cout <<
+      "\t\t\t\t  scans with at most n threads (n) the file\n";
+    cout <<
+      "\t\t\t\t  systems of a type (e.g. nfs, fuse, autofs,\n";
+    cout <<
+      "\t\t\t\t  * for all the others) mounted below the\n";
+    cout <<
+      "\t\t\t\t  given directories; may be repeated;\n";
+    cout <<
+      "\t --stat-threads[=n]       : gets the metadata of the entries of "
+      "a directory\n";
+    cout <<
+      "\t\t\t\t  with up to n threads (default 16), as many\n";
+    cout <<
+      "\t\t\t\t  as the latency of the calls makes worthwhile;\n";
+    cout <<
+      "\t --async-unlink[=n]       : removes the files with n threads "
+      "(default 1)\n";
+    cout <<
+      "\t\t\t\t  while the scan goes on;\n";
+    cout <<
+      "\t --dir-buffer=n           : reads the directories n KiB at a time "
+      "(default\n";
+    cout <<
+      "\t\t\t\t  256);\n";
+    cout <<
+      "\t --max-memory=n           : keeps the files of the directories "
+      "within\n";
+    cout <<
+      "\t\t\t\t  about n KiB in all (shared by the jobs);\n";
+    cout <<
+      "\t\t\t\t  beyond that, they are sorted in\n";
+    cout <<
+      "\t\t\t\t  temporary files (in $TMPDIR) and decided\n";
+    cout <<
+      "\t\t\t\t  as these are merged back;\n";
+    cout <<
+      "\t --watch[=s]              : then watches the directories, and "
+      "cleans again\n";
+    cout <<
+      "\t\t\t\t  those where TeX-related files are written,\n";
+    cout <<
+      "\t\t\t\t  once quiet for s seconds (default 5);\n";
+    cout <<
+      "\t --format=f               : writes the messages as text (the "
+      "default),\n";
+    cout <<
+      "\t\t\t\t  as JSON records, one per line (json), or\n";
+    cout <<
+      "\t\t\t\t  only the names of the removed files, each\n";
+    cout <<
+      "\t\t\t\t  followed by a NUL character (nul);\n";
+    cout <<
+      "\t --stats[=json]           : prints on stderr, at exit, counters, "
+      "phase\n";
+    cout <<
+      "\t\t\t\t  times, stat and unlink latencies and the\n";
+    cout <<
+      "\t\t\t\t  peak memory (as a JSON object, if so\n";
+    cout <<
+      "\t\t\t\t  required).\n";
     cout <<
       "Notes:\t \"ext\" defaults to \"~\"; -b \"\" avoids the unconditional "
       "cleanup of\n";
     cout <<
-      "\t any special file.\n" << endl;
+      "\t any special file; -j is ignored when -i is given, and "
+      "--async-unlink\n";
+    cout <<
+      "\t when -j is; --stat-threads is ignored with --io-uring.\n" << endl;
   }
 }
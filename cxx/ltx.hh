@@ -13,7 +13,11 @@
 
 #include <functional>
 #include <iostream>
+#include <list>
 #include <string>
+#include "../fstype.h"
+#include "../sink.h"
+#include "../stats.h"
 
 // Auxiliary function object used to print (on an output stream) a
 // leading text followed by the argument string and an end-of-line.
@@ -27,7 +31,7 @@ public:
   printBefore(const std::string & b = "", std::ostream & o = std::cout)
     : _leader(b), _os(o) {}
   ~printBefore() {}
-  void operator() (const std::string & s) { _os << _leader << s << std::endl; }
+  void operator() (const std::string & s) { _os << _leader << s << '\n'; }
 };
 
 // Global variables (declaration)
@@ -38,4 +42,21 @@ namespace ltx {
   extern std::string::size_type lTrailEd;
   extern bool                   confirm;
   extern bool                   recurse;
+  extern bool                   follow;
+  extern int                    maxDepth;
+  extern std::list<std::string> prunes;
+  extern bool                   oneFs;
+  extern FsPolicy             * fsPolicy;
+  extern unsigned               jobs;
+  extern bool                   ioUring;
+  extern unsigned               statThreads;
+  extern unsigned               asyncUnlink;
+  extern size_t                 dirBuffer;
+  extern size_t                 maxMemory;
+  extern unsigned               watchSettle;
+  extern bool                   watching;
+  extern int                    format;
+  extern Sink                 * output;
+  extern Stats                * stats;
+  extern bool                   statsJson;
 }
@@ -0,0 +1,183 @@
+// -------------------------------------------------------------------
+//
+//     $Id$
+//
+// -------------------------------------------------------------------
+
+#include <iostream>
+#include "ltx.hh"               // Includes: functional, iostream, string,
+                                //           sink.h, stats.h
+#include "pool.hh"              // Includes: deque, vector, pthread.h
+
+workPool::workPool(
+  unsigned nWorkers
+) : _pending(0), _sleeping(0), _generation(0) {
+  if (nWorkers == 0) nWorkers = 1;
+
+  for (unsigned i = 0;  i < nWorkers;  i++) {
+    worker * w = new worker;
+    pthread_mutex_init(&w->lock, 0);
+    _workers.push_back(w);
+  }
+
+  pthread_mutex_init(&_idleLock, 0);
+  pthread_cond_init(&_idleCond, 0);
+}
+
+workPool::~workPool()
+{
+  for (unsigned i = 0;  i < _workers.size();  i++) {
+    worker * w = _workers[i];
+
+    while (! w->tasks.empty()) {
+      delete w->tasks.front();
+      w->tasks.pop_front();
+    }
+    pthread_mutex_destroy(&w->lock);
+    delete w;
+  }
+
+  pthread_cond_destroy(&_idleCond);
+  pthread_mutex_destroy(&_idleLock);
+}
+
+void workPool::push(
+  poolTask * t,
+  unsigned   from
+) {
+  // Queues the task "t" at the back of the deque owned by the worker
+  // "from", then wakes up a sleeping worker (if any) that may steal
+  // it.  The pending counter is incremented before the task becomes
+  // visible, so that the pool can't be seen as empty in between.
+
+  worker * w = _workers[from % _workers.size()];
+
+  __sync_add_and_fetch(&_pending, 1);
+
+  pthread_mutex_lock(&w->lock);
+  w->tasks.push_back(t);
+  pthread_mutex_unlock(&w->lock);
+
+  pthread_mutex_lock(&_idleLock);
+  _generation++;
+  if (_sleeping > 0) pthread_cond_signal(&_idleCond);
+  pthread_mutex_unlock(&_idleLock);
+}
+
+void workPool::run()
+{
+  // The calling thread acts as worker 0; the other ones are started
+  // here and joined when all the work has been done.
+
+  std::vector<pthread_t> threads;
+  std::vector<startInfo> info(_workers.size());
+
+  for (unsigned i = 1;  i < _workers.size();  i++) {
+    pthread_t tid;
+
+    info[i].pool  = this;
+    info[i].index = i;
+    if (pthread_create(&tid, 0, threadMain, &info[i]) != 0) {
+      std::cerr << ltx::progname << ": cannot start worker thread "
+                << i << ", continuing with " << i << '\n';
+      break;
+    }
+    threads.push_back(tid);
+  }
+
+  workLoop(0);
+
+  for (unsigned i = 0;  i < threads.size();  i++) {
+    pthread_join(threads[i], 0);
+  }
+}
+
+void * workPool::threadMain(
+  void * arg
+) {
+  startInfo * pSI = static_cast<startInfo *>(arg);
+  pSI->pool->workLoop(pSI->index);
+  return 0;
+}
+
+void workPool::workLoop(
+  unsigned me
+) {
+  for (;;) {
+    unsigned long seen;
+
+    pthread_mutex_lock(&_idleLock);
+    seen = _generation;
+    pthread_mutex_unlock(&_idleLock);
+
+    poolTask * t = popLocal(me);
+    if (t == 0) t = steal(me);
+
+    if (t != 0) {
+      t->run(*this, me);
+      delete t;
+
+      if (__sync_sub_and_fetch(&_pending, 1) == 0) {
+        pthread_mutex_lock(&_idleLock);
+        pthread_cond_broadcast(&_idleCond);
+        pthread_mutex_unlock(&_idleLock);
+      }
+      continue;
+    }
+
+    // Nothing to do: sleeps until some task is pushed, or until the
+    // last pending task completes.
+
+    pthread_mutex_lock(&_idleLock);
+    while (_generation == seen  &&  _pending != 0) {
+      _sleeping++;
+      pthread_cond_wait(&_idleCond, &_idleLock);
+      _sleeping--;
+    }
+    bool done = (_pending == 0);
+    pthread_mutex_unlock(&_idleLock);
+
+    if (done) return;
+  }
+}
+
+poolTask * workPool::popLocal(
+  unsigned me
+) {
+  worker   * w = _workers[me];
+  poolTask * t = 0;
+
+  pthread_mutex_lock(&w->lock);
+  if (! w->tasks.empty()) {
+    t = w->tasks.back();
+    w->tasks.pop_back();
+  }
+  pthread_mutex_unlock(&w->lock);
+
+  return t;
+}
+
+poolTask * workPool::steal(
+  unsigned me
+) {
+  // Visits the other workers in round-robin order, starting from the
+  // next one, and takes the oldest task of the first non-empty deque.
+
+  unsigned n = _workers.size();
+
+  for (unsigned k = 1;  k < n;  k++) {
+    worker   * w = _workers[(me + k) % n];
+    poolTask * t = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (! w->tasks.empty()) {
+      t = w->tasks.front();
+      w->tasks.pop_front();
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    if (t != 0) return t;
+  }
+
+  return 0;
+}
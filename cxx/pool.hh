@@ -0,0 +1,80 @@
+// -------------------------------------------------------------------
+//
+//     $Id$
+//
+// -------------------------------------------------------------------
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <deque>
+#include <vector>
+
+extern "C" {
+  #include <pthread.h>
+}
+
+// A small work-stealing thread pool.
+//
+// - Every worker owns a double-ended queue of tasks: it pushes and
+//   pops its own work at the back (so that a depth-first traversal
+//   stays cache friendly), while idle workers steal from the front
+//   of the other queues (taking the oldest, hence usually biggest,
+//   pieces of work).
+//
+// - A task may spawn further tasks by calling "push" with the index
+//   of the worker that is running it; "run" returns when every task
+//   has been executed and no more are pending.
+//
+// - Task objects are allocated by the caller with "operator new" and
+//   are deleted by the pool after their execution.
+
+class workPool;
+
+class poolTask {
+public:
+  virtual ~poolTask() {}
+  virtual void run(workPool &, unsigned) = 0;
+};
+
+class workPool {
+private:
+  struct worker {
+    pthread_mutex_t        lock;
+    std::deque<poolTask *> tasks;
+  };
+
+  std::vector<worker *> _workers;
+  pthread_mutex_t       _idleLock;
+  pthread_cond_t        _idleCond;
+  unsigned long         _pending;     // Tasks queued or running
+  unsigned              _sleeping;
+  unsigned long         _generation;  // Bumped by every push
+
+  struct startInfo {
+    workPool * pool;
+    unsigned   index;
+  };
+
+  static void * threadMain(void *);
+  void          workLoop(unsigned);
+  poolTask *    popLocal(unsigned);
+  poolTask *    steal(unsigned);
+
+  // Prevents any use of the copy constructor and of the assignment
+  // operator
+
+  workPool & operator = (const workPool & rhs);
+  workPool(const workPool & rhs);
+
+public:
+  workPool(unsigned);
+  ~workPool();
+
+  unsigned size() const { return _workers.size(); }
+
+  void push(poolTask *, unsigned);
+  void run();
+};
+
+#endif // POOL_H_
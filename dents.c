@@ -0,0 +1,246 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Bulk directory reader: see dents.h .  A Dents instance reads one
+  directory at a time, and must be used by one thread at a time; the
+  directory file descriptor stays owned by the caller.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#include "dents.h"
+
+#if defined(__linux__) && !defined(NO_GETDENTS)
+#include <sys/syscall.h>
+#if defined(SYS_getdents64)
+#define HAVE_GETDENTS 1
+#include <stdint.h>
+#endif
+#endif
+
+#if defined(HAVE_GETDENTS)
+
+/**
+ | The record returned by the kernel (struct linux_dirent64, that the
+ | C library does not export); "pos" and "end" delimit the records of
+ | the buffer not yet handed out.  The name is at offset 19 of the
+ | record, so DENTS_BEHIND bytes before it are always in the buffer.
+**/
+
+typedef struct sLinuxDirent64 {
+  uint64_t       d_ino;
+  int64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[1];
+} LinuxDirent64;
+
+struct sDents {
+  int     fd;
+  char   *buf;
+  size_t  size;
+  size_t  pos;
+  size_t  end;
+};
+
+Dents *dentsOpen(
+  size_t size
+){
+
+  /**
+   | Creates a reader with a buffer of "size" bytes (0 for the default,
+   | DENTS_BUFFER).  Returns 0 if out of memory.
+  **/
+
+  Dents *pD;
+
+  if (size == 0)        size = DENTS_BUFFER;
+  if (size < DENTS_MIN) size = DENTS_MIN;
+
+  if ((pD = malloc(sizeof(Dents))) == 0) {
+    return 0;
+  }
+  if ((pD->buf = malloc(size)) == 0) {
+    free(pD);
+    return 0;
+  }
+  pD->fd   = -1;
+  pD->size = size;
+  pD->pos  = 0;
+  pD->end  = 0;
+  return pD;
+}
+
+int dentsStart(
+  Dents *pD,
+  int    dirFd
+){
+
+  /**
+   | Starts reading the directory open as "dirFd", from its current
+   | position.  Returns 0, or -1 (with errno set) on failure.
+  **/
+
+  pD->fd  = dirFd;
+  pD->pos = 0;
+  pD->end = 0;
+  return 0;
+}
+
+long dentsBatch(
+  Dents      *pD,
+  DentsEntry *ents,
+  size_t      max
+){
+
+  /**
+   | Gets in "ents" the next entries of the directory, up to "max" of
+   | them, all from the current buffer; refills the buffer only when
+   | it has been exhausted.  Returns the number of entries; 0 at the
+   | end of the directory; -1 (with errno set) on failure.
+  **/
+
+  size_t n = 0;
+
+  if (pD->pos >= pD->end) {
+    long got;
+
+    do {
+      got = syscall(SYS_getdents64, pD->fd, pD->buf, pD->size);
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0) return got < 0 ? -1 : 0;
+    pD->pos = 0;
+    pD->end = got;
+  }
+
+  while (n < max && pD->pos < pD->end) {
+    LinuxDirent64 *pR = (LinuxDirent64 *) (pD->buf + pD->pos);
+    DentsEntry    *pE = &ents[n++];
+
+    pD->pos += pR->d_reclen;
+
+    pE->name = pR->d_name;
+    pE->len  = strlen(pR->d_name);
+    pE->ino  = pR->d_ino;
+    pE->type = pR->d_type;
+  }
+  return n;
+}
+
+void dentsClose(
+  Dents *pD
+){
+  if (pD == 0) return;
+  free(pD->buf);
+  free(pD);
+}
+
+#else  /* ! HAVE_GETDENTS */
+
+/**
+ | The portable version: a directory stream is opened on a duplicate
+ | of the caller's descriptor, since closedir(3) closes it.  The names
+ | of a batch are copied in "buf", each one DENTS_BEHIND bytes after
+ | the end of the previous one.
+**/
+
+struct sDents {
+  DIR    *dir;
+  char   *buf;
+  size_t  size;
+};
+
+Dents *dentsOpen(
+  size_t size
+){
+  Dents *pD;
+
+  if (size == 0)        size = DENTS_BUFFER;
+  if (size < DENTS_MIN) size = DENTS_MIN;
+
+  if ((pD = calloc(1, sizeof(Dents))) == 0) {
+    return 0;
+  }
+  if ((pD->buf = calloc(1, size)) == 0) {
+    free(pD);
+    return 0;
+  }
+  pD->size = size;
+  return pD;
+}
+
+int dentsStart(
+  Dents *pD,
+  int    dirFd
+){
+  int fd;
+
+  if (pD->dir != 0) {
+    closedir(pD->dir);
+    pD->dir = 0;
+  }
+  if ((fd = dup(dirFd)) < 0) return -1;
+  if ((pD->dir = fdopendir(fd)) == 0) {
+    close(fd);
+    return -1;
+  }
+  return 0;
+}
+
+long dentsBatch(
+  Dents      *pD,
+  DentsEntry *ents,
+  size_t      max
+){
+  size_t n = 0, pos = DENTS_BEHIND;
+  size_t room = sizeof(((struct dirent *) 0)->d_name);
+
+  /**
+   | Stops before an entry that might not fit in the buffer: one of the
+   | largest size always does, in a buffer of DENTS_MIN bytes.
+  **/
+
+  while (n < max && pos + room <= pD->size) {
+    struct dirent *pDe;
+    DentsEntry    *pE;
+    size_t         len;
+
+    errno = 0;
+    if ((pDe = readdir(pD->dir)) == 0) {
+      if (errno != 0 && n == 0) return -1;
+      break;
+    }
+
+    len      = strlen(pDe->d_name);
+    pE       = &ents[n++];
+    memcpy(pD->buf + pos, pDe->d_name, len + 1);
+    pE->name = pD->buf + pos;
+    pE->len  = len;
+    pE->ino  = pDe->d_ino;
+    pE->type = pDe->d_type;
+    pos     += len + 1 + DENTS_BEHIND;
+  }
+  return n;
+}
+
+void dentsClose(
+  Dents *pD
+){
+  if (pD == 0) return;
+  if (pD->dir != 0) closedir(pD->dir);
+  free(pD->buf);
+  free(pD);
+}
+
+#endif /* HAVE_GETDENTS */
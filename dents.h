@@ -0,0 +1,63 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Bulk directory reader.  On Linux a directory is read with raw
+  getdents64(2) calls into a single large buffer, so that even a huge
+  directory takes a handful of system calls; every entry is handed to
+  the caller as a view into that buffer (name, length, inode, type),
+  without copying it and without any allocation.  The entries are
+  returned in batches, all of them from the same buffer fill, so that
+  they can be classified together (see sufx.h).  Elsewhere readdir(3)
+  is used, with the same interface.
+*/
+
+#ifndef DENTS_H_
+#define DENTS_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - DENTS_BUFFER: default size of the buffer, in bytes;
+ | - DENTS_MIN: smallest buffer accepted (a few maximal entries);
+ | - DENTS_BEHIND: number of bytes before every name that are part of
+ |   the buffer, and may be read (but not relied upon): this allows a
+ |   vector load of the last 16 bytes of even the shortest name.
+**/
+
+#define DENTS_BUFFER (256 * 1024)
+#define DENTS_MIN    4096
+#define DENTS_BEHIND   16
+
+/**
+ | A directory entry: "name" is null terminated, and is valid only
+ | until the next call to dentsBatch() or dentsStart(); "type" is one
+ | of the DT_xxx values of <dirent.h>, DT_UNKNOWN if the file system
+ | does not tell.
+**/
+
+typedef struct sDentsEntry {
+  const char    *name;
+  size_t         len;
+  unsigned long  ino;
+  int            type;
+} DentsEntry;
+
+typedef struct sDents Dents;
+
+Dents *dentsOpen(size_t);
+int    dentsStart(Dents *, int);
+long   dentsBatch(Dents *, DentsEntry *, size_t);
+void   dentsClose(Dents *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DENTS_H_ */
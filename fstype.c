@@ -0,0 +1,319 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  File system policies: see fstype.h .  The policies are few, and kept
+  in a small table, searched linearly: they are only looked at when a
+  mount point is crossed.  The concurrency levels are enforced with a
+  counter for every type, under a single lock.
+*/
+
+#define _GNU_SOURCE             /* O_PATH */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/vfs.h>
+
+#include "fstype.h"
+
+/**
+ | - FS_POLICIES: the number of types that may be named;
+ | - FS_OTHERS: the pseudo-type "*";
+ | - FsKnown: the names of the most common types, with their magic
+ |   numbers (from linux/magic.h);
+ | - FsRule: the policy of a type, and how many threads are scanning
+ |   the file systems of that type;
+ | - FsPolicy: the rules, and the lock (with its condition) guarding
+ |   the counters.
+**/
+
+#define FS_POLICIES 32
+#define FS_OTHERS   0UL
+
+typedef struct sFsKnown {
+  const char    *name;
+  unsigned long  magic;
+} FsKnown;
+
+typedef struct sFsRule {
+  unsigned long magic;
+  int           level;
+  int           busy;
+} FsRule;
+
+struct sFsPolicy {
+  FsRule          rules[FS_POLICIES];
+  int             nRules;
+  pthread_mutex_t lock;
+  pthread_cond_t  freed;
+};
+
+static const FsKnown known[] = {
+  { "9p",       0x01021997UL },
+  { "afs",      0x5346414fUL },
+  { "autofs",   0x00000187UL },
+  { "btrfs",    0x9123683eUL },
+  { "ceph",     0x00c36400UL },
+  { "cgroup2",  0x63677270UL },
+  { "cifs",     0xff534d42UL },
+  { "devpts",   0x00001cd1UL },
+  { "ecryptfs", 0x0000f15fUL },
+  { "ext4",     0x0000ef53UL },
+  { "f2fs",     0xf2f52010UL },
+  { "fuse",     0x65735546UL },
+  { "gpfs",     0x47504653UL },
+  { "iso9660",  0x00009660UL },
+  { "lustre",   0x0bd00bd0UL },
+  { "nfs",      0x00006969UL },
+  { "ntfs",     0x5346544eUL },
+  { "overlay",  0x794c7630UL },
+  { "proc",     0x00009fa0UL },
+  { "ramfs",    0x858458f6UL },
+  { "smb",      0x0000517bUL },
+  { "smb2",     0xfe534d42UL },
+  { "squashfs", 0x73717368UL },
+  { "sysfs",    0x62656572UL },
+  { "tmpfs",    0x01021994UL },
+  { "vfat",     0x00004d44UL },
+  { "xfs",      0x58465342UL },
+  { "zfs",      0x2fc12fc1UL },
+  { 0,          0UL }
+};
+
+static FsRule *findRule(const FsPolicy *, unsigned long);
+static int     parseOne(const char *, size_t, unsigned long *, int *);
+
+FsPolicy *fsPolicyNew(void)
+{
+
+  /**
+   | Returns empty policies (every type allowed), or 0 if out of memory.
+  **/
+
+  FsPolicy *pP;
+
+  if ((pP = calloc(1, sizeof(FsPolicy))) == 0) {
+    return 0;
+  }
+  pthread_mutex_init(&pP->lock, 0);
+  pthread_cond_init(&pP->freed, 0);
+  return pP;
+}
+
+int fsPolicySet(
+  FsPolicy   *pP,
+  const char *text
+){
+  while (*text != '\0') {
+    size_t         len = strcspn(text, ",");
+    unsigned long  magic;
+    int            level;
+    FsRule        *pR;
+
+    if (parseOne(text, len, &magic, &level) != 0) {
+      return -1;
+    }
+    if ((pR = findRule(pP, magic)) == 0 || pR->magic != magic) {
+      if (pP->nRules == FS_POLICIES) {
+        return -1;
+      }
+      pR = &pP->rules[pP->nRules++];
+      pR->magic = magic;
+    }
+    pR->level = level;
+
+    text += len;
+    if (*text == ',') text++;
+  }
+  return 0;
+}
+
+int fsPolicyOf(
+  const FsPolicy *pP,
+  unsigned long   magic
+){
+  const FsRule *pR = findRule(pP, magic);
+
+  return pR == 0 ? FS_ALLOW : pR->level;
+}
+
+void fsPolicyEnter(
+  FsPolicy      *pP,
+  unsigned long  magic
+){
+  FsRule *pR = findRule(pP, magic);
+
+  if (pR == 0 || pR->level <= 0) return;
+
+  pthread_mutex_lock(&pP->lock);
+  while (pR->busy >= pR->level) {
+    pthread_cond_wait(&pP->freed, &pP->lock);
+  }
+  pR->busy++;
+  pthread_mutex_unlock(&pP->lock);
+}
+
+void fsPolicyLeave(
+  FsPolicy      *pP,
+  unsigned long  magic
+){
+  FsRule *pR = findRule(pP, magic);
+
+  if (pR == 0 || pR->level <= 0) return;
+
+  pthread_mutex_lock(&pP->lock);
+  pR->busy--;
+  pthread_cond_broadcast(&pP->freed);
+  pthread_mutex_unlock(&pP->lock);
+}
+
+void fsPolicyFree(
+  FsPolicy *pP
+){
+  if (pP == 0) return;
+  pthread_mutex_destroy(&pP->lock);
+  pthread_cond_destroy(&pP->freed);
+  free(pP);
+}
+
+unsigned long fsTypeAt(
+  int         dirFd,
+  const char *name
+){
+
+  /**
+   | An O_PATH descriptor is enough for fstatfs(), and opening one does
+   | not trigger an automount.  Only the low 32 bits of f_type matter:
+   | it is a signed int on some architectures.
+  **/
+
+  struct statfs sF;
+  int           fd = dirFd, ok;
+
+  if (name != 0 && (fd = openat(dirFd, name, O_PATH)) < 0) {
+    return 0UL;
+  }
+  ok = fstatfs(fd, &sF) == 0;
+  if (fd != dirFd) {
+    close(fd);
+  }
+  return ok ? (unsigned long) sF.f_type & 0xffffffffUL : 0UL;
+}
+
+const char *fsTypeName(
+  unsigned long magic
+){
+  int i;
+
+  for (i = 0;   known[i].name != 0;   i++) {
+    if (known[i].magic == magic) {
+      return known[i].name;
+    }
+  }
+  return 0;
+}
+
+static FsRule *findRule(
+  const FsPolicy *pP,
+  unsigned long   magic
+){
+
+  /**
+   | The rule for the type "magic"; or for all the others, if any; 0
+   | if none applies.
+  **/
+
+  FsRule *pOthers = 0;
+  int     i;
+
+  for (i = 0;   i < pP->nRules;   i++) {
+    FsRule *pR = (FsRule *) &pP->rules[i];
+
+    if (pR->magic == magic) {
+      return pR;
+    }
+    if (pR->magic == FS_OTHERS) {
+      pOthers = pR;
+    }
+  }
+  return pOthers;
+}
+
+static int parseOne(
+  const char    *text,
+  size_t         len,
+  unsigned long *pMagic,
+  int           *pLevel
+){
+
+  /**
+   | Parses the "len" characters of "text", a single policy "type=what",
+   | into the magic number of the type (FS_OTHERS for "*") and the
+   | level; returns -1 if not valid.
+  **/
+
+  const char *eq = memchr(text, '=', len);
+  const char *what;
+  size_t      lType, lWhat;
+  int         i;
+
+  if (eq == 0 || eq == text) {
+    return -1;
+  }
+  lType = eq - text;
+  what  = eq + 1;
+  lWhat = len - lType - 1;
+
+  if (lType == 1 && *text == '*') {
+    *pMagic = FS_OTHERS;
+  } else if (lType > 2 && text[0] == '0' &&
+             (text[1] == 'x' || text[1] == 'X')) {
+    char *end;
+
+    *pMagic = strtoul(text + 2, &end, 16);
+    if (end != eq || *pMagic == FS_OTHERS) {
+      return -1;
+    }
+  } else {
+    for (i = 0;   known[i].name != 0;   i++) {
+      if (strlen(known[i].name) == lType &&
+          strncmp(known[i].name, text, lType) == 0) {
+        break;
+      }
+    }
+    if (known[i].name == 0) {
+      return -1;
+    }
+    *pMagic = known[i].magic;
+  }
+
+  if (lWhat == 4 && strncmp(what, "skip", 4) == 0) {
+    *pLevel = FS_SKIP;
+  } else if (lWhat == 5 && strncmp(what, "allow", 5) == 0) {
+    *pLevel = FS_ALLOW;
+  } else {
+    long n = 0;
+
+    if (lWhat == 0 || lWhat > 6) {
+      return -1;
+    }
+    for (i = 0;   i < (int) lWhat;   i++) {
+      if (!isdigit((unsigned char) what[i])) {
+        return -1;
+      }
+      n = 10 * n + (what[i] - '0');
+    }
+    if (n < 1) {
+      return -1;
+    }
+    *pLevel = (int) n;
+  }
+  return 0;
+}
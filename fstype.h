@@ -0,0 +1,62 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  File system policies: what to do, while descending a tree, with the
+  file systems of a given type (as told by statfs(2)) mounted inside
+  it.  A type may be skipped (e.g. autofs, so that no automount is
+  triggered), allowed, or allowed with a concurrency level: at most
+  that number of requests in flight, and of threads scanning, on the
+  file systems of that type (e.g. to spare an NFS server).
+
+  A policy is written "type=skip", "type=allow" or "type=n"; several
+  may be given at once, separated by commas.  The type is a name (see
+  fsTypeName()), its magic number (e.g. "0x6969"), or "*" for all the
+  types not otherwise named.
+*/
+
+#ifndef FSTYPE_H_
+#define FSTYPE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - the policies of a type: skipped, allowed without limits, or (if
+ |   positive) the concurrency level;
+ | - fsPolicySet() adds the policies in a string, and returns -1 if it
+ |   is not valid (or if too many types are named);
+ | - fsPolicyOf() is the policy of a type, FS_ALLOW if not named;
+ | - fsPolicyEnter() waits until a thread may scan a file system of
+ |   the given type, fsPolicyLeave() tells that it is done; both do
+ |   nothing for the types without a concurrency level.  Once set, the
+ |   policies may be shared by any number of threads;
+ | - fsTypeAt() is the type of the file system of "name", relative to
+ |   the directory open as the first argument (or of the directory
+ |   itself, if "name" is 0), 0 if unknown: the directory is not
+ |   opened for reading, so that no automount is triggered;
+ | - fsTypeName() is the name of a type, 0 if unknown.
+**/
+
+#define FS_ALLOW (-1)
+#define FS_SKIP    0
+
+typedef struct sFsPolicy FsPolicy;
+
+FsPolicy     *fsPolicyNew(void);
+int           fsPolicySet(FsPolicy *, const char *);
+int           fsPolicyOf(const FsPolicy *, unsigned long);
+void          fsPolicyEnter(FsPolicy *, unsigned long);
+void          fsPolicyLeave(FsPolicy *, unsigned long);
+void          fsPolicyFree(FsPolicy *);
+unsigned long fsTypeAt(int, const char *);
+const char   *fsTypeName(unsigned long);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FSTYPE_H_ */
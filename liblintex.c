@@ -0,0 +1,2870 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  liblintex: see liblintex.h .  For every directory, the TeX-related
+  files are put in a list for each relevant extension (the first one
+  holding the .tex files); then the files of every .tex are linked to
+  it, and those newer than it are removed.  The lists are released as
+  a whole when the directory is done; the subdirectories, if any, are
+  cleaned afterwards.  With a memory budget, the lists that outgrow it
+  are spilled to sorted runs, and the families decided as the runs are
+  merged.
+*/
+
+#define _GNU_SOURCE             /* openat() and friends, d_type, statx() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "liblintex.h"
+#include "arena.h"              /* Bump allocator */
+#include "dents.h"              /* Bulk directory reader */
+#include "fstype.h"             /* File system policies */
+#include "mstat.h"              /* Metadata backends */
+#include "prune.h"              /* Subdirectories not visited */
+#include "spill.h"              /* Spilled entries */
+#include "sufx.h"               /* Suffix classifier */
+#include "unlinkq.h"            /* Asynchronous deletion */
+#include "visited.h"            /* Directories already cleaned */
+
+/**
+ | - SUB_WINDOW: with an asynchronous metadata backend, the number of
+ |   subdirectories that are opened in a single batch;
+ | - FD_BUDGET: but no more than these directories are kept open;
+ | - DIR_HOLD: the ancestors of the directory being scanned are kept
+ |   open while it is, but no more than these: deeper directories are
+ |   closed before descending, and opened again afterwards through the
+ |   ".." of the subdirectory (see reopenDir());
+ | - BATCH: number of directory entries classified together.
+**/
+
+#define TRUE         1
+#define FALSE        0
+#define SUB_WINDOW  16
+#define FD_BUDGET  256
+#define DIR_HOLD   128
+#define BATCH      256
+
+/**
+ | - Froot: the root of a linked list structure, where file names having a
+ |     given extension (pointed to by Froot.extension) will be stored;
+ |     these linked lists are also used to store directory names (with fake
+ |     extension strings).
+ | - Fnode: an entry in the linked list of the file names; contains the
+ |     file modification time and size, the file name and a pointer to
+ |     the next node.
+ |     While a directory is cleaned, "related" links every .tex file to
+ |     the files having the same name and a different extension (in
+ |     the order of the lists), and these to each other; "extension" is
+ |     then the extension of the latter.
+ |     As a side note, the so called 'struct hack', here used to store the
+ |     file name, is not guaranteed to work by the current C ANSI standard;
+ |     but no environment/compiler where it does not work is currently
+ |     known.
+ | - Fentry: a directory entry whose metadata are still to be obtained
+ |     (or a subdirectory, kept in order with them), while a directory
+ |     is scanned: the list where the file will be inserted, if any,
+ |     and the length of the matching extension; whether the extension
+ |     is to be kept; and where its name has been copied in the buffer
+ |     of the names put aside.  The results are in the parallel MstatReq
+ |     array.
+**/
+
+typedef struct sFroot {
+  char *extension;
+  struct sFnode *firstNode;
+  struct sFnode *lastNode;
+} Froot;
+
+typedef struct sFnode {
+  time_t mTime;
+  off_t size;
+  struct sFnode *next;
+  struct sFnode *related;
+  char *extension;
+  int write;
+  char name[1];
+} Fnode;
+
+typedef struct sFentry {
+  Froot  *pTT;
+  size_t  lExt;
+  int     kept;
+  size_t  nameOff;
+} Fentry;
+
+/**
+ | - LintexRules: the extensions of the files to be removed, ".tex"
+ |   first, the identifier of an extension in "rules" being its index
+ |   in "exts"; the extensions to be kept; the backup trailer; and all
+ |   of them compiled for the lookups.  Then the patterns of the names
+ |   of the subdirectories not to be visited, and the marker files that
+ |   tell the same, both compiled in "prune".  Rules loaded from a file
+ |   are mapped ("map", of "mapSize" bytes): the strings and the
+ |   compiled rules are used in place, and "exts", "keeps", "prunes"
+ |   and "markers" share a single block of pointers.
+ | - RulesHeader: the header of a rules file, in the byte order of the
+ |   machine that wrote it: a magic string (with the format version), a
+ |   known value telling the byte order, the number of extensions to
+ |   be removed and kept, of prune patterns and markers, and the size
+ |   of the strings and of the compiled rules that follow.  The
+ |   strings, each null terminated, are the stamp, the backup trailer,
+ |   the extensions, the patterns and the markers; they are padded to
+ |   RULES_ALIGN bytes, so that the compiled rules are aligned when
+ |   mapped.
+**/
+
+struct sLintexRules {
+  char  **exts;
+  int     nExts;
+  int     mExts;
+  char  **keeps;
+  int     nKeeps;
+  int     mKeeps;
+  char   *bExt;
+  size_t  n_bExt;
+  Rules  *rules;
+  char  **prunes;
+  int     nPrunes;
+  int     mPrunes;
+  char  **markers;
+  int     nMarkers;
+  int     mMarkers;
+  Prune  *prune;
+  int     compiled;
+  void   *map;
+  size_t  mapSize;
+};
+
+#define RULES_MAGIC "LTXRUL\0\2"
+#define RULES_ORDER 0x01020304UL
+#define RULES_ALIGN 8
+
+typedef struct sRulesHeader {
+  char     magic[8];
+  uint32_t order;
+  uint32_t nExts;
+  uint32_t nKeeps;
+  uint32_t nPrunes;
+  uint32_t nMarkers;
+  uint32_t lStrings;
+  uint32_t lImage;
+} RulesHeader;
+
+/**
+ | - Lintex: a cleaner.
+ |   - protoTree: Froot's of the file names having extensions relevant to
+ |     TeX, terminated by a null extension; ".tex" extensions are
+ |     pointed to by protoTree[0].
+ |   - mstat: the metadata backend, and "uring" whether io_uring was
+ |     asked for;
+ |   - openDirs, preOpened: number of directories currently being
+ |     scanned, and of those opened in advance, waiting for their turn;
+ |     upWanted whether the directory that called clean() has been
+ |     closed, and upFd where its subdirectory leaves it open again;
+ |   - unlinkQ: the asynchronous deletion queue, if any, and unlinkDir
+ |     the current directory as known to the queue;
+ |   - visited: the directories already cleaned;
+ |   - maxDepth: how deep to descend below the directories given (-1:
+ |     no limit), and depth how deep the current directory is;
+ |   - fsPolicy: the file system policies, if any; rootDev the device
+ |     of the directory given, and level the concurrency level on the
+ |     file system of the current directory (FS_ALLOW: no limit);
+ |   - maxMemory: the memory budget of a directory (0: none), and spill
+ |     where its TeX-related files go once their lists would take more;
+ |     tree the lists of the directory being scanned, nodesMark where
+ |     their nodes start in treeNodes, treeBytes their size, and spilled
+ |     whether the files are being spilled instead;
+ |   - outOfMemory: whether memory ran out while cleaning (everything
+ |     then stops as soon as possible), and told whether the hook has
+ |     been told (see failed());
+ |   - treeNodes: storage of the lists of the TeX-related files of the
+ |     directory being cleaned (released as a whole afterwards); and
+ |     dirNodes of the lists of the directories still to be scanned, that
+ |     is used as a stack, every directory releasing what it allocated.
+**/
+
+struct sLintex {
+  const LintexRules *pR;
+  int                flags;
+  LintexHook        *hook;
+  void              *arg;
+  FILE              *trace;
+  Froot             *protoTree;
+  Mstat             *mstat;
+  int                uring;
+  Dents             *dents;
+  int                openDirs;
+  int                preOpened;
+  int                upWanted;
+  int                upFd;
+  UnlinkQ           *unlinkQ;
+  UqDir             *unlinkDir;
+  Visited           *visited;
+  int                maxDepth;
+  int                depth;
+  FsPolicy          *fsPolicy;
+  dev_t              rootDev;
+  int                level;
+  size_t             maxMemory;
+  Spill             *spill;
+  Froot             *tree;
+  ArenaMark          nodesMark;
+  size_t             treeBytes;
+  int                spilled;
+  int                outOfMemory;
+  int                told;
+  ScanIdx           *scanIdx;
+  Stats             *stats;
+  Arena             *treeNodes;
+  Arena             *dirNodes;
+};
+
+const char *const lintexRemoveExts[] = {
+  ".aux",
+  ".bbl",
+  ".bcf",
+  ".blg",
+  ".dvi",
+  ".idx",
+  ".ilg",
+  ".ind",
+  ".lof",
+  ".log",
+  ".lot",
+  ".nav",
+  ".out",
+  ".pdf",
+  ".ps",
+  ".snm",
+  ".synctex.gz",
+  ".thm",
+  ".toc",
+  ".toc.old",
+  ".xyc",
+  0
+};
+
+const char *const lintexKeepExts[] = {
+  ".pdf",
+  ".ps",
+  ".dvi",
+  0
+};
+
+const char *const lintexPruneDirs[] = {
+  ".git",
+  ".hg",
+  ".svn",
+  "node_modules",
+  0
+};
+
+const char *const lintexPruneMarkers[] = {
+  "CACHEDIR.TAG",
+  ".lintexignore",
+  0
+};
+
+/**
+ | Procedure prototypes (in alphabetical order)
+**/
+
+static void   addFile(Lintex *, int, const char *, char *, size_t, Froot *,
+                      int, time_t, off_t);
+static int    addString(char ***, int *, int *, const char *);
+static int    badStrings(const char *, size_t, size_t);
+static Froot *buildTree(Lintex *, int, const char *, const struct stat *,
+                        Froot *);
+static void   clean(Lintex *, int, const char *, int);
+static void   cleanRecorded(Lintex *, int, const char *, const char *);
+static int    compareNames(const void *, const void *);
+static void   crossMounts(Lintex *, int, const char *, dev_t, MstatReq *,
+                          int *, int);
+static void   done(Lintex *, SinkRecord *, const char *, int);
+static int    emit(Lintex *, int, SinkRecord *, const char *, int, int);
+static void   examineSpill(Lintex *, Froot *, int, const char *);
+static void   examineTree(Lintex *, Froot *, int, const char *);
+static int    failed(Lintex *, const char *);
+static void   handUp(Lintex *, int);
+static unsigned long hashName(const char *);
+static int    insertNode(Arena *, const char *, size_t, time_t, off_t, int,
+                         Froot *);
+static void   judge(Lintex *, int, const char *, const char *, const char *,
+                    const char *, time_t, time_t, off_t, int);
+static char  *newString(Arena *, const char *, const char *, const char *);
+static void   noMemory(Lintex *);
+static void   nuke(Lintex *, int, const char *, const char *, const char *,
+                   SinkRecord *);
+static void   printTree(Lintex *, Froot *);
+static int    putString(FILE *, const char *, size_t *);
+static void   putsTrace(Lintex *, const char *);
+static void   queued(void *, const char *, const char *, int, int);
+static void   recordEntry(Lintex *, const DentsEntry *);
+static void   releaseTree(Lintex *, Froot *, Arena *, ArenaMark);
+static int    reopenDir(Lintex *, const char *, const struct stat *);
+static int    result(Lintex *);
+static void   settle(Lintex *, int, const char *, MstatReq *, Fentry *,
+                     char *, size_t, Froot *);
+static void   spillTree(Lintex *);
+static void   storeFile(Lintex *, Froot *, const char *, size_t, time_t,
+                        off_t, int);
+static int    takeUp(Lintex *, const struct stat *);
+
+/*-------------------*
+ | The rules         |
+ *-------------------*/
+
+LintexRules *lintexRulesNew(
+  const char *bExt
+){
+
+  /**
+   | Returns new rules, with the backup trailer "bExt" (the empty
+   | string: no backup files) and only the ".tex" extension, to be
+   | completed by lintexRulesAdd() and compiled; or 0 if out of memory.
+  **/
+
+  LintexRules *pR;
+
+  if ((pR = calloc(1, sizeof(LintexRules))) == 0) {
+    return 0;
+  }
+  if ((pR->bExt = malloc(strlen(bExt) + 1)) == 0 ||
+      (pR->rules = rulesNew()) == 0 ||
+      (pR->prune = pruneNew()) == 0 ||
+      lintexRulesAdd(pR, ".tex", RULE_REMOVE) != 0) {
+    lintexRulesFree(pR);
+    return 0;
+  }
+  strcpy(pR->bExt, bExt);
+  pR->n_bExt = strlen(bExt);
+  return pR;
+}
+
+int lintexRulesAdd(
+  LintexRules *pR,
+  const char  *ext,
+  int          kind
+){
+
+  /**
+   | Adds the extension "ext" of the files to be removed (RULE_REMOVE)
+   | or kept (RULE_KEEP).  Returns -1 if out of memory, or if the rules
+   | have already been compiled.
+  **/
+
+  if (pR->compiled) {
+    return -1;
+  }
+  if (kind == RULE_KEEP) {
+    return rulesAdd(pR->rules, ext, RULE_KEEP, 0) < 0 ||
+           addString(&pR->keeps, &pR->nKeeps, &pR->mKeeps, ext) != 0 ? -1 : 0;
+  }
+  return rulesAdd(pR->rules, ext, RULE_REMOVE, pR->nExts) < 0 ||
+         addString(&pR->exts, &pR->nExts, &pR->mExts, ext) != 0 ? -1 : 0;
+}
+
+int lintexRulesPrune(
+  LintexRules *pR,
+  const char  *text,
+  int          what
+){
+
+  /**
+   | Adds the pattern "text" of the names of the subdirectories not to
+   | be visited (PRUNE_NAME), or the name of a marker file telling the
+   | same (PRUNE_MARKER).  Returns as lintexRulesAdd().
+  **/
+
+  if (pR->compiled || pruneAdd(pR->prune, text, what) != 0) {
+    return -1;
+  }
+  if (what == PRUNE_MARKER) {
+    return addString(&pR->markers, &pR->nMarkers, &pR->mMarkers, text);
+  }
+  return addString(&pR->prunes, &pR->nPrunes, &pR->mPrunes, text);
+}
+
+int lintexRulesCompile(
+  LintexRules *pR
+){
+
+  /**
+   | Compiles the rules: afterwards, they may no more be changed.
+   | Returns -1 if out of memory.
+  **/
+
+  if (pR->compiled) {
+    return 0;
+  }
+  if (pR->n_bExt != 0 &&
+      rulesAdd(pR->rules, pR->bExt, RULE_BACKUP, 0) < 0) {
+    return -1;
+  }
+  if (rulesCompile(pR->rules) != 0 || pruneCompile(pR->prune) != 0) {
+    return -1;
+  }
+  pR->compiled = 1;
+  return 0;
+}
+
+int lintexRulesSave(
+  const LintexRules *pR,
+  const char        *fileName,
+  const char        *stamp
+){
+
+  /**
+   | Writes the compiled rules in the file "fileName" (in a temporary
+   | file, renamed over the old one), together with "stamp", that
+   | describes whatever they were made from (see lintexRulesLoad()).
+   | Returns 0, or -1 (with errno set) if the file could not be
+   | written.
+  **/
+
+  static const char pad[RULES_ALIGN];
+  RulesHeader  header;
+  char        *image = 0, *tmp = 0;
+  size_t       lStrings = 0;
+  int          i, fd, err = 0;
+  FILE        *fp;
+
+  if (! pR->compiled) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, RULES_MAGIC, sizeof(header.magic));
+  header.order  = RULES_ORDER;
+  header.nExts  = pR->nExts;
+  header.nKeeps   = pR->nKeeps;
+  header.nPrunes  = pR->nPrunes;
+  header.nMarkers = pR->nMarkers;
+  header.lImage   = rulesImage(pR->rules, 0);
+
+  if ((image = malloc(header.lImage)) == 0 ||
+      (tmp = malloc(strlen(fileName) + 8)) == 0) {
+    err = ENOMEM;
+  } else {
+    rulesImage(pR->rules, image);
+    sprintf(tmp, "%s.XXXXXX", fileName);
+    if ((fd = mkstemp(tmp)) < 0) {
+      err = errno;
+    } else if ((fp = fdopen(fd, "wb")) == 0) {
+      err = errno;
+      close(fd);
+      unlink(tmp);
+    } else {
+
+      /**
+       | The header is written again, once the length of the strings is
+       | known.
+      **/
+
+      int bad = fwrite(&header, sizeof(header), 1, fp) != 1 ||
+                putString(fp, stamp, &lStrings) != 0 ||
+                putString(fp, pR->bExt, &lStrings) != 0;
+
+      for (i = 0;   !bad && i < pR->nExts;   i++) {
+        bad = putString(fp, pR->exts[i], &lStrings) != 0;
+      }
+      for (i = 0;   !bad && i < pR->nKeeps;   i++) {
+        bad = putString(fp, pR->keeps[i], &lStrings) != 0;
+      }
+      for (i = 0;   !bad && i < pR->nPrunes;   i++) {
+        bad = putString(fp, pR->prunes[i], &lStrings) != 0;
+      }
+      for (i = 0;   !bad && i < pR->nMarkers;   i++) {
+        bad = putString(fp, pR->markers[i], &lStrings) != 0;
+      }
+      if (!bad && lStrings % RULES_ALIGN != 0) {
+        size_t lPad = RULES_ALIGN - lStrings % RULES_ALIGN;
+
+        bad = fwrite(pad, 1, lPad, fp) != lPad;
+        lStrings += lPad;
+      }
+      header.lStrings = lStrings;
+      if (bad ||
+          fwrite(image, 1, header.lImage, fp) != header.lImage ||
+          fseek(fp, 0L, SEEK_SET) != 0 ||
+          fwrite(&header, sizeof(header), 1, fp) != 1) {
+        err = errno != 0 ? errno : EIO;     /* A short write may not set it */
+      }
+      if (fclose(fp) != 0 && err == 0) {
+        err = errno != 0 ? errno : EIO;
+      }
+      if (err == 0 && rename(tmp, fileName) != 0) {
+        err = errno;
+      }
+      if (err != 0) {
+        unlink(tmp);
+      }
+    }
+  }
+  free(image);
+  free(tmp);
+
+  if (err != 0) {
+    errno = err;
+    return -1;
+  }
+  return 0;
+}
+
+LintexRules *lintexRulesLoad(
+  const char *fileName,
+  const char *stamp
+){
+
+  /**
+   | Returns the compiled rules written in the file "fileName" by
+   | lintexRulesSave(), if they were made from "stamp" too; the file
+   | is mapped, and nothing is copied but the pointers to the strings
+   | (the prune rules, small, are compiled again).  Returns 0 if the
+   | file does not exist, or is stale, damaged or written by another
+   | kind of machine (or if out of memory): the rules have to be made
+   | again.
+  **/
+
+  LintexRules       *pR;
+  const RulesHeader *pH;
+  const char        *strings, *s;
+  struct stat        st;
+  void              *map;
+  size_t             mapSize;
+  int                fd, i, n;
+
+  if ((fd = open(fileName, O_RDONLY)) < 0) {
+    return 0;
+  }
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(RulesHeader)) {
+    close(fd);
+    return 0;
+  }
+  mapSize = st.st_size;
+  map     = mmap(0, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+
+  pH      = map;
+  strings = (const char *) (pH + 1);
+  if (memcmp(pH->magic, RULES_MAGIC, sizeof(pH->magic)) != 0 ||
+      pH->order != RULES_ORDER || pH->nExts == 0 ||
+      pH->lStrings % RULES_ALIGN != 0 ||
+      sizeof(RulesHeader) + (size_t) pH->lStrings + pH->lImage != mapSize ||
+      badStrings(strings, pH->lStrings, 2 + pH->nExts + pH->nKeeps +
+                 pH->nPrunes + pH->nMarkers) ||
+      strcmp(strings, stamp) != 0 ||
+      (pR = calloc(1, sizeof(LintexRules))) == 0) {
+    munmap(map, mapSize);
+    return 0;
+  }
+  pR->map      = map;
+  pR->mapSize  = mapSize;
+  pR->compiled = 1;
+
+  n = pH->nExts + pH->nKeeps + pH->nPrunes + pH->nMarkers;
+  if ((pR->exts = malloc(n * sizeof(char *))) == 0 ||
+      (pR->rules = rulesMap(strings + pH->lStrings, pH->lImage,
+                            pH->nExts)) == 0 ||
+      (pR->prune = pruneNew()) == 0) {
+    lintexRulesFree(pR);
+    return 0;
+  }
+
+  s          = strings + strlen(strings) + 1;
+  pR->bExt   = (char *) s;
+  pR->n_bExt = strlen(s);
+  s         += pR->n_bExt + 1;
+  pR->nExts    = pH->nExts;
+  pR->nKeeps   = pH->nKeeps;
+  pR->nPrunes  = pH->nPrunes;
+  pR->nMarkers = pH->nMarkers;
+  pR->keeps    = pR->exts + pR->nExts;
+  pR->prunes   = pR->keeps + pR->nKeeps;
+  pR->markers  = pR->prunes + pR->nPrunes;
+  for (i = 0;   i < n;   i++) {
+    pR->exts[i] = (char *) s;
+    s          += strlen(s) + 1;
+  }
+
+  for (i = 0;   i < pR->nPrunes + pR->nMarkers;   i++) {
+    if (pruneAdd(pR->prune, pR->prunes[i],
+                 i < pR->nPrunes ? PRUNE_NAME : PRUNE_MARKER) != 0) {
+      lintexRulesFree(pR);
+      return 0;
+    }
+  }
+  pruneCompile(pR->prune);
+  return pR;
+}
+
+int lintexRelevant(
+  const LintexRules *pR,
+  const char        *name,
+  size_t             len
+){
+
+  /**
+   | Tells whether a change to the file "name" may need a cleanup:
+   | i.e., if it has a relevant extension (".tex" included) or is a
+   | backup file.
+  **/
+
+  RulesMatch match;
+
+  rulesMatch(pR->rules, name, len, &match);
+  return match.id >= 0 || (match.backup != 0 && len > match.backup);
+}
+
+unsigned long lintexPrint(
+  const LintexRules *pR,
+  int                flags
+){
+
+  /**
+   | Fingerprint of whatever decides which directory entries are acted
+   | upon, and so recorded in the scan index: the relevant extensions,
+   | those kept, the backup trailer, LINTEX_RECURSE, LINTEX_ALL and
+   | LINTEX_RECORDER.
+  **/
+
+  unsigned long h = hashName(pR->bExt);
+  int           i;
+
+  for (i = 0;   i < pR->nExts;   i++) {
+    h = ((h ^ hashName(pR->exts[i])) * 16777619UL) & 0xffffffffUL;
+  }
+  for (i = 0;   i < pR->nKeeps;   i++) {
+    h = ((h ^ hashName(pR->keeps[i])) * 16777619UL) & 0xffffffffUL;
+  }
+  h = ((h ^ (flags & LINTEX_RECURSE ? 1 : 2)) * 16777619UL) & 0xffffffffUL;
+  h = ((h ^ (flags & LINTEX_ALL ? 3 : 4)) * 16777619UL) & 0xffffffffUL;
+  if (flags & LINTEX_RECORDER) {
+    h = ((h ^ 5) * 16777619UL) & 0xffffffffUL;
+  }
+  return h;
+}
+
+void lintexRulesFree(
+  LintexRules *pR
+){
+  int i;
+
+  if (pR == 0) {
+    return;
+  }
+  rulesFree(pR->rules);
+  pruneFree(pR->prune);
+  if (pR->map != 0) {
+    free(pR->exts);
+    munmap(pR->map, pR->mapSize);
+    free(pR);
+    return;
+  }
+  for (i = 0;   i < pR->nExts;   i++) {
+    free(pR->exts[i]);
+  }
+  for (i = 0;   i < pR->nKeeps;   i++) {
+    free(pR->keeps[i]);
+  }
+  for (i = 0;   i < pR->nPrunes;   i++) {
+    free(pR->prunes[i]);
+  }
+  for (i = 0;   i < pR->nMarkers;   i++) {
+    free(pR->markers[i]);
+  }
+  free(pR->exts);
+  free(pR->keeps);
+  free(pR->prunes);
+  free(pR->markers);
+  free(pR->bExt);
+  free(pR);
+}
+
+/*-------------------*
+ | The cleaner       |
+ *-------------------*/
+
+Lintex *lintexOpen(
+  const LintexRules *pR,
+  int                flags,
+  size_t             dirBuffer,
+  int                jobs,
+  LintexHook        *hook,
+  void              *arg
+){
+
+  /**
+   | Returns a cleaner following the compiled rules "pR", with "flags"
+   | (LINTEX_*); it reads the directories "dirBuffer" bytes at a time
+   | and, if "jobs" is not zero, removes the files with that number of
+   | threads (the removals being reported later).  "hook" is called
+   | with "arg" for everything that happens (if 0, all the files that
+   | have to are removed, silently).  Returns 0 if the resources can't
+   | be obtained.
+  **/
+
+  Lintex *pL;
+  int     i;
+
+  if ((pL = calloc(1, sizeof(Lintex))) == 0) {
+    return 0;
+  }
+  pL->pR    = pR;
+  pL->flags = flags;
+  pL->hook  = hook;
+  pL->arg   = arg;
+  pL->uring = (flags & LINTEX_URING) != 0;
+  pL->maxDepth = -1;
+  pL->level    = FS_ALLOW;
+  pL->upFd     = -1;
+
+  if ((pL->protoTree = calloc(pR->nExts + 1, sizeof(Froot))) == 0 ||
+      (pL->treeNodes = arenaOpen(0)) == 0 ||
+      (pL->dirNodes  = arenaOpen(0)) == 0 ||
+      (pL->mstat = mstatOpen(pL->uring ? MSTAT_URING : MSTAT_SYNC)) == 0 ||
+      (pL->dents = dentsOpen(dirBuffer)) == 0 ||
+      (pL->visited = visitedOpen()) == 0 ||
+      (jobs > 0 &&
+       (pL->unlinkQ = unlinkqOpen(jobs, pL->uring, queued, pL)) == 0)) {
+    lintexClose(pL);
+    return 0;
+  }
+  for (i = 0;   i < pR->nExts;   i++) {
+    pL->protoTree[i].extension = pR->exts[i];
+  }
+  return pL;
+}
+
+void lintexTrace(
+  Lintex *pL,
+  FILE   *fp
+){
+
+  /**
+   | Writes on "fp" (if not 0) a trace of the work, for debugging;
+   | first of all, whether io_uring was asked for and is not available.
+  **/
+
+  pL->trace = fp;
+  if (fp != 0 && pL->uring && mstatKind(pL->mstat) != MSTAT_URING) {
+    fputs("io_uring not available, using synchronous calls.\n", fp);
+  }
+}
+
+void lintexStats(
+  Lintex *pL,
+  Stats  *pS
+){
+
+  /**
+   | Collects the statistics of the work in "pS" (0: none).
+  **/
+
+  pL->stats = pS;
+  mstatStats(pL->mstat, pS);
+  if (pL->unlinkQ != 0) {
+    unlinkqStats(pL->unlinkQ, pS);
+  }
+}
+
+void lintexMaxDepth(
+  Lintex *pL,
+  int     maxDepth
+){
+
+  /**
+   | With LINTEX_RECURSE, descends at most "maxDepth" levels below the
+   | directories given (-1: no limit).
+  **/
+
+  pL->maxDepth = maxDepth;
+}
+
+void lintexFsPolicy(
+  Lintex   *pL,
+  FsPolicy *pP
+){
+
+  /**
+   | With LINTEX_RECURSE, applies the file system policies "pP" (0:
+   | none) to the file systems mounted below the directories given.
+  **/
+
+  pL->fsPolicy = pP;
+}
+
+int lintexStatThreads(
+  Lintex   *pL,
+  unsigned  maxThreads
+){
+
+  /**
+   | Unless io_uring is used, gets the metadata of the entries of a
+   | directory with up to "maxThreads" threads, as many as the latency
+   | calls for (see MSTAT_POOL in mstat.h).  Returns 0, or -1 (errno
+   | ENOMEM) if out of memory.
+  **/
+
+  Mstat *pM;
+
+  if (maxThreads < 2 || mstatKind(pL->mstat) != MSTAT_SYNC) {
+    return 0;
+  }
+  if ((pM = mstatOpen(MSTAT_POOL)) == 0) {
+    errno = ENOMEM;
+    return -1;
+  }
+  mstatThreads(pM, maxThreads);
+  mstatStats(pM, pL->stats);
+  mstatClose(pL->mstat);
+  pL->mstat = pM;
+  return 0;
+}
+
+int lintexMaxMemory(
+  Lintex *pL,
+  size_t  budget
+){
+
+  /**
+   | Keeps the TeX-related files of a directory within about "budget"
+   | bytes (0: no limit): beyond that they are spilled to temporary
+   | files (see spill.h), and the families decided as these are merged
+   | back, sorted by name.  The metadata are also asked for in batches
+   | taking no more than that.  Returns 0, or -1 (errno ENOMEM, no
+   | budget then) if out of memory.
+  **/
+
+  spillClose(pL->spill);
+  pL->spill     = 0;
+  pL->maxMemory = 0;
+  if (budget > 0 && (pL->spill = spillOpen(budget)) == 0) {
+    errno = ENOMEM;
+    return -1;
+  }
+  pL->maxMemory = budget;
+  return 0;
+}
+
+void lintexIndex(
+  Lintex  *pL,
+  ScanIdx *pI
+){
+
+  /**
+   | Uses the scan index "pI" (0: none), opened by the caller with the
+   | fingerprint given by lintexPrint().
+  **/
+
+  pL->scanIdx = pI;
+}
+
+int lintexClean(
+  Lintex     *pL,
+  const char *dirName
+){
+
+  /**
+   | Cleans the directory "dirName" and, with LINTEX_RECURSE, all of
+   | its subdirectories; but not those already cleaned.  "dirName" is
+   | followed even if a symbolic link, the subdirectories only without
+   | LINTEX_NO_FOLLOW.  Returns 0, or -1 (errno ENOMEM) if memory ran
+   | out, and the cleaning was stopped.
+  **/
+
+  pL->outOfMemory = pL->told = FALSE;
+  clean(pL, openat(AT_FDCWD, dirName, O_RDONLY | O_DIRECTORY), dirName,
+        TRUE);
+  return result(pL);
+}
+
+int lintexCleanDir(
+  Lintex     *pL,
+  const char *dirName
+){
+
+  /**
+   | Cleans the directory "dirName" alone (e.g. while watching, when
+   | every directory is cleaned on its own), even if already cleaned.
+   | Returns as lintexClean().
+  **/
+
+  pL->outOfMemory = pL->told = FALSE;
+  clean(pL, openat(AT_FDCWD, dirName, O_RDONLY | O_DIRECTORY), dirName,
+        FALSE);
+  return result(pL);
+}
+
+int lintexCleanFls(
+  Lintex     *pL,
+  const char *flsName
+){
+
+  /**
+   | Cleans from the recorder file "flsName" alone (see LINTEX_RECORDER),
+   | without reading its directory.  Returns as lintexClean().
+  **/
+
+  ArenaMark   mark  = arenaMark(pL->dirNodes);
+  const char *slash = strrchr(flsName, '/');
+  const char *dirName, *name;
+  int         dirFd;
+
+  pL->outOfMemory = pL->told = FALSE;
+  if (slash == 0) {
+    dirName = ".";
+    name    = flsName;
+  } else {
+    char *copy;
+
+    if ((copy = arenaAlloc(pL->dirNodes, slash - flsName + 2)) == 0) {
+      errno = ENOMEM;
+      return -1;
+    }
+    memcpy(copy, flsName, slash - flsName + 1);
+    copy[slash == flsName ? 1 : slash - flsName] = '\0';
+    dirName = copy;
+    name    = slash + 1;
+  }
+
+  if ((dirFd = openat(AT_FDCWD, dirName, O_RDONLY | O_DIRECTORY)) < 0) {
+    SinkRecord rec;
+
+    sinkInit(&rec, dirName, 0, -1, -1);
+    emit(pL, LINTEX_NO_DIR, &rec, 0, -1, errno);
+  } else {
+    statsEnter(pL->stats, STATS_EXAMINE);
+    cleanRecorded(pL, dirFd, dirName, name);
+    failed(pL, dirName);
+    if (pL->unlinkDir != 0) {
+      unlinkqRelease(pL->unlinkQ, pL->unlinkDir);
+      pL->unlinkDir = 0;
+    }
+    close(dirFd);
+  }
+  arenaRelease(pL->dirNodes, mark);
+  return result(pL);
+}
+
+void lintexForget(
+  Lintex *pL
+){
+
+  /**
+   | Forgets the directories already cleaned: lintexClean() cleans them
+   | again (e.g. on the next run of a program that keeps the cleaner).
+  **/
+
+  visitedClear(pL->visited);
+}
+
+void lintexDrain(
+  Lintex *pL
+){
+
+  /**
+   | Waits until all the queued removals, if any, are done and reported.
+  **/
+
+  if (pL->unlinkQ != 0) {
+    unlinkqDrain(pL->unlinkQ);
+  }
+}
+
+void lintexClose(
+  Lintex *pL
+){
+
+  /**
+   | Waits for the queued removals, if any, then releases everything.
+   | With a trace, tells how much memory was used for the file lists.
+  **/
+
+  if (pL == 0) {
+    return;
+  }
+  unlinkqClose(pL->unlinkQ);
+
+  if (pL->trace != 0 && pL->treeNodes != 0 && pL->dirNodes != 0) {
+    ArenaStats sT, sD;
+
+    arenaStats(pL->treeNodes, &sT);
+    arenaStats(pL->dirNodes, &sD);
+    fputs("------------------------------Memory usage\n", pL->trace);
+    fprintf(pL->trace, "Files: %lu blocks, %lu bytes; %lu chunks allocated,"
+            " %lu reused; peak %lu bytes\n", sT.allocs, sT.bytes, sT.chunks,
+            sT.reused, sT.peak);
+    fprintf(pL->trace, "Directories: %lu blocks, %lu bytes; %lu chunks"
+            " allocated, %lu reused; peak %lu bytes\n", sD.allocs, sD.bytes,
+            sD.chunks, sD.reused, sD.peak);
+  }
+
+  arenaClose(pL->treeNodes);
+  arenaClose(pL->dirNodes);
+  spillClose(pL->spill);
+  mstatClose(pL->mstat);
+  dentsClose(pL->dents);
+  visitedClose(pL->visited);
+  free(pL->protoTree);
+  free(pL);
+}
+
+/*------------------------------------------*
+ | The called procedures (in logical order) |
+ *------------------------------------------*/
+
+static void clean(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  int         descend
+){
+
+  /**
+   | Does the job for the directory "dirName", already open as "dirFd"
+   | (if dirFd is negative, the directory could not be opened: errno
+   | tells why).  When cleaning a tree ("descend"), a directory that
+   | has already been cleaned (reached again through a symbolic link, a
+   | bind mount or another target) is skipped.  The device of the
+   | directory given (at depth 0) is recorded, and the concurrency
+   | level of its file system applied.
+   |
+   | Builds a structure holding the TeX-related files, and does the
+   | required cleanup (with LINTEX_RECORDER, from the recorder files
+   | listed in the structure); finally, removes the file structure.
+   | If the list appended to "dirs" has been filled, and "descend" is
+   | set (and the maximum depth not reached), recurse over the tree of
+   | subdirectories: they are opened relative to this one, that is
+   | kept open in the meantime (unless DIR_HOLD directories up the tree
+   | already are: see reopenDir()).  With an asynchronous metadata
+   | backend, up to SUB_WINDOW subdirectories are opened in a batch.  With
+   | LINTEX_ONE_FS or file system policies, the subdirectories that
+   | are mount points are checked first (see crossMounts()); only then
+   | are the others looked at for pruning, as looking for a marker file
+   | inside a mount point would trigger an automount.
+  **/
+
+  Froot     *teXTree;           /* Root node of the TeX-related files  */
+  Froot     *dirs;              /* Subdirectories in this directory    */
+  Fnode     *pFN;               /* Running pointer over subdirectories */
+  ArenaMark  treeMark;          /* Where their storage starts          */
+  ArenaMark  dirsMark;
+  SinkRecord rec;
+  struct stat dirSt;            /* Metadata of the directory           */
+  int        known;             /*   if obtained                       */
+  int        giveUp;            /* Whether the caller was closed       */
+
+  giveUp       = pL->upWanted;
+  pL->upWanted = FALSE;
+  statsEnter(pL->stats, STATS_SCAN);
+
+  known = dirFd >= 0 && fstat(dirFd, &dirSt) == 0;
+  if (known && descend) {
+    switch (visitedAdd(pL->visited, dirSt.st_dev, dirSt.st_ino)) {
+      case 0:
+        if (pL->trace != 0) {
+          fprintf(pL->trace, "* Directory \"%s\" already cleaned\n", dirName);
+        }
+        if (giveUp) {
+          handUp(pL, dirFd);
+        }
+        close(dirFd);
+        return;
+
+      case -1:
+        noMemory(pL);
+        failed(pL, dirName);
+        if (giveUp) {
+          handUp(pL, dirFd);
+        }
+        close(dirFd);
+        return;
+    }
+  }
+  if (known && pL->depth == 0) {
+    pL->rootDev = dirSt.st_dev;
+    pL->level   = pL->fsPolicy == 0 ? FS_ALLOW :
+                  fsPolicyOf(pL->fsPolicy, fsTypeAt(dirFd, 0));
+    if (pL->level == FS_SKIP) {
+      pL->level = FS_ALLOW;     /* The directory given is never skipped */
+    }
+    mstatLimit(pL->mstat, pL->level > 0 ? pL->level : 0);
+  }
+
+  if (dirFd < 0 || dentsStart(pL->dents, dirFd) != 0) {
+    sinkInit(&rec, dirName, 0, -1, -1);
+    emit(pL, LINTEX_NO_DIR, &rec, 0, -1, errno);
+    if (dirFd >= 0) {
+      if (giveUp) {
+        handUp(pL, dirFd);
+      }
+      close(dirFd);
+    }
+    return;
+  }
+  pL->openDirs++;
+  statsAdd(pL->stats, STATS_DIRS, 1.0);
+
+  dirsMark = arenaMark(pL->dirNodes);
+  if ((dirs = arenaAlloc(pL->dirNodes, 2 * sizeof(Froot))) == 0) {
+    noMemory(pL);
+    failed(pL, dirName);
+    if (giveUp) {
+      handUp(pL, dirFd);
+    }
+    close(dirFd);
+    pL->openDirs--;
+    return;
+  }
+  memset(dirs, 0, 2 * sizeof(Froot));
+  dirs->extension = "subs";
+
+  /**
+   | If memory runs out, nothing is done with files known only in
+   | part: the cleaning stops.
+  **/
+
+  treeMark = arenaMark(pL->treeNodes);
+  teXTree  = buildTree(pL, dirFd, dirName, known ? &dirSt : 0, dirs);
+
+  statsEnter(pL->stats, STATS_EXAMINE);
+  if (teXTree == 0 || pL->outOfMemory) {
+    if (pL->spilled) {
+      spillReset(pL->spill);
+    }
+  } else if (pL->flags & LINTEX_RECORDER) {
+    for (pFN = teXTree->firstNode;
+         pFN != 0 && !pL->outOfMemory;   pFN = pFN->next) {
+      cleanRecorded(pL, dirFd, dirName, pFN->name);
+    }
+  } else if (pL->spilled) {
+    examineSpill(pL, teXTree, dirFd, dirName);
+  } else {
+    if (pL->trace != 0) {
+      printTree(pL, teXTree);
+    }
+    examineTree(pL, teXTree, dirFd, dirName);
+  }
+  statsEnter(pL->stats, STATS_SCAN);
+  if (teXTree != 0) {
+    releaseTree(pL, teXTree, pL->treeNodes, treeMark);
+  } else {
+    arenaRelease(pL->treeNodes, treeMark);
+  }
+
+  if (pL->unlinkDir != 0) {
+    unlinkqRelease(pL->unlinkQ, pL->unlinkDir);
+    pL->unlinkDir = 0;
+  }
+
+  pFN = descend && (pL->maxDepth < 0 || pL->depth < pL->maxDepth) &&
+        !failed(pL, dirName) ? dirs->firstNode : 0;
+  while (pFN != 0) {
+    MstatReq  subs[SUB_WINDOW];
+    int       levels[SUB_WINDOW];
+    Fnode    *pSub;
+    int       window = 1, n, i;
+
+    if (dirFd < 0 && (dirFd = reopenDir(pL, dirName, &dirSt)) < 0) {
+      break;
+    }
+    if (mstatKind(pL->mstat) != MSTAT_SYNC) {
+      window = FD_BUDGET - pL->openDirs - pL->preOpened;
+      if (window > SUB_WINDOW) window = SUB_WINDOW;
+      if (window < 1)          window = 1;
+    }
+
+    for (n = 0, pSub = pFN;   n < window && pSub != 0;   pSub = pSub->next) {
+      subs[n].name = pSub->name;
+      subs[n].op   = MSTAT_OPEN;
+      levels[n]    = pL->level;
+      n++;
+    }
+    if (known && (pL->flags & LINTEX_ONE_FS || pL->fsPolicy != 0)) {
+      crossMounts(pL, dirFd, dirName, dirSt.st_dev, subs, levels, n);
+    }
+    for (i = 0;   i < n;   i++) {
+      if (subs[i].op == MSTAT_NONE) {
+        continue;
+      }
+      switch (pruneDir(pL->pR->prune, dirFd, subs[i].name)) {
+        case PRUNE_NAME:
+          if (pL->trace != 0) {
+            fprintf(pL->trace, "* Directory \"%s/%s\" pruned by name\n",
+                    dirName, subs[i].name);
+          }
+          subs[i].op = MSTAT_NONE;
+          break;
+
+        case PRUNE_MARKER:
+          if (pL->trace != 0) {
+            fprintf(pL->trace, "* Directory \"%s/%s\" pruned by a marker"
+                    " file\n", dirName, subs[i].name);
+          }
+          subs[i].op = MSTAT_NONE;
+          break;
+      }
+    }
+    mstatRun(pL->mstat, dirFd, subs, n);
+
+    for (i = 0;   i < n;   i++) {
+      if (subs[i].op == MSTAT_OPEN && subs[i].result >= 0) pL->preOpened++;
+    }
+
+    for (i = 0;   i < n;   i++, pFN = pFN->next) {
+      ArenaMark  nameMark;
+      char      *subName;
+      int        level = pL->level;
+
+      if (subs[i].op == MSTAT_NONE) {
+        continue;
+      }
+      if (subs[i].result >= 0) {
+        pL->preOpened--;
+      }
+      nameMark = arenaMark(pL->dirNodes);
+      if (pL->outOfMemory ||
+          (subName = newString(pL->dirNodes, dirName, "/", pFN->name)) == 0) {
+        noMemory(pL);
+        if (subs[i].result >= 0) {
+          close(subs[i].result);
+        }
+        continue;
+      }
+
+      if (subs[i].result < 0) {
+        errno = -subs[i].result;
+      }
+      if (dirFd >= 0 && subs[i].result >= 0 &&
+          known && pL->openDirs > DIR_HOLD) {
+        close(dirFd);
+        dirFd = -1;
+        pL->openDirs--;
+      }
+      pL->depth++;
+      if (levels[i] != level) {
+        pL->level = levels[i];
+        mstatLimit(pL->mstat, levels[i] > 0 ? levels[i] : 0);
+      }
+      pL->upWanted = dirFd < 0;
+      pL->upFd     = -1;
+      clean(pL, subs[i].result, subName, TRUE);
+      if (dirFd < 0) {
+        dirFd = takeUp(pL, &dirSt);
+      }
+      if (levels[i] != level) {
+        pL->level = level;
+        mstatLimit(pL->mstat, level > 0 ? level : 0);
+      }
+      pL->depth--;
+      arenaRelease(pL->dirNodes, nameMark);
+    }
+    if (failed(pL, dirName)) {
+      break;
+    }
+  }
+  releaseTree(pL, dirs, pL->dirNodes, dirsMark);
+
+  if (dirFd < 0) {
+    return;
+  }
+  if (giveUp) {
+    handUp(pL, dirFd);
+  }
+  if (close(dirFd) != 0) {
+    sinkInit(&rec, dirName, 0, -1, -1);
+    emit(pL, LINTEX_ERROR, &rec, 0, -1, errno);
+  }
+  pL->openDirs--;
+}
+
+static int reopenDir(
+  Lintex            *pL,
+  const char        *dirName,
+  const struct stat *pSt
+){
+
+  /**
+   | Opens again the directory "dirName", closed while descending below
+   | it because DIR_HOLD directories up the tree were already open, and
+   | checks that it is the same one ("pSt"), when the subdirectory just
+   | cleaned could not leave it open (see takeUp()): by name, that may
+   | be too long.  Returns its descriptor; otherwise reports the error,
+   | and returns -1: the subdirectories left are not cleaned.
+  **/
+
+  SinkRecord  rec;
+  struct stat st;
+  int         dirFd;
+
+  if ((dirFd = openat(AT_FDCWD, dirName, O_RDONLY | O_DIRECTORY)) >= 0) {
+    if (fstat(dirFd, &st) == 0 &&
+        st.st_dev == pSt->st_dev && st.st_ino == pSt->st_ino) {
+      pL->openDirs++;
+      return dirFd;
+    }
+    close(dirFd);
+    errno = ESTALE;
+  }
+  sinkInit(&rec, dirName, 0, -1, -1);
+  emit(pL, LINTEX_NO_DIR, &rec, 0, -1, errno);
+  return -1;
+}
+
+static void handUp(
+  Lintex *pL,
+  int     dirFd
+){
+
+  /**
+   | Before the directory open as "dirFd" is closed, opens its parent
+   | (that closed itself before descending) for it to go on: the path
+   | from the top may well be longer than PATH_MAX.
+  **/
+
+  pL->upFd = openat(dirFd, "..", O_RDONLY | O_DIRECTORY);
+}
+
+static int takeUp(
+  Lintex            *pL,
+  const struct stat *pSt
+){
+
+  /**
+   | The directory left open by handUp(), if it is the one whose
+   | metadata are "pSt" (a subdirectory reached through a symbolic
+   | link has another parent); otherwise -1, and the directory will
+   | be opened again by name if needed (see reopenDir()).
+  **/
+
+  struct stat st;
+  int         dirFd = pL->upFd;
+
+  pL->upFd = -1;
+  if (dirFd < 0) {
+    return -1;
+  }
+  if (fstat(dirFd, &st) != 0 ||
+      st.st_dev != pSt->st_dev || st.st_ino != pSt->st_ino) {
+    close(dirFd);
+    return -1;
+  }
+  pL->openDirs++;
+  return dirFd;
+}
+
+static void crossMounts(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  dev_t       dirDev,
+  MstatReq   *subs,
+  int        *levels,
+  int         n
+){
+
+  /**
+   | Before the "n" subdirectories in "subs", of the directory open as
+   | "dirFd" (whose device is "dirDev"), are opened: gets their devices
+   | in a batch (with AT_NO_AUTOMOUNT, so no automount is triggered),
+   | and looks at the file systems of those that are mount points.  The
+   | subdirectories to be skipped (with LINTEX_ONE_FS, on a device other
+   | than the one of the directory given; or whose type has to be
+   | skipped) are made MSTAT_NONE; the concurrency level of the others
+   | is set in "levels".
+  **/
+
+  MstatReq probe[SUB_WINDOW];
+  int      i;
+
+  for (i = 0;   i < n;   i++) {
+    probe[i].name = subs[i].name;
+    probe[i].op   = MSTAT_STAT;
+  }
+  mstatRun(pL->mstat, dirFd, probe, n);
+
+  for (i = 0;   i < n;   i++) {
+    unsigned long type;
+
+    if (probe[i].result < 0 || probe[i].dev == dirDev) {
+      continue;
+    }
+    if (pL->flags & LINTEX_ONE_FS && probe[i].dev != pL->rootDev) {
+      if (pL->trace != 0) {
+        fprintf(pL->trace, "* Directory \"%s/%s\" is on another file"
+                " system\n", dirName, subs[i].name);
+      }
+      subs[i].op = MSTAT_NONE;
+
+    } else if (pL->fsPolicy != 0) {
+      type = fsTypeAt(dirFd, subs[i].name);
+      switch (levels[i] = fsPolicyOf(pL->fsPolicy, type)) {
+        case FS_SKIP:
+          if (pL->trace != 0) {
+            fprintf(pL->trace, "* Directory \"%s/%s\" skipped (file system"
+                    " %s)\n", dirName, subs[i].name, fsTypeName(type) != 0 ?
+                    fsTypeName(type) : "of unknown type");
+          }
+          subs[i].op = MSTAT_NONE;
+          break;
+
+        case FS_ALLOW:
+          break;
+
+        default:
+          if (pL->trace != 0) {
+            fprintf(pL->trace, "* Directory \"%s/%s\": at most %d requests"
+                    " in flight\n", dirName, subs[i].name, levels[i]);
+          }
+      }
+    }
+  }
+}
+
+static Froot *buildTree(
+  Lintex            *pL,
+  int                dirFd,
+  const char        *dirName,
+  const struct stat *pDirSt,
+  Froot             *subDirs
+){
+
+  /**
+   | - Allocates a structure to hold the names of the TeX-related files,
+   |   initialized from "protoTree";
+   | - starts a loop over all the files of the directory open as "dirFd"
+   |   (whose full name is "dirName", and metadata "pDirSt", if known),
+   |   as returned by the bulk reader.
+   |   Every file is accessed relative to the directory file descriptor,
+   |   so that the kernel does not have to resolve the whole path again
+   |   for every call.
+   |
+   | The files are first classified by name, a batch of directory
+   | entries at a time (see sufx.h) and then through the compiled
+   | rules, and by their type in the directory entry; those whose
+   | metadata are needed are put aside
+   | (their names are copied, one after the other, in a single buffer),
+   | and their metadata are asked for in a single batch when the
+   | directory has been read; then they are inserted, in the original
+   | order.
+   |
+   | With a scan index, the entries that are acted upon are recorded in
+   | it; and if the directory did not change since it was recorded,
+   | only these entries are taken from the index, instead of reading
+   | the directory.
+   |
+   | With a memory budget, the entries put aside are dealt with as soon
+   | as they would take more than that, instead of all at the end.
+  **/
+
+  const LintexRules *pR = pL->pR;
+  int            recurse = (pL->flags & LINTEX_RECURSE) != 0;
+  int            statOp  = (pL->flags & LINTEX_NO_FOLLOW) ? MSTAT_LSTAT
+                                                          : MSTAT_STAT;
+  DentsEntry     batch[BATCH]; /* Directory entries read together    */
+  SufxInfo       infos[BATCH]; /*   and their classification         */
+  size_t         nBatch = 0;   /* Their number                       */
+  size_t         b;            /* The current one                    */
+  Froot         *teXTree;      /* Root node of the TeX-related files */
+  MstatReq      *reqs   = 0;   /* Entries put aside: metadata        */
+  Fentry        *ents   = 0;   /*   and where they belong            */
+  size_t         nEnts  = 0;   /* Their number                       */
+  size_t         mEnts  = 0;   /*   and the allocated size           */
+  char          *names  = 0;   /* Their names                        */
+  size_t         lNames = 0;   /*   total length                     */
+  size_t         mNames = 0;   /*   and allocated size               */
+  long           got = 0;      /* Returned from dentsBatch()         */
+  const DentsEntry *cached = 0; /* Entries from the scan index,      */
+  long           nCached = -1; /*   their number (-1: none)          */
+  long           done    = 0;  /*   and those already seen           */
+
+  if (pL->trace != 0) {
+    fprintf(pL->trace, "* Scanning directory \"%s\" - recurse = %c, ",
+            dirName, (recurse ? 'Y' : 'N'));
+    fprintf(pL->trace, "keep = %c\n", (pR->nKeeps > 0 ? 'Y' : 'N'));
+    fprintf(pL->trace, "* Editor trailer: \"%s\"\n", pR->bExt);
+    putsTrace(pL, "------------------------------Phase 1: directory scan");
+  }
+
+  teXTree = arenaAlloc(pL->treeNodes, (pR->nExts + 1) * sizeof(Froot));
+  if (teXTree == 0) {
+    noMemory(pL);
+    return 0;
+  }
+  memcpy(teXTree, pL->protoTree, (pR->nExts + 1) * sizeof(Froot));
+  pL->tree      = teXTree;
+  pL->nodesMark = arenaMark(pL->treeNodes);
+  pL->treeBytes = 0;
+  pL->spilled   = FALSE;
+
+  if (pL->scanIdx != 0 && pDirSt != 0) {
+    nCached = scanidxFind(pL->scanIdx, pDirSt, &cached);
+    scanidxBegin(pL->scanIdx, pDirSt);
+    if (nCached >= 0 && pL->trace != 0) {
+      fprintf(pL->trace, "* Unchanged directory: %ld entries from the index\n",
+              nCached);
+    }
+  }
+
+  for (b = 0;   ;   b++) {
+    DentsEntry *pDe;                     /* The current directory entry     */
+    SufxInfo   *pSi;                     /*   and its classification        */
+    char       *name;                    /* The current file name           */
+    int         isDir;                   /* Is it a directory?              */
+    int         op;                      /* What we need to know about it   */
+    size_t      len;                     /* Lenght of the current file name */
+    RulesMatch  match;                   /* Matching rules                  */
+    Froot      *pTT  = 0;                /* Matching extension, if any      */
+    int         kept = FALSE;            /* Extension to be kept?           */
+
+    if (pL->outOfMemory) {
+      break;
+    }
+    if (b == nBatch) {
+      statsEnter(pL->stats, STATS_SCAN);
+      if (nCached >= 0) {
+        if ((got = nCached - done) > BATCH) got = BATCH;
+        if (got == 0) break;
+        memcpy(batch, cached + done, got * sizeof(DentsEntry));
+        done += got;
+      } else if ((got = dentsBatch(pL->dents, batch, BATCH)) <= 0) {
+        break;
+      } else {
+        statsAdd(pL->stats, STATS_ENTRIES, (double) got);
+      }
+      statsEnter(pL->stats, STATS_CLASSIFY);
+      nBatch = got;
+      b      = 0;
+      sufxClassify(batch, nBatch, pR->bExt, pR->n_bExt, infos);
+    }
+    pDe  = &batch[b];
+    pSi  = &infos[b];
+    name = (char *) pDe->name;
+    len  = pDe->len;
+
+    /**
+     | - Tests for empty inodes (already removed files);
+     | - skips the . and .. (current and previous directory);
+     | - looks the file name up in the compiled rules: the names without
+     |   any dot can only match the backup trailer, and the classifier
+     |   has already told whether they do.
+    **/
+
+    if (pDe->ino == 0)             continue;
+    if (strcmp(name, ".")  == 0) continue;
+    if (strcmp(name, "..") == 0) continue;
+
+    /**
+     | With LINTEX_RECORDER, only the recorder files matter, besides the
+     | subdirectories: they are put in the list of the .tex files.
+    **/
+
+    if (pL->flags & LINTEX_RECORDER) {
+      if (len > 4 && strcmp(name + len - 4, ".fls") == 0 &&
+          pDe->type != DT_DIR) {
+        recordEntry(pL, pDe);
+        if (insertNode(pL->treeNodes, name, 0, 0, 0, 0, teXTree) != 0) {
+          noMemory(pL);
+        }
+        continue;
+      }
+      if (pDe->type != DT_DIR &&
+          !(recurse && (pDe->type == DT_UNKNOWN || pDe->type == DT_LNK))) {
+        continue;
+      }
+    }
+
+    if ((pSi->lastDot >= 0 || pSi->backup) &&
+        !(pL->flags & LINTEX_RECORDER)) {
+      rulesMatch(pR->rules, name, len, &match);
+    } else {
+      match.id     = -1;
+      match.keep   = FALSE;
+      match.len    = 0;
+      match.backup = 0;
+    }
+
+    /**
+     | Files ending with the extension of the backup files are always
+     | deleted.  Otherwise, the longest extension (starting with a dot)
+     | among those in teXTree[i].extension, if any, is the one of the
+     | file; and it may be one to be kept.  Nothing here needs the file
+     | metadata.
+    **/
+
+    if (match.backup != 0 && len > match.backup) {
+      SinkRecord rec;
+
+      recordEntry(pL, pDe);
+      sinkInit(&rec, dirName, name, SINK_REMOVED, SINK_BACKUP);
+      nuke(pL, dirFd, dirName, name, 0, &rec);
+      continue;
+    }
+
+    if (match.id >= 0) {
+      pTT  = teXTree + match.id;
+      kept = match.keep;
+    }
+
+    /**
+     | The file type, when returned in the entry, tells directories
+     | from other files; only when it is unknown (or the file is a
+     | symbolic link, followed unless LINTEX_NO_FOLLOW) the file has to
+     | be stat'ed, and only if the answer may change what we do with it.
+     | Files with a relevant extension need their modification time
+     | anyway.  Subdirectories are put aside too, to keep them in order.
+    **/
+
+    isDir = FALSE;
+    op    = MSTAT_NONE;
+
+    switch (pDe->type) {
+      case DT_DIR:
+        isDir = TRUE;
+        break;
+
+      case DT_UNKNOWN:   case DT_LNK:
+        if ((pTT != 0 && !kept) || recurse) {
+          op = statOp;
+        }
+        break;
+
+      default:
+        if (pTT != 0 && !kept) {
+          op = MSTAT_STAT;
+        }
+        break;
+    }
+
+    if (op == MSTAT_NONE && !(isDir && recurse)) {
+      if (isDir) {
+        if (pL->trace != 0) {
+          fprintf(pL->trace, "File %s - is a directory\n", name);
+        }
+      } else if (pTT != 0 || (pL->flags & LINTEX_ALL)) {
+        recordEntry(pL, pDe);
+        addFile(pL, dirFd, dirName, name, match.len, pTT, kept, 0, 0);
+      }
+      continue;
+    }
+
+    recordEntry(pL, pDe);
+
+    if (pL->maxMemory > 0 && nEnts > 0 &&
+        nEnts * (sizeof(MstatReq) + sizeof(Fentry)) + lNames >
+        pL->maxMemory) {
+      settle(pL, dirFd, dirName, reqs, ents, names, nEnts, subDirs);
+      nEnts  = 0;
+      lNames = 0;
+    }
+
+    if (nEnts == mEnts) {
+      size_t    m = mEnts == 0 ? 64 : 2 * mEnts;
+      MstatReq *r;
+      Fentry   *e;
+
+      if ((r = realloc(reqs, m * sizeof(MstatReq))) != 0) {
+        reqs = r;
+      }
+      if (r == 0 || (e = realloc(ents, m * sizeof(Fentry))) == 0) {
+        noMemory(pL);
+        break;
+      }
+      ents  = e;
+      mEnts = m;
+    }
+    if (lNames + len + 1 > mNames) {
+      size_t  m = mNames;
+      char   *n;
+
+      do {
+        m = m == 0 ? 4096 : 2 * m;
+      } while (lNames + len + 1 > m);
+      if ((n = realloc(names, m)) == 0) {
+        noMemory(pL);
+        break;
+      }
+      names  = n;
+      mNames = m;
+    }
+    memcpy(names + lNames, name, len + 1);
+
+    reqs[nEnts].op      = op;
+    reqs[nEnts].isDir   = isDir;
+    ents[nEnts].pTT     = pTT;
+    ents[nEnts].lExt    = match.len;
+    ents[nEnts].kept    = kept;
+    ents[nEnts].nameOff = lNames;
+    lNames += len + 1;
+    nEnts++;
+  }             /* for (dentsBatch) ... */
+
+  if (got < 0) {
+    SinkRecord rec;
+
+    sinkInit(&rec, dirName, 0, -1, -1);
+    emit(pL, LINTEX_ERROR, &rec, 0, -1, errno);
+  }
+  if (pL->scanIdx != 0) {
+    scanidxEnd(pL->scanIdx, got == 0 && !pL->outOfMemory);
+  }
+
+  if (!pL->outOfMemory) {
+    settle(pL, dirFd, dirName, reqs, ents, names, nEnts, subDirs);
+  }
+
+  free(reqs);
+  free(ents);
+  free(names);
+
+  return teXTree;
+}
+
+static void settle(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  MstatReq   *reqs,
+  Fentry     *ents,
+  char       *names,
+  size_t      nEnts,
+  Froot      *subDirs
+){
+
+  /**
+   | Gets the metadata of the "nEnts" files put aside while scanning the
+   | directory "dirName", open as "dirFd", all at once: their requests
+   | are in "reqs", where they belong in "ents" and their names in
+   | "names".  Then deals with them, in the original order.
+   |
+   | If the file is a directory and LINTEX_RECURSE has been given,
+   | stores the directory name (relative to this one) in the linked
+   | list pointed to by "subDirs", for recursive calls: whether it is
+   | pruned is only known once it is sure to be crossed (see clean()).
+   |
+   | N.B.: if the metadata can't be obtained, the file is skipped.
+  **/
+
+  int    recurse = (pL->flags & LINTEX_RECURSE) != 0;
+  size_t i;
+
+  for (i = 0;   i < nEnts;   i++) {
+    reqs[i].name = names + ents[i].nameOff;
+  }
+  statsEnter(pL->stats, STATS_SCAN);
+  mstatRun(pL->mstat, dirFd, reqs, nEnts);
+  statsEnter(pL->stats, STATS_CLASSIFY);
+
+  for (i = 0;   i < nEnts && !pL->outOfMemory;   i++) {
+    char *name = (char *) reqs[i].name;
+
+    if (reqs[i].op != MSTAT_NONE && reqs[i].result < 0) {
+      SinkRecord rec;
+
+      sinkInit(&rec, dirName, name, -1, -1);
+      emit(pL, LINTEX_ERROR, &rec, 0, -1, -reqs[i].result);
+
+    } else if (reqs[i].isDir) {
+      if (pL->trace != 0) {
+        fprintf(pL->trace, "File %s - is a directory\n", name);
+      }
+      if (!recurse) {
+        continue;
+      }
+      if (insertNode(pL->dirNodes, name, 0, 0, 0, 0, subDirs) != 0) {
+        noMemory(pL);
+      }
+
+    } else if (!(pL->flags & LINTEX_RECORDER)) {
+      addFile(pL, dirFd, dirName, name, ents[i].lExt, ents[i].pTT,
+              ents[i].kept, reqs[i].mTime, reqs[i].size);
+    }
+  }
+
+}
+
+static void addFile(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  char       *name,
+  size_t      lExt,
+  Froot      *pTT,
+  int         kept,
+  time_t      mTime,
+  off_t       size
+){
+
+  /**
+   | Deals with the file "name", that is not a directory: if it has a
+   | relevant extension, of length "lExt", "pTT" points to the
+   | corresponding list and the file name (with the extension stripped)
+   | is stored there, together with its modification time and size.  "kept"
+   | tells if the extension has to be kept.  Without a relevant
+   | extension, the one after the last dot is shown.
+  **/
+
+  size_t      len = strlen(name);
+  char       *pFe = lExt > 0 ? name + len - lExt : strrchr(name, '.');
+  SinkRecord  rec;
+
+  if (pFe != 0) {
+    size_t nameLen = pFe - name;
+
+    if (nameLen < len - 1) {
+
+      if (pL->trace != 0) {
+        fprintf(pL->trace, "File %s - extension %s", name, pFe);
+      }
+
+      if (pTT != 0 && !kept) {
+        statsAdd(pL->stats, STATS_ACCESS, 1.0);
+        storeFile(pL, pTT, name, nameLen, mTime, size,
+                  faccessat(dirFd, name, W_OK, 0));
+        if (pL->trace != 0) {
+          fputs(pL->spilled ? " - spilled" : " - inserted in tree",
+                pL->trace);
+        }
+      } else if (kept && pL->trace != 0) {
+        fputs(" - not inserted in tree (extension in keep-exts)", pL->trace);
+      }
+      putsTrace(pL, "");
+
+      if (pL->spill != 0 && !pL->spilled &&
+          pL->treeBytes > pL->maxMemory) {
+        spillTree(pL);
+      }
+
+      if (kept) {
+        statsAdd(pL->stats, STATS_KEEP, 1.0);
+        sinkInit(&rec, dirName, name, SINK_KEPT, SINK_KEEP);
+        emit(pL, LINTEX_KEPT, &rec, 0, dirFd, 0);
+      }
+
+    } else {
+      sinkInit(&rec, dirName, name, -1, -1);
+      emit(pL, LINTEX_EMPTY, &rec, 0, dirFd, 0);
+    }
+
+  } else {
+    if (pL->trace != 0) {
+      fprintf(pL->trace, "File %s - without extension\n", name);
+    }
+  }
+}
+
+static void storeFile(
+  Lintex     *pL,
+  Froot      *pTT,
+  const char *name,
+  size_t      nameLen,
+  time_t      mTime,
+  off_t       size,
+  int         write
+){
+
+  /**
+   | Stores the file whose name, with the extension stripped, is the
+   | first "nameLen" characters of "name", in the list "pTT": or spills
+   | it, if the lists have already outgrown the memory budget.
+  **/
+
+  if (pL->spilled) {
+    if (spillAdd(pL->spill, name, nameLen, (int) (pTT - pL->tree), mTime,
+                 size, write) != 0 && errno == ENOMEM) {
+      noMemory(pL);
+    }
+    return;
+  }
+
+  if (insertNode(pL->treeNodes, name, nameLen, mTime, size, write,
+                 pTT) != 0) {
+    noMemory(pL);
+  }
+  pL->treeBytes += sizeof(Fnode) + nameLen;
+}
+
+static void spillTree(
+  Lintex *pL
+){
+
+  /**
+   | Moves all the files in the lists of the current directory to the
+   | spilled entries, the extension being identified by its list; then
+   | empties the lists, releasing their nodes.  An error other than
+   | running out of memory is reported when the entries are merged.
+  **/
+
+  Froot *pTT;
+  Fnode *pFN;
+
+  if (pL->trace != 0) {
+    fprintf(pL->trace, "* Lists over %lu bytes: spilling the files\n",
+            (unsigned long) pL->maxMemory);
+  }
+  for (pTT = pL->tree;   pTT->extension != 0;   pTT++) {
+    for (pFN = pTT->firstNode;   pFN != 0;   pFN = pFN->next) {
+      if (spillAdd(pL->spill, pFN->name, strlen(pFN->name),
+                   (int) (pTT - pL->tree), pFN->mTime, pFN->size,
+                   pFN->write) != 0 && errno == ENOMEM) {
+        noMemory(pL);
+      }
+    }
+    pTT->firstNode = 0;
+    pTT->lastNode  = 0;
+  }
+  arenaRelease(pL->treeNodes, pL->nodesMark);
+  pL->spilled = TRUE;
+}
+
+static void printTree(
+  Lintex *pL,
+  Froot  *teXTree
+){
+
+  /**
+   | Prints all the file names archived in the linked lists (for
+   | debugging purposes).
+  **/
+
+  Froot *pTT;           /* Running pointer over teXTree elements */
+
+  putsTrace(pL, "------------------------------Phase 2: tree printout");
+  for (pTT = teXTree;   pTT->extension != 0;   pTT++) {
+    Fnode *pTeX;              /* Running pointer over TeX-related files */
+    int    nNodes = 0;        /* Counter */
+
+    for (pTeX = pTT->firstNode;   pTeX != 0;   pTeX = pTeX->next) {
+      ++nNodes;
+      fprintf(pL->trace, "%s%s\n", pTeX->name, pTT->extension);
+    }
+    fprintf(pL->trace, "  --> %d file%s with extension %s\n", nNodes,
+            (nNodes == 1 ? "" : "s"), pTT->extension);
+  }
+}
+
+static void examineTree(
+  Lintex     *pL,
+  Froot      *teXTree,
+  int         dirFd,
+  const char *dirName
+){
+
+  /**
+   | Examines the linked lists for the directory "dirName", open as
+   | "dirFd", doing the effective cleanup.
+  **/
+
+  Froot  *pTT;          /* Pointer over linked list trees      */
+  Fnode  *pTeX;         /* Running pointer over the .tex files */
+  Fnode  *pComp;        /* Running pointer over the other files */
+  Fnode **index;        /* Hash table of the .tex files        */
+  size_t  nTeX = 0;     /* Number of .tex files                */
+  size_t  size = 1;     /* Size of "index" (a power of 2)      */
+  size_t  h;
+
+  /**
+   | The .tex files are indexed by name, in an open addressing hash
+   | table at most half full; then every other file is linked to the
+   | .tex file with the same name, if any.  The lists are scanned
+   | backwards, and the files prepended, so that the related files of
+   | every .tex come in the order of the lists.
+  **/
+
+  for (pTeX = teXTree->firstNode;   pTeX != 0;   pTeX = pTeX->next) {
+    nTeX++;
+  }
+  while (size < 2 * nTeX) {
+    size <<= 1;
+  }
+  if ((index = arenaAlloc(pL->treeNodes, size * sizeof(Fnode *))) == 0) {
+    noMemory(pL);
+    return;
+  }
+  memset(index, 0, size * sizeof(Fnode *));
+
+  for (pTeX = teXTree->firstNode;   pTeX != 0;   pTeX = pTeX->next) {
+    pTeX->related = 0;
+    for (h = hashName(pTeX->name) & (size - 1);   index[h] != 0;
+         h = (h + 1) & (size - 1)) {
+    }
+    index[h] = pTeX;
+  }
+
+  for (pTT = teXTree;   pTT->extension != 0;   pTT++) {
+  }
+  while (nTeX > 0 && --pTT != teXTree) {
+    for (pComp = pTT->firstNode;   pComp != 0;   pComp = pComp->next) {
+      for (h = hashName(pComp->name) & (size - 1);   index[h] != 0;
+           h = (h + 1) & (size - 1)) {
+        if (strcmp(index[h]->name, pComp->name) == 0) {
+          pComp->extension = pTT->extension;
+          pComp->related   = index[h]->related;
+          index[h]->related = pComp;
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   | Looks, for all the .tex files, if a corresponding entry with the same
+   | name exists (with a different extension) in the other lists; if so,
+   | and if its modification time is later than the one of the related
+   | .tex file, removes it from the file system.
+  **/
+
+  putsTrace(pL, "------------------------------Phase 3: effective cleanup");
+
+  for (pTeX = teXTree->firstNode;
+       pTeX != 0 && !pL->outOfMemory;   pTeX = pTeX->next) {
+
+    if (pL->trace != 0) {
+      fprintf(pL->trace, "    Finding files related to %s/%s.tex:\n",
+              dirName, pTeX->name);
+    }
+
+    for (pComp = pTeX->related;   pComp != 0;   pComp = pComp->related) {
+      pComp->name[0] = '\0';
+      judge(pL, dirFd, dirName, pTeX->name, pComp->extension, pTeX->name,
+            pTeX->mTime, pComp->mTime, pComp->size, pComp->write);
+    }
+  }
+
+  /**
+   | If some garbage file has not been deleted, list it
+  **/
+
+  putsTrace(pL, "------------------------------Phase 4: left garbage files");
+
+  pTT = teXTree;
+  for (pTT++;  pTT->extension != 0 && !pL->outOfMemory;  pTT++) {
+    for (pComp = pTT->firstNode;   pComp != 0;   pComp = pComp->next) {
+      if (pComp->name[0] != '\0') {
+        judge(pL, dirFd, dirName, pComp->name, pTT->extension, 0, 0,
+              pComp->mTime, pComp->size, pComp->write);
+      }
+    }
+  }
+}
+
+static void examineSpill(
+  Lintex     *pL,
+  Froot      *teXTree,
+  int         dirFd,
+  const char *dirName
+){
+
+  /**
+   | As examineTree(), for the files of the directory "dirName", open as
+   | "dirFd", that have been spilled: they come back a family at a
+   | time, sorted by name, the .tex file first (if any: its extension
+   | comes first).  The names are released after every family.
+  **/
+
+  const SpillEntry *family;
+  long              n = 0, i;
+
+  putsTrace(pL, "------------------------------Phase 3: merged cleanup");
+  if (pL->trace != 0) {
+    fprintf(pL->trace, "* Merging %lu runs\n", spillRuns(pL->spill));
+  }
+
+  while (!pL->outOfMemory && (n = spillFamily(pL->spill, &family)) > 0) {
+    ArenaMark         mark = arenaMark(pL->treeNodes);
+    const SpillEntry *pTeX = family->ext == 0 ? family : 0;
+
+    if (pTeX != 0 && pL->trace != 0) {
+      fprintf(pL->trace, "    Finding files related to %s/%s.tex:\n",
+              dirName, pTeX->name);
+    }
+    for (i = pTeX != 0;   i < n;   i++) {
+      judge(pL, dirFd, dirName, family[i].name,
+            teXTree[family[i].ext].extension,
+            pTeX != 0 ? pTeX->name : 0, pTeX != 0 ? pTeX->mTime : 0,
+            family[i].mTime, family[i].size, family[i].tag);
+    }
+    arenaRelease(pL->treeNodes, mark);
+  }
+
+  if (n < 0) {
+    SinkRecord rec;
+    int        err = errno;
+
+    sinkInit(&rec, dirName, 0, -1, -1);
+    emit(pL, LINTEX_ERROR, &rec, 0, -1, err);
+  }
+  spillReset(pL->spill);
+}
+
+static void judge(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  const char *base,
+  const char *extension,
+  const char *tex,
+  time_t      texMtime,
+  time_t      mTime,
+  off_t       size,
+  int         write
+){
+
+  /**
+   | Deals with the file "base" plus "extension" of the directory
+   | "dirName", open as "dirFd", whose modification time is "mTime",
+   | size "size" and "write" what faccessat(W_OK) returned: "tex" is
+   | the name of its .tex source, modified at "texMtime", or 0 if
+   | there is none (the file is then kept).
+  **/
+
+  char       *cName = newString(pL->treeNodes, base, extension, "");
+  SinkRecord  rec;
+
+  if (cName == 0) {
+    noMemory(pL);
+    return;
+  }
+  if (tex == 0) {
+    statsAdd(pL->stats, STATS_NO_TEX, 1.0);
+    sinkInit(&rec, dirName, cName, SINK_KEPT, SINK_NO_TEX);
+    rec.size  = size;
+    rec.mTime = mTime;
+    emit(pL, LINTEX_KEPT, &rec, 0, dirFd, 0);
+    return;
+  }
+
+  sinkInit(&rec, dirName, cName, SINK_REMOVED, SINK_STALE);
+  rec.size     = size;
+  rec.mTime    = mTime;
+  rec.texMtime = texMtime;
+
+  /**
+   | Remove generated file if more recent than source (default) or if
+   | we permit the removal of files older than source
+  **/
+  if (difftime(mTime, texMtime) > 0.0 || (pL->flags & LINTEX_OLDER)) {
+    if (write == 0) {
+      nuke(pL, dirFd, dirName, cName, tex, &rec);
+    } else {
+      statsAdd(pL->stats, STATS_READ_ONLY, 1.0);
+      if (pL->trace != 0) {
+        fprintf(pL->trace, "*** %s/%s readonly; perms are %d***\n",
+                dirName, cName, write);
+      }
+      rec.action = SINK_KEPT;
+      rec.reason = SINK_READ_ONLY;
+      emit(pL, LINTEX_KEPT, &rec, tex, dirFd, 0);
+    }
+  } else {
+    statsAdd(pL->stats, STATS_TEX_NEWER, 1.0);
+    rec.action = SINK_KEPT;
+    rec.reason = SINK_TEX_NEWER;
+    emit(pL, LINTEX_KEPT, &rec, tex, dirFd, 0);
+  }
+}
+
+static void cleanRecorded(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  const char *flsName
+){
+
+  /**
+   | Cleans from the recorder file "flsName" in the directory "dirName",
+   | open as "dirFd".  The file is read as a whole; the PWD line tells
+   | where the relative names are from, and the OUTPUT lines the files
+   | written: those in this same directory (told by device and inode,
+   | whenever the directory name changes) are collected, sorted and
+   | made unique, and their metadata asked for in a single batch.  Then
+   | they are dealt with as examineTree() does, against the .tex file
+   | with the name of the recorder file.  The .tex files among them,
+   | and the recorder file itself, are never removed.
+  **/
+
+  ArenaMark    mark = arenaMark(pL->treeNodes);
+  char        *tex;
+  char        *texName;
+  time_t       texTime;
+  int          hasTex;
+  char        *text = 0;        /* The recorder file                  */
+  size_t       lText = 0;       /*   and its length                   */
+  const char  *pwd  = 0;        /* Where the relative names are from  */
+  const char  *lastDir = 0;     /* The last directory met             */
+  int          inDir = TRUE;    /*   and whether it is this one       */
+  char       **outs  = 0;       /* The OUTPUT files in this directory */
+  size_t       nOuts = 0;       /*   their number                     */
+  size_t       mOuts = 0;       /*   and the allocated size           */
+  MstatReq    *reqs;
+  struct stat  st, dirSt;
+  ssize_t      got;
+  int          fd, err = 0;
+  char        *line, *next;
+  size_t       i, n;
+
+  if ((tex = newString(pL->treeNodes, flsName, "", "")) == 0) {
+    noMemory(pL);
+    return;
+  }
+  tex[strlen(tex) - 4] = '\0';
+  if ((texName = newString(pL->treeNodes, tex, ".tex", "")) == 0) {
+    noMemory(pL);
+    arenaRelease(pL->treeNodes, mark);
+    return;
+  }
+
+  if (pL->trace != 0) {
+    fprintf(pL->trace, "* Recorder file \"%s/%s\"\n", dirName, flsName);
+  }
+
+  if ((fd = openat(dirFd, flsName, O_RDONLY)) < 0 || fstat(fd, &st) != 0 ||
+      fstat(dirFd, &dirSt) != 0) {
+    err = errno;
+  } else if (!S_ISREG(st.st_mode)) {
+    err = EISDIR;
+  } else if ((text = malloc((size_t) st.st_size + 1)) == 0) {
+    noMemory(pL);
+  } else {
+    while (lText < (size_t) st.st_size &&
+           (got = read(fd, text + lText, (size_t) st.st_size - lText)) != 0) {
+      if (got > 0) {
+        lText += got;
+      } else if (errno != EINTR) {
+        err = errno;
+        break;
+      }
+    }
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (err != 0 || text == 0) {
+    if (err != 0) {
+      SinkRecord rec;
+
+      sinkInit(&rec, dirName, flsName, -1, -1);
+      emit(pL, LINTEX_ERROR, &rec, 0, -1, err);
+    }
+    free(text);
+    arenaRelease(pL->treeNodes, mark);
+    return;
+  }
+  text[lText] = '\0';
+
+  for (line = text;   *line != '\0';   line = next) {
+    const char *dir;
+    char       *base, *slash;
+
+    if ((next = strchr(line, '\n')) != 0) {
+      *next++ = '\0';
+      if (next - line >= 2 && next[-2] == '\r') {
+        next[-2] = '\0';
+      }
+    } else {
+      next = line + strlen(line);
+    }
+
+    if (strncmp(line, "PWD ", 4) == 0) {
+      pwd = line + 4;
+      continue;
+    }
+    if (strncmp(line, "OUTPUT ", 7) != 0) {
+      continue;
+    }
+    base = line + 7;
+
+    /**
+     | The directory of the file (0: this one, for lack of a PWD line,
+     | and then the name is in it); if not the last one met, whether it
+     | is this one.
+    **/
+
+    if ((slash = strrchr(base, '/')) != 0) {
+      *slash = '\0';
+      if (*base == '/') {
+        dir = slash == base ? "/" : base;
+      } else if ((dir = newString(pL->treeNodes, pwd != 0 ? pwd : dirName,
+                                  "/", base)) == 0) {
+        noMemory(pL);
+        break;
+      }
+      base = slash + 1;
+    } else {
+      dir = pwd;
+    }
+
+    if (dir == 0) {
+      lastDir = 0;
+      inDir   = TRUE;
+    } else if (lastDir == 0 || strcmp(dir, lastDir) != 0) {
+      lastDir = dir;
+      inDir   = stat(dir, &st) == 0 && st.st_dev == dirSt.st_dev &&
+                st.st_ino == dirSt.st_ino;
+    }
+
+    if (!inDir) {
+      if (pL->trace != 0) {
+        fprintf(pL->trace, "File %s/%s - not in this directory\n", dir, base);
+      }
+      continue;
+    }
+    if (*base == '\0' || strcmp(base, flsName) == 0) {
+      continue;
+    }
+
+    if (nOuts == mOuts) {
+      size_t   m = mOuts == 0 ? 64 : 2 * mOuts;
+      char   **o;
+
+      if ((o = realloc(outs, m * sizeof(char *))) == 0) {
+        noMemory(pL);
+        break;
+      }
+      outs  = o;
+      mOuts = m;
+    }
+    outs[nOuts++] = base;
+  }
+
+  if (nOuts > 0) {
+    qsort(outs, nOuts, sizeof(char *), compareNames);
+  }
+  for (i = n = 0;   i < nOuts;   i++) {
+    if (n == 0 || strcmp(outs[i], outs[n - 1]) != 0) {
+      outs[n++] = outs[i];
+    }
+  }
+  nOuts = n;
+
+  /**
+   | The metadata of the files written (not following the symbolic
+   | links, that are removed as such), and of the .tex source.
+  **/
+
+  if (pL->outOfMemory ||
+      (reqs = malloc((nOuts + 1) * sizeof(MstatReq))) == 0) {
+    noMemory(pL);
+    free(outs);
+    free(text);
+    arenaRelease(pL->treeNodes, mark);
+    return;
+  }
+  for (i = 0;   i < nOuts;   i++) {
+    reqs[i].name = outs[i];
+    reqs[i].op   = MSTAT_LSTAT;
+  }
+  reqs[nOuts].name = texName;
+  reqs[nOuts].op   = MSTAT_STAT;
+  statsEnter(pL->stats, STATS_SCAN);
+  mstatRun(pL->mstat, dirFd, reqs, nOuts + 1);
+  statsEnter(pL->stats, STATS_EXAMINE);
+
+  hasTex  = reqs[nOuts].result == 0 && !reqs[nOuts].isDir;
+  texTime = reqs[nOuts].mTime;
+
+  if (pL->trace != 0) {
+    fprintf(pL->trace, "    %lu files written here; source %s%s\n",
+            (unsigned long) nOuts, texName, hasTex ? "" : " not found");
+  }
+
+  for (i = 0;   i < nOuts;   i++) {
+    char       *name = outs[i];
+    RulesMatch  match;
+    SinkRecord  rec;
+
+    if (reqs[i].result < 0) {
+      if (reqs[i].result != -ENOENT) {
+        sinkInit(&rec, dirName, name, -1, -1);
+        emit(pL, LINTEX_ERROR, &rec, 0, -1, -reqs[i].result);
+      }
+      continue;
+    }
+    if (reqs[i].isDir) {
+      continue;
+    }
+
+    rulesMatch(pL->pR->rules, name, strlen(name), &match);
+    if (match.id == 0) {
+      if (pL->trace != 0) {
+        fprintf(pL->trace, "File %s - a TeX source\n", name);
+      }
+      continue;
+    }
+
+    sinkInit(&rec, dirName, name, SINK_KEPT, SINK_KEEP);
+    rec.size  = reqs[i].size;
+    rec.mTime = reqs[i].mTime;
+
+    if (match.keep) {
+      statsAdd(pL->stats, STATS_KEEP, 1.0);
+      emit(pL, LINTEX_KEPT, &rec, 0, dirFd, 0);
+
+    } else if (!hasTex) {
+      statsAdd(pL->stats, STATS_NO_TEX, 1.0);
+      rec.reason = SINK_NO_TEX;
+      emit(pL, LINTEX_KEPT, &rec, 0, dirFd, 0);
+
+    } else {
+      rec.texMtime = texTime;
+      if (difftime(rec.mTime, texTime) > 0.0 || (pL->flags & LINTEX_OLDER)) {
+        statsAdd(pL->stats, STATS_ACCESS, 1.0);
+        if (faccessat(dirFd, name, W_OK, 0) == 0) {
+          rec.action = SINK_REMOVED;
+          rec.reason = SINK_STALE;
+          nuke(pL, dirFd, dirName, name, tex, &rec);
+        } else {
+          statsAdd(pL->stats, STATS_READ_ONLY, 1.0);
+          rec.reason = SINK_READ_ONLY;
+          emit(pL, LINTEX_KEPT, &rec, tex, dirFd, 0);
+        }
+      } else {
+        statsAdd(pL->stats, STATS_TEX_NEWER, 1.0);
+        rec.reason = SINK_TEX_NEWER;
+        emit(pL, LINTEX_KEPT, &rec, tex, dirFd, 0);
+      }
+    }
+  }
+
+  free(reqs);
+  free(outs);
+  free(text);
+  arenaRelease(pL->treeNodes, mark);
+}
+
+static void nuke(
+  Lintex     *pL,
+  int         dirFd,
+  const char *dirName,
+  const char *name,
+  const char *tex,
+  SinkRecord *pR
+){
+
+  /**
+   | Removes "name" from the directory "dirName", open as "dirFd", if
+   | the hook agrees; "pR" describes it, "tex" is its source, if any.
+   | As remove(3) did, a directory is removed if it is empty.  With an
+   | asynchronous deletion queue the removal is only queued, and
+   | reported later (its bytes are counted when queued).
+  **/
+
+  int    phase, err;
+  double t0 = 0.0;
+
+  if (emit(pL, LINTEX_DECIDE, pR, tex, dirFd, 0) != LINTEX_GO) {
+    return;
+  }
+
+  phase = statsEnter(pL->stats, STATS_DELETE);
+
+  if (pL->unlinkQ != 0) {
+    if (pL->unlinkDir == 0 &&
+        (pL->unlinkDir = unlinkqDir(pL->unlinkQ, dirFd, dirName)) == 0) {
+      noMemory(pL);
+      statsEnter(pL->stats, phase);
+      return;
+    }
+    if (unlinkqPut(pL->unlinkQ, pL->unlinkDir, name, pR->reason) != 0) {
+      noMemory(pL);
+      statsEnter(pL->stats, phase);
+      return;
+    }
+    if (pR->size > 0) {
+      statsAdd(pL->stats, STATS_BYTES, (double) pR->size);
+    }
+    statsEnter(pL->stats, phase);
+    return;
+  }
+
+  if (pL->stats != 0) {
+    t0 = statsClock();
+  }
+  err = removeAt(dirFd, name);
+  if (pL->stats != 0) {
+    statsAdd(pL->stats, STATS_UNLINKS, 1.0);
+    statsLatency(pL->stats, STATS_UNLINK, statsClock() - t0);
+    if (err == 0 && pR->size > 0) {
+      statsAdd(pL->stats, STATS_BYTES, (double) pR->size);
+    }
+  }
+  statsEnter(pL->stats, phase);
+
+  done(pL, pR, tex, err);
+}
+
+static void queued(
+  void       *arg,
+  const char *dirName,
+  const char *name,
+  int         reason,
+  int         err
+){
+
+  /**
+   | Reports the outcome of a queued removal: only its name and reason
+   | are known.
+  **/
+
+  SinkRecord rec;
+
+  sinkInit(&rec, dirName, name, SINK_REMOVED, reason);
+  done(arg, &rec, 0, err);
+}
+
+static void done(
+  Lintex     *pL,
+  SinkRecord *pR,
+  const char *tex,
+  int         err
+){
+
+  /**
+   | Tells the outcome of the removal of the file "pR": "err" is 0 or
+   | the errno value of the failure.
+  **/
+
+  if (err == 0) {
+    statsAdd(pL->stats, STATS_REMOVED, 1.0);
+  }
+  emit(pL, LINTEX_DONE, pR, tex, -1, err);
+}
+
+static int emit(
+  Lintex     *pL,
+  int         type,
+  SinkRecord *pR,
+  const char *tex,
+  int         dirFd,
+  int         err
+){
+
+  /**
+   | Calls the hook, if any, for the event "type"; returns its answer,
+   | or LINTEX_GO without a hook.
+  **/
+
+  LintexEvent ev;
+
+  if (pL->hook == 0) {
+    return LINTEX_GO;
+  }
+  ev.type  = type;
+  ev.file  = *pR;
+  ev.tex   = tex;
+  ev.dirFd = dirFd;
+  ev.err   = err;
+  return pL->hook(pL->arg, &ev);
+}
+
+static void releaseTree(
+  Lintex    *pL,
+  Froot     *teXTree,
+  Arena     *arena,
+  ArenaMark  mark
+){
+
+  /**
+   | Cleanup of the file name storage structures: an _array_ of Froot's,
+   | terminated by a NULL extension pointer as a sentinel, is assumed.
+   | The root structure and all of the linked list nodes were obtained
+   | from "arena" after "mark": they are released all together.
+  **/
+
+  putsTrace(pL, "------------------------------Phase 5: tree cleanup");
+
+  if (pL->trace != 0) {
+    Froot *pFR;
+
+    for (pFR = teXTree;   pFR->extension != 0;   pFR++) {
+      Fnode *pFN;
+      int    nNodes = 0;
+
+      fprintf(pL->trace, "Dealing with extensions %s ...", pFR->extension);
+      for (pFN = pFR->firstNode;   pFN != 0;   pFN = pFN->next) {
+        nNodes++;
+      }
+      fprintf(pL->trace, "   %d nodes freed\n", nNodes);
+    }
+  }
+
+  arenaRelease(arena, mark);
+}
+
+static void recordEntry(
+  Lintex           *pL,
+  const DentsEntry *pDe
+){
+
+  /**
+   | Records the directory entry "pDe" in the scan index, if any.
+  **/
+
+  if (pL->scanIdx != 0 &&
+      scanidxEntry(pL->scanIdx, pDe->name, pDe->len, pDe->ino,
+                   pDe->type) != 0) {
+    noMemory(pL);
+  }
+}
+
+/*-------------------*
+ | Utilities         |
+ *-------------------*/
+
+static int insertNode(
+  Arena      *arena,
+  const char *name,
+  size_t      lName,
+  time_t      mTime,
+  off_t       size,
+  int         write,
+  Froot      *root
+){
+
+  /**
+   | Creates a new Fnode in "arena", to be inserted at the _end_ of the
+   | linked list pointed to by root->firstNode (i.e., the list is
+   | organized as a "queue", a.k.a. "FIFO" list).
+   | If "lName" is bigger than zero, the file name is represented by the
+   | first lName characters of "name"; otherwise by the whole string in
+   | "name".  Returns 0, or -1 if out of memory.
+  **/
+
+  Fnode  *pFN;                  /* The new node created by insertNode */
+  size_t  sSize;                /* Structure size                     */
+
+  sSize = sizeof(Fnode) + (lName == 0 ? strlen(name) : lName);
+
+  if ((pFN = arenaAlloc(arena, sSize)) == 0) {
+    return -1;
+  }
+  pFN->mTime   = mTime;
+  pFN->size    = size;
+  pFN->write   = write;
+  pFN->next    = 0;
+  pFN->related = 0;
+
+  if (lName == 0) {
+    strcpy(pFN->name, name);
+  } else {
+    strncpy(pFN->name, name, lName);
+    pFN->name[lName] = '\0';
+  }
+
+  if (root->lastNode == 0) {
+    root->firstNode = pFN;
+  } else {
+    root->lastNode->next = pFN;
+  }
+  root->lastNode = pFN;
+  return 0;
+}
+
+static char *newString(
+  Arena      *arena,
+  const char *s1,
+  const char *s2,
+  const char *s3
+){
+
+  /**
+   | Returns the concatenation of the three given strings, in a buffer
+   | obtained from "arena"; or 0, if out of memory.
+  **/
+
+  size_t  l1 = strlen(s1), l2 = strlen(s2), l3 = strlen(s3);
+  char   *p;
+
+  if ((p = arenaAlloc(arena, l1 + l2 + l3 + 1)) == 0) {
+    return 0;
+  }
+  memcpy(p, s1, l1);
+  memcpy(p + l1, s2, l2);
+  memcpy(p + l1 + l2, s3, l3 + 1);
+  return p;
+}
+
+static int addString(
+  char     ***pArray,
+  int        *pN,
+  int        *pM,
+  const char *s
+){
+
+  /**
+   | Appends a copy of "s" to the growing array "*pArray", of "*pN"
+   | elements out of "*pM" allocated.  Returns -1 if out of memory.
+  **/
+
+  char *copy;
+
+  if (*pN == *pM) {
+    char **grown;
+    int    m = *pM == 0 ? 32 : 2 * *pM;
+
+    if ((grown = realloc(*pArray, m * sizeof(char *))) == 0) {
+      return -1;
+    }
+    *pArray = grown;
+    *pM     = m;
+  }
+  if ((copy = malloc(strlen(s) + 1)) == 0) {
+    return -1;
+  }
+  strcpy(copy, s);
+  (*pArray)[(*pN)++] = copy;
+  return 0;
+}
+
+static int compareNames(
+  const void *p1,
+  const void *p2
+){
+
+  /**
+   | Compares two file names, for qsort(3).
+  **/
+
+  return strcmp(*(char *const *) p1, *(char *const *) p2);
+}
+
+static unsigned long hashName(
+  const char *name
+){
+
+  /**
+   | FNV-1a hash of the string "name".
+  **/
+
+  unsigned long h = 2166136261UL;
+
+  while (*name != '\0') {
+    h ^= (unsigned char) *name++;
+    h  = (h * 16777619UL) & 0xffffffffUL;
+  }
+  return h;
+}
+
+static int putString(
+  FILE       *fp,
+  const char *s,
+  size_t     *pLength
+){
+
+  /**
+   | Writes the string "s", null terminated, on "fp", adding its length
+   | to "*pLength".  Returns -1 if it could not be written.
+  **/
+
+  size_t l = strlen(s) + 1;
+
+  *pLength += l;
+  return fwrite(s, 1, l, fp) == l ? 0 : -1;
+}
+
+static int badStrings(
+  const char *strings,
+  size_t      length,
+  size_t      n
+){
+
+  /**
+   | Tells whether the "length" bytes in "strings" do not hold (at
+   | least) "n" null terminated strings, followed by nulls only.
+  **/
+
+  const char *end = strings + length;
+
+  for ( ;   n > 0;   n--) {
+    const char *nul = memchr(strings, '\0', end - strings);
+
+    if (nul == 0) {
+      return 1;
+    }
+    strings = nul + 1;
+  }
+  for ( ;   strings < end;   strings++) {
+    if (*strings != '\0') {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void putsTrace(
+  Lintex     *pL,
+  const char *message
+){
+  if (pL->trace != 0) {
+    fputs(message, pL->trace);
+    putc('\n', pL->trace);
+  }
+}
+
+static void noMemory(
+  Lintex *pL
+){
+
+  /**
+   | Memory could not be obtained: the cleaning stops as soon as
+   | possible, and lintexClean() and the like return ENOMEM.
+  **/
+
+  pL->outOfMemory = TRUE;
+}
+
+static int failed(
+  Lintex     *pL,
+  const char *dirName
+){
+
+  /**
+   | Tells whether memory ran out while cleaning; the first time, the
+   | hook gets a LINTEX_ERROR event (ENOMEM) about "dirName", the
+   | directory being cleaned.
+  **/
+
+  if (pL->outOfMemory && !pL->told) {
+    SinkRecord rec;
+
+    sinkInit(&rec, dirName, 0, -1, -1);
+    emit(pL, LINTEX_ERROR, &rec, 0, -1, ENOMEM);
+    pL->told = TRUE;
+  }
+  return pL->outOfMemory;
+}
+
+static int result(
+  Lintex *pL
+){
+
+  /**
+   | What lintexClean() and the like return: 0, or -1 with errno set to
+   | ENOMEM if memory ran out.
+  **/
+
+  if (pL->outOfMemory) {
+    errno = ENOMEM;
+    return -1;
+  }
+  return 0;
+}
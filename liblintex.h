@@ -0,0 +1,177 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  liblintex: the cleanup engine of lintex, as a library.  A program
+  that cleans many trees (e.g. a build server) may compile the rules
+  once, and clean in-process as often as needed.
+
+  - LintexRules: the compiled rules, i.e. the extensions of the files
+    to be removed (".tex", the sources, comes first, and is added by
+    lintexRulesNew()), those to be kept and the trailer of the editor
+    backup files; and the subdirectories not to be visited, by name or
+    by a marker file in them (see prune.h).  Once compiled, the rules
+    are only read: they may be shared by any number of Lintex, in any
+    number of threads.  They may be saved in a file, with a stamp
+    telling what they were made from (e.g. the time of the
+    configuration file), and loaded by later runs: the file is mapped,
+    and used as it is.
+  - Lintex: a cleaner, holding everything needed while cleaning (the
+    metadata backend, the directory reader, the storage of the file
+    lists, the deletion queue, the statistics and the scan index, if
+    any).  There is no global state: every Lintex may be used by its
+    own thread.  A Lintex cleans every directory once, whatever the
+    path through which it is reached (the directories are recognized
+    by device and inode), until told to forget them.  When a mount
+    point is crossed, the file system mounted there may be skipped:
+    with LINTEX_ONE_FS if not the one of the directory given, or by
+    the policy for its type (see fstype.h).
+
+  Everything done with the files is streamed through a callback, the
+  LintexHook, as a LintexEvent:
+  - LINTEX_DECIDE: the file is to be removed (the record tells why);
+    the hook answers LINTEX_GO to have it removed, LINTEX_VETO to keep
+    it, or LINTEX_TAKEN if it has dealt with the file on its own;
+  - LINTEX_DONE: a file has been removed, or could not be ("err" is
+    then the errno value).  With an asynchronous deletion queue, this
+    comes later, and only the name and the reason of the file are
+    known;
+  - LINTEX_KEPT: a file has not been removed (the record tells why);
+  - LINTEX_EMPTY: a file with an empty extension (e.g. "paper."),
+    only with LINTEX_ALL;
+  - LINTEX_ERROR: the metadata of a file, or a directory, could not be
+    read ("name" is 0 for a directory); or, with ENOMEM, memory ran
+    out while cleaning that directory;
+  - LINTEX_NO_DIR: a directory could not be opened.
+  The hook is always called by the thread that cleans.
+
+  With LINTEX_RECORDER, the files are not classified by extension: the
+  recorder files (.fls, written by "latex -recorder") are looked for,
+  and the OUTPUT files they list in their own directory are removed if
+  newer than the .tex source with the same name as the .fls file (the
+  other rules apply: older files with LINTEX_OLDER, extensions to be
+  kept, read only files).  Only those files are probed; the other
+  entries of the directories are not even stat'ed.
+
+  A Lintex may be given a memory budget (lintexMaxMemory()): the files
+  of a directory whose lists would take more are spilled to sorted
+  temporary files (see spill.h), and each family of files (same name,
+  different extensions) is decided as these are merged.  The events
+  about such a directory then come in the order of the names.
+
+  If no memory can be obtained while cleaning, the cleaning stops: the
+  files known only in part are left alone, the hook gets a LINTEX_ERROR
+  event with ENOMEM, and lintexClean() (or the like) returns -1 with
+  errno set to ENOMEM.  The Lintex may still be used afterwards.
+*/
+
+#ifndef LIBLINTEX_H_
+#define LIBLINTEX_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include "fstype.h"
+#include "prune.h"
+#include "rules.h"
+#include "scanidx.h"
+#include "sink.h"
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - the flags of a Lintex: recurse over the subdirectories (-r),
+ |   remove the files older than their source too (-o), report the
+ |   files with an empty extension (-v), get the metadata and remove
+ |   the files through io_uring (--io-uring), do not descend into the
+ |   symbolic links to directories (--no-follow), clean from the
+ |   recorder files (--recorder, see below), do not descend into
+ |   other file systems (--one-file-system);
+ | - the events and the answers to LINTEX_DECIDE.
+**/
+
+#define LINTEX_RECURSE   1
+#define LINTEX_OLDER     2
+#define LINTEX_ALL       4
+#define LINTEX_URING     8
+#define LINTEX_NO_FOLLOW 16
+#define LINTEX_RECORDER  32
+#define LINTEX_ONE_FS    64
+
+#define LINTEX_DECIDE    0
+#define LINTEX_DONE      1
+#define LINTEX_KEPT      2
+#define LINTEX_EMPTY     3
+#define LINTEX_ERROR     4
+#define LINTEX_NO_DIR    5
+
+#define LINTEX_GO        0
+#define LINTEX_VETO      1
+#define LINTEX_TAKEN     2
+
+/**
+ | - LintexEvent: what happened to the file "file" (its directory,
+ |   name, action and reason, size and times, as written by a sink);
+ |   "tex" is the name of its .tex source without the extension, if
+ |   known; "dirFd" the directory, open, when the file may be acted
+ |   upon (-1 otherwise); "err" an errno value.
+ | - lintexRemoveExts, lintexKeepExts: the default extensions of the
+ |   files to be removed (".tex" excluded) and kept; lintexPruneDirs,
+ |   lintexPruneMarkers: the default names of the subdirectories not to
+ |   be visited, and of the marker files; all null terminated.
+**/
+
+typedef struct sLintexRules LintexRules;
+typedef struct sLintex      Lintex;
+
+typedef struct sLintexEvent {
+  int         type;
+  SinkRecord  file;
+  const char *tex;
+  int         dirFd;
+  int         err;
+} LintexEvent;
+
+typedef int LintexHook(void *, const LintexEvent *);
+
+extern const char *const lintexRemoveExts[];
+extern const char *const lintexKeepExts[];
+extern const char *const lintexPruneDirs[];
+extern const char *const lintexPruneMarkers[];
+
+LintexRules   *lintexRulesNew(const char *);
+int            lintexRulesAdd(LintexRules *, const char *, int);
+int            lintexRulesPrune(LintexRules *, const char *, int);
+int            lintexRulesCompile(LintexRules *);
+int            lintexRulesSave(const LintexRules *, const char *,
+                               const char *);
+LintexRules   *lintexRulesLoad(const char *, const char *);
+int            lintexRelevant(const LintexRules *, const char *, size_t);
+unsigned long  lintexPrint(const LintexRules *, int);
+void           lintexRulesFree(LintexRules *);
+
+Lintex        *lintexOpen(const LintexRules *, int, size_t, int,
+                          LintexHook *, void *);
+void           lintexTrace(Lintex *, FILE *);
+void           lintexStats(Lintex *, Stats *);
+void           lintexMaxDepth(Lintex *, int);
+void           lintexFsPolicy(Lintex *, FsPolicy *);
+int            lintexStatThreads(Lintex *, unsigned);
+int            lintexMaxMemory(Lintex *, size_t);
+void           lintexIndex(Lintex *, ScanIdx *);
+int            lintexClean(Lintex *, const char *);
+int            lintexCleanDir(Lintex *, const char *);
+int            lintexCleanFls(Lintex *, const char *);
+void           lintexForget(Lintex *);
+void           lintexDrain(Lintex *);
+void           lintexClose(Lintex *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBLINTEX_H_ */
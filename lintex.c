@@ -35,10 +35,13 @@
     scanned recursively.
 
   Environment: the program has been developed under Solaris 2; but
-    should run on every system supporting opendir/readdir/closedir and
-    stat.  The file names in the struct dirent (defined in <dirent.h>)
-    are assumed to be null terminated (this is guaranteed under Solaris
-    2).
+    should run on every POSIX.1-2008 system, supporting the directory
+    file descriptor relative calls (openat, fdopendir, fstatat,
+    faccessat and unlinkat).  The file type in the struct dirent
+    (d_type) and statx(2) are used when available; under Linux, the
+    directories are read in bulk with getdents64(2).  The file names
+    in the struct dirent (defined in <dirent.h>) are assumed to be null
+    terminated (this is guaranteed under Solaris 2).
 
   History:
     1.00 - 1996-07-05 , first release
@@ -77,6 +80,31 @@
                         Also remove .bcf
                         Discuss shortcomings for extension processing in
                         manpage.
+    Unreleased        , extensions containing periods (.synctex.gz,
+                        .toc.old) are matched: the file name rules are
+                        compiled in a suffix trie; --index keeps a scan
+                        index, so that the directories unchanged since the
+                        previous run are not read again; --watch keeps
+                        cleaning the directories as they change; --format
+                        writes JSON records or NUL-separated lists; --stats
+                        prints counters, timings and latencies at exit;
+                        the cleanup engine is a library, liblintex (see
+                        liblintex.h), on which this program is built;
+                        every directory is cleaned once, even if reached
+                        again through a symbolic link, a bind mount or
+                        another argument; --no-follow does not descend
+                        into the symbolic links to directories; --recorder
+                        removes the stale files listed as OUTPUT in the
+                        .fls files written by latex -recorder; with -r, the
+                        subdirectories matching the prune-dirs patterns, or
+                        holding a prune-markers file, are not visited, and
+                        --max-depth limits the descent; --one-file-system
+                        does not descend into other file systems, and
+                        --fs-policy skips, or limits the concurrency on,
+                        the file systems of the given types;
+                        --stat-threads gets the metadata of the entries of
+                        a directory with a pool of threads, as many as the
+                        stat latency calls for.
 
   ---------------------------------------------------------------------*/
 
@@ -84,18 +112,28 @@
  | Included files
 **/
 
+#define _GNU_SOURCE             /* sigaction(), st_mtim */
+
 #include <stdio.h>              /* Standard library */
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <ctype.h>
 #include <unistd.h>
 
 #include <sys/types.h>          /* Unix proper */
 #include <sys/stat.h>
-#include <dirent.h>
-
-#include <libconfig.h>          /* Configuration file support */
+#include <errno.h>
+#include <signal.h>
+
+#include "liblintex.h"          /* The cleanup engine */
+#include "dents.h"              /* Bulk directory reader */
+#include "fstype.h"             /* File system policies */
+#include "mstat.h"              /* Metadata backends */
+#include "rcfile.h"             /* Configuration file */
+#include "scanidx.h"            /* Persistent scan index */
+#include "sink.h"               /* Output formats */
+#include "stats.h"              /* Run statistics */
+#include "watch.h"              /* Watch mode */
 
 /**
  | Definitions:
@@ -126,33 +164,6 @@
 #define VERBOSE      2
 #define DEBUG        3
 
-/**
- | Type definitions:
- | - Froot: the root of a linked list structure, where file names having a
- |     given extension (pointed to by Froot.extension) will be stored;
- |     these linked lists are also used to store directory names (with fake
- |     extension strings).
- | - Fnode: an entry in the linked list of the file names; contains the
- |     file modification time, the file name and a pointer to the next node.
- |     As a side note, the so called 'struct hack', here used to store the
- |     file name, is not guaranteed to work by the current C ANSI standard;
- |     but no environment/compiler where it does not work is currently
- |     known.
-**/
-
-typedef struct sFroot {
-  char *extension;
-  struct sFnode *firstNode;
-  struct sFnode *lastNode;
-} Froot;
-
-typedef struct sFnode {
-  time_t mTime;
-  struct sFnode *next;
-  int write;
-  char name[1];
-} Fnode;
-
 /**
  | Global variables:
  | - confirm: will be 0 or 1 according to the -i command option;
@@ -163,19 +174,31 @@ typedef struct sFnode {
  | - older: will be 0 or 1 according to -o command option;
  | - bExt: the extension for backup files: defaults to "~" (the emacs
  |   convention);
- | - n_bExt: the length of the previous string;
  | - programName: the name of the executable;
- | - protoTree: Froot's of the file names having extensions relevant to
- |   TeX.  ".tex" extensions are assumed to be pointed to by protoTree[0].
- | - keep_exts: Array containing extensions to keep.
- | - protoTreeSize, keep_exts_size: number of elements in protoTree and
- |   keep_exts.
+ | - uring: will be 0 or 1 according to the --io-uring command option;
+ | - follow: will be 0 with --no-follow, 1 with --follow (the default);
+ | - recorder: will be 0 or 1 according to the --recorder command option;
+ | - maxDepth: with -r, how deep to descend (--max-depth), -1 if no limit;
+ | - oneFs: will be 0 or 1 according to the --one-file-system option;
+ | - fsPolicy: the policies given with --fs-policy, if any;
+ | - unlinkJobs: number of threads removing files (--async-unlink);
+ | - statThreads: the maximum number of threads getting the metadata
+ |   (--stat-threads), 0 if not required;
+ | - dirBuffer: size of the buffer used to read the directories
+ |   (--dir-buffer);
+ | - maxMemory: the memory budget of a directory, in bytes
+ |   (--max-memory), 0 if none;
+ | - indexFile: the file keeping the scan index (--index);
+ | - watchSettle: with --watch, the seconds a directory must be quiet
+ |   before it is cleaned (0 without);
+ | - outputFormat: the format of the output (--format), and sink the
+ |   output itself, on stdout.
+ | - statsWanted: whether statistics are collected (--stats), printed
+ |   on stderr at exit as JSON if statsJson;
+ | - rules: the extensions to be removed and kept, and the backup
+ |   trailer, compiled; lintex the cleaner following them.
 **/
 
-Froot *protoTree;
-char **keep_exts;
-int protoTreeSize;
-
 static int     confirm         = FALSE;
 static int     recurse         = FALSE;
 static int     keep            = FALSE;
@@ -183,56 +206,38 @@ static int     output_level    = WHISPER;
 static int     pretend         = FALSE;
 static int     older           = FALSE;
 static char    bExt[MAX_B_EXT] = "~";
-static size_t  n_bExt;
 static char   *programName;
-
-char *remove_exts[] = {
-  ".tex",               /* Must be first */
-  ".aux",
-  ".bbl",
-  ".bcf",
-  ".blg",
-  ".dvi",
-  ".idx",
-  ".ilg",
-  ".ind",
-  ".lof",
-  ".log",
-  ".lot",
-  ".nav",
-  ".out",
-  ".pdf",
-  ".ps",
-  ".snm",
-  ".synctex.gz",
-  ".thm",
-  ".toc",
-  ".toc.old",
-  ".xyc"
-};
-
-char *keep_exts_defaults[] = {
-  ".pdf",
-  ".ps",
-  ".dvi"
-};
-int keep_exts_size = 3;
+static int     uring           = FALSE;
+static int     follow          = TRUE;
+static int     recorder        = FALSE;
+static int     maxDepth        = -1;
+static int     oneFs           = FALSE;
+static FsPolicy *fsPolicy;
+static int     unlinkJobs      = 0;
+static int     statThreads     = 0;
+static size_t  dirBuffer       = DENTS_BUFFER;
+static size_t  maxMemory       = 0;
+static char   *indexFile;
+static unsigned long watchSettle = 0;
+static int     outputFormat    = SINK_TEXT;
+static Sink   *sink;
+static int     statsWanted     = FALSE;
+static int     statsJson       = FALSE;
+static LintexRules *rules;
+static Lintex *lintex;
 
 /**
  | Procedure prototypes (in alphabetical order)
 **/
 
+static void   addPrunes(RcFile *, const char *, const char *const *, int);
 static char  *baseName(char *);
-static Froot *buildTree(char *, Froot *);
-static void   clean(char *);
-static void   examineTree(Froot *, char *);
-static void   insertNode(char *, size_t, time_t, int, Froot *);
+static void   cleanWatched(void *, const char *);
 static void   noMemory(void);
-static void   nuke(char *);
-static void   putsMessage(char *, int);
-static void   printTree(Froot *);
-static void   releaseTree(Froot *);
-static void   setupTrees(void);
+static int    relevantName(void *, const char *, unsigned long);
+static int    report(void *, const LintexEvent *);
+static void   setupRules(void);
+static void   stopWatching(int);
 static void   syntax(void);
 
 /*---------------------------*
@@ -243,21 +248,25 @@ int main(
   int argc,
   char *argv[]
 ){
-  Froot *dirNames;              /* To hold the directories to be scanned */
-  Fnode *pFN;                   /* Running pointer over directory names  */
-  int    to_bExt  = FALSE;      /* Flag "next parameter to bExt"         */
+  char     **dirNames;          /* The directories to be scanned         */
+  int        nDirs    = 0;      /*   and their number                    */
+  Watch     *watch    = 0;      /* The watched directories, if any       */
+  Stats     *stats    = 0;      /* The statistics, if any                */
+  ScanIdx   *scanIdx  = 0;      /* The scan index, if any                */
+  int        to_bExt  = FALSE;  /* Flag "next parameter to bExt"         */
+  int        flags;             /* The flags of the cleaner              */
+  int        i;
 
   /**
    | Scans the arguments appropriately; the required directories are stored
-   | in the linked list starting at "dirNames".
+   | in the array "dirNames".
   **/
 
   programName = baseName(argv[0]);
 
-  if ((dirNames = calloc(2, sizeof(Froot))) == 0) {
+  if ((dirNames = malloc(argc * sizeof(char *))) == 0) {
     noMemory();
   }
-  dirNames->extension = "argv";
 
   while (--argc) {
     if ((*++argv)[0] == '-') {
@@ -298,6 +307,75 @@ int main(
           older = TRUE;
           break;
 
+        case '-':
+          if (strcmp(*argv, "--io-uring") == 0) {
+            uring = TRUE;
+          } else if (strcmp(*argv, "--follow") == 0) {
+            follow = TRUE;
+          } else if (strcmp(*argv, "--no-follow") == 0) {
+            follow = FALSE;
+          } else if (strcmp(*argv, "--recorder") == 0) {
+            recorder = TRUE;
+          } else if (strcmp(*argv, "--one-file-system") == 0) {
+            oneFs = TRUE;
+          } else if (strncmp(*argv, "--fs-policy=", 12) == 0) {
+            if (fsPolicy == 0 && (fsPolicy = fsPolicyNew()) == 0) {
+              noMemory();
+            }
+            if (fsPolicySet(fsPolicy, *argv + 12) != 0) {
+              syntax();
+            }
+          } else if (strcmp(*argv, "--async-unlink") == 0) {
+            unlinkJobs = 1;
+          } else if (strncmp(*argv, "--async-unlink=", 15) == 0) {
+            if ((unlinkJobs = atoi(*argv + 15)) < 1) {
+              syntax();
+            }
+          } else if (strcmp(*argv, "--stat-threads") == 0) {
+            statThreads = MSTAT_THREADS;
+          } else if (strncmp(*argv, "--stat-threads=", 15) == 0) {
+            if ((statThreads = atoi(*argv + 15)) < 1) {
+              syntax();
+            }
+          } else if (strncmp(*argv, "--max-depth=", 12) == 0) {
+            if (!isdigit((unsigned char) (*argv)[12])) {
+              syntax();
+            }
+            maxDepth = atoi(*argv + 12);
+          } else if (strncmp(*argv, "--dir-buffer=", 13) == 0) {
+            if (atoi(*argv + 13) < 1) {
+              syntax();
+            }
+            dirBuffer = (size_t) atoi(*argv + 13) * 1024;
+          } else if (strncmp(*argv, "--max-memory=", 13) == 0) {
+            if (atoi(*argv + 13) < 1) {
+              syntax();
+            }
+            maxMemory = (size_t) atoi(*argv + 13) * 1024;
+          } else if (strncmp(*argv, "--index=", 8) == 0 && (*argv)[8]) {
+            indexFile = *argv + 8;
+          } else if (strcmp(*argv, "--watch") == 0) {
+            watchSettle = 5;
+          } else if (strncmp(*argv, "--watch=", 8) == 0) {
+            if (atoi(*argv + 8) < 1) {
+              syntax();
+            }
+            watchSettle = atoi(*argv + 8);
+          } else if (strcmp(*argv, "--stats") == 0 ||
+                     strcmp(*argv, "--stats=text") == 0) {
+            statsWanted = TRUE;
+          } else if (strcmp(*argv, "--stats=json") == 0) {
+            statsWanted = TRUE;
+            statsJson   = TRUE;
+          } else if (strncmp(*argv, "--format=", 9) == 0) {
+            if ((outputFormat = sinkFormat(*argv + 9)) < 0) {
+              syntax();
+            }
+          } else {
+            syntax();
+          }
+          break;
+
         default:
           syntax();
       }
@@ -307,7 +385,7 @@ int main(
         strcpy(bExt, *argv);
         to_bExt = FALSE;
       } else {
-        insertNode(*argv, 0, 0, 0, dirNames);
+        dirNames[nDirs++] = *argv;
       }
     }
   }
@@ -315,620 +393,480 @@ int main(
   if (to_bExt) {
     syntax();
   }
-  n_bExt = strlen(bExt);
 
-  setupTrees();
-
-  /**
-   | If no parameter has been given, clean the current directory
-  **/
-
-  if ((pFN = dirNames->firstNode) == 0) {
-    clean(".");
-  } else {
-    while (pFN != 0) {
-      clean(pFN->name);
-      pFN = pFN->next;
-    }
+  if ((sink = sinkOpen(stdout, outputFormat)) == 0) {
+    noMemory();
+  }
+  if (statsWanted && (stats = statsOpen()) == 0) {
+    noMemory();
   }
-  releaseTree(dirNames);
-
-  return EXIT_SUCCESS;
-}
 
-/*------------------------------------------*
- | The called procedures (in logical order) |
- *------------------------------------------*/
+  setupRules();
 
-static void setupTrees(void)
-{
   /**
-   | Initialise protoTree, keep_exts
+   | The cleaner: -v reports the files with an empty extension too; in
+   | pretend mode nothing is removed, and no deletion queue is needed.
   **/
-  config_t cfg;                 /* To hold our config                    */
-  config_setting_t *setting;    /* To hold a setting                     */
-  int i;                        /* Iterator                              */
-  int needed;                   /* number of characters in filename      */
-  char *extension, *cfg_file;
 
-  if (output_level >= DEBUG)
-    printf("Initialising protoTree, keep_exts.\n");
+  flags = (recurse ? LINTEX_RECURSE : 0) | (older ? LINTEX_OLDER : 0) |
+          (output_level >= VERBOSE ? LINTEX_ALL : 0) |
+          (uring ? LINTEX_URING : 0) | (follow ? 0 : LINTEX_NO_FOLLOW) |
+          (recorder ? LINTEX_RECORDER : 0) | (oneFs ? LINTEX_ONE_FS : 0);
 
-  protoTreeSize = sizeof(remove_exts) / sizeof(char *) + 1;
-  if ((protoTree = malloc(sizeof(Froot) * protoTreeSize)) == 0) {
-      noMemory();
+  lintex = lintexOpen(rules, flags, dirBuffer, pretend ? 0 : unlinkJobs,
+                      report, 0);
+  if (lintex == 0) {
+    noMemory();
   }
-  /* remove_exts has (protoTreeSize - 1) elements */
-  if (output_level >= DEBUG)
-    printf("Created protoTree of size %d\n", protoTreeSize);
-  for (i=0; i < protoTreeSize - 1; i++) {
-    protoTree[i].extension = remove_exts[i];
-    protoTree[i].firstNode = 0;
-    protoTree[i].lastNode = 0;
-    if (output_level >= DEBUG)
-      printf("Added %d-th extension %s to protoTree of size %d at pos %d\n",
-              i, remove_exts[i], protoTreeSize, i);
+  if (output_level >= DEBUG) {
+    lintexTrace(lintex, stdout);
   }
+  if (lintexStatThreads(lintex, statThreads) != 0 ||
+      lintexMaxMemory(lintex, maxMemory) != 0) {
+    noMemory();
+  }
+  lintexStats(lintex, stats);
+  lintexMaxDepth(lintex, maxDepth);
+  lintexFsPolicy(lintex, fsPolicy);
 
-  /* Add the sentinel */
-  protoTree[protoTreeSize - 1].extension = 0;
-  protoTree[protoTreeSize - 1].firstNode = 0;
-  protoTree[protoTreeSize - 1].lastNode = 0;
-  if (output_level >= DEBUG)
-    printf("Added sentinal to protoTree at pos %d.\n", protoTreeSize - 1);
+  if (indexFile != 0) {
+    if ((scanIdx = scanidxOpen(indexFile, lintexPrint(rules, flags))) == 0) {
+      noMemory();
+    }
+    lintexIndex(lintex, scanIdx);
+  }
 
-  keep_exts = keep_exts_defaults;
   /**
-   | Initialise and read the config file
+   | If no parameter has been given, clean the current directory.  With
+   | --watch, the directories are watched before the first cleanup, so
+   | that no change is missed.
   **/
 
-  config_init(&cfg);
-
-  needed = strlen(getenv("HOME")) + strlen("/.lintexrc") + 1;
-  cfg_file = (char *) malloc(sizeof(char) * needed);
-  if (getenv("HOME")) {
-    strcpy(cfg_file, getenv("HOME"));
-    strcat(cfg_file, "/.lintexrc");
-    if (output_level >= DEBUG)
-      printf("Using config file %s.\n", cfg_file);
+  if (nDirs == 0) {
+    dirNames[nDirs++] = ".";
   }
 
-  if (! access(cfg_file, R_OK)) {
-    /* We have read access to the config file */
-    if (! config_read_file(&cfg, cfg_file)) {
-      fprintf(stderr, "%s:%d - %s\n", config_error_file(&cfg),
-              config_error_line(&cfg), config_error_text(&cfg));
-      config_destroy(&cfg);
+  if (watchSettle > 0) {
+    watch = watchOpen(watchSettle * 1000, recurse, relevantName,
+                      cleanWatched, 0);
+    if (watch == 0) {
+      fprintf(stderr, "%s: cannot watch directories: %s\n", programName,
+              strerror(errno));
       exit(EXIT_FAILURE);
     }
-
-    /* Lets extract our settings */
-    /* Extensions to remove */
-    setting = config_lookup(&cfg, "remove-exts");
-    if (setting != NULL) {
-      unsigned int count = config_setting_length(setting);
-
-      Froot *protoTreeTemp;
-      if ((protoTreeTemp = (Froot *) malloc(sizeof(Froot) * (count + protoTreeSize))) == 0) {
-        noMemory();
+    for (i = 0;   i < nDirs;   i++) {
+      if (watchAdd(watch, dirNames[i]) != 0) {
+        fprintf(stderr, "%s: \"%s\" not (entirely) watched: %s\n",
+                programName, dirNames[i], strerror(errno));
       }
-      memcpy(protoTreeTemp, protoTree, sizeof(Froot) * protoTreeSize);
-      if (output_level >= DEBUG)
-        printf("Copied protoTree to larger location to add config exts.\n");
-
-      for (i = 0; i < count; i++) {
-        extension = (char *) config_setting_get_string_elem(setting, i);
-        protoTreeTemp[protoTreeSize - 1 + i].extension = extension;
-        protoTreeTemp[protoTreeSize - 1 + i].firstNode = 0;
-        protoTreeTemp[protoTreeSize - 1 + i].lastNode = 0;
-        if (output_level >= DEBUG)
-          printf("Added %d-th config extension %s to protoTree of size %d at pos %d\n",
-                i, extension, protoTreeSize + count, protoTreeSize - 1 + i);
-      }
-
-      /* Add the sentinel */
-      protoTreeTemp[protoTreeSize - 1 + count].extension = 0;
-      protoTreeTemp[protoTreeSize - 1 + count].firstNode = 0;
-      protoTreeTemp[protoTreeSize - 1 + count].lastNode = 0;
-      protoTree = protoTreeTemp;
-      if (output_level >= DEBUG)
-        printf("Added sentinel to protoTree at position %d\n", protoTreeSize - 1 + count);
-
-      protoTreeSize += count;
     }
+  }
+
+  /**
+   | With --recorder, a recorder file may be given instead of a
+   | directory.
+  **/
 
-    /* Extensions to keep */
-    setting = config_lookup(&cfg, "keep-exts");
-    if (setting != NULL) {
-      int i;
-      keep_exts_size = config_setting_length(setting);
+  for (i = 0;   i < nDirs;   i++) {
+    struct stat st;
+    size_t      len = strlen(dirNames[i]);
 
-      if ((keep_exts = (char **) malloc(sizeof(char *) * keep_exts_size)) == 0) {
+    if (recorder && len > 4 && strcmp(dirNames[i] + len - 4, ".fls") == 0 &&
+        stat(dirNames[i], &st) == 0 && !S_ISDIR(st.st_mode)) {
+      if (lintexCleanFls(lintex, dirNames[i]) != 0) {
         noMemory();
       }
-
-      for (i = 0; i < keep_exts_size; i++) {
-        keep_exts[i] = (char *) config_setting_get_string_elem(setting, i);
-        if (output_level >= DEBUG)
-          printf("Added %d-th config extension %s to keep_exts of size %d at pos %d\n",
-                i, keep_exts[i], keep_exts_size, i);
-      }
-    }
-  } else {
-    if (! access(cfg_file, F_OK)) {
-      /* File exists */
-      fprintf(stderr,
-        "Warning: Insufficient permissions to read config file $HOME/.lintexrc");
+    } else if (lintexClean(lintex, dirNames[i]) != 0) {
+      noMemory();
     }
   }
-}
-
-static void insertNode(
-  char   *name,
-  size_t  lName,
-  time_t  mTime,
-  int write,
-  Froot  *root
-){
 
-  /**
-   | Creates a new Fnode, to be inserted at the _end_ of the linked
-   | list pointed to by root->firstNode (i.e., the list is organized
-   | as a "queue", a.k.a. "FIFO" list): if a new node cannot be created,
-   | an error message is printed and the program aborted.
-   | If "lName" is bigger than zero, the file name is represented by the
-   | first lName characters of "name"; otherwise by the whole string in
-   | "name".
-  **/
+  if (watch != 0) {
+    struct sigaction sa;
 
-  Fnode  *pFN;                  /* The new node created by insertNode */
-  size_t  sSize;                /* Structure size                     */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stopWatching;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
 
-  sSize = sizeof(Fnode) + (lName == 0 ? strlen(name) : lName);
+    lintexDrain(lintex);
+    sinkFlush(sink);
 
-  if ((pFN = malloc(sSize)) == 0) {
-    noMemory();
+    if (watchRun(watch) != 0) {
+      fprintf(stderr, "%s: watch failed: %s\n", programName,
+              strerror(errno));
+    }
+    watchClose(watch);
   }
-  pFN->mTime = mTime;
-  pFN->write = write;
-  pFN->next  = 0;
-
-  if (lName == 0) {
-    strcpy(pFN->name, name);
-  } else {
-    strncpy(pFN->name, name, lName);
-    pFN->name[lName] = '\0';
+  free(dirNames);
+
+  lintexClose(lintex);
+  lintexRulesFree(rules);
+  fsPolicyFree(fsPolicy);
+
+  if (scanidxClose(scanIdx) != 0) {
+    fprintf(stderr, "%s: index \"%s\" not written: %s\n", programName,
+            indexFile, strerror(errno));
   }
 
-  if (root->lastNode == 0) {
-    root->firstNode = pFN;
-  } else {
-    root->lastNode->next = pFN;
+  statsPrint(stats, stderr, statsJson);
+  statsClose(stats);
+
+  if (sinkClose(sink) != 0) {
+    fprintf(stderr, "%s: output not written: %s\n", programName,
+            strerror(errno));
+    return EXIT_FAILURE;
   }
-  root->lastNode = pFN;
-}
 
-static void noMemory(void)
-{
-  fprintf(stderr, "%s: couldn't obtain heap memory\n", programName);
-  exit(EXIT_FAILURE);
+  return EXIT_SUCCESS;
 }
 
-static void clean(
-  char *dirName
-){
+/*------------------------------------------*
+ | The called procedures (in logical order) |
+ *------------------------------------------*/
 
+static void setupRules(void)
+{
   /**
-   | Does the job for the directory "dirName".
+   | Initialise the rules: the default extensions, those read from the
+   | config file, and the extensions to keep if -k has been given.
    |
-   | Builds a structure holding the TeX-related files, and does the
-   | required cleanup; finally, removes the file structure.
-   | If the list appended to "dirs" has been filled, recurse over the
-   | tree of subdirectories.
+   | The rules made from ~/.lintexrc are saved, compiled, next to it in
+   | ~/.lintexrc.cache, with a stamp telling the identity, permissions
+   | and time of the config file (and -k, -b and the version): while
+   | the stamp holds, later runs map the compiled rules from there,
+   | without even reading the config file.
   **/
+  RcFile *rc = 0;               /* The config file, if read              */
+  struct stat st;               /*   and its metadata                    */
+  char *home = getenv("HOME");
+  char *cfg_file = 0, *cache_file = 0;
+  char stamp[256];              /* What the rules are made from          */
+  int stamped = FALSE;          /* Is there a config file?               */
+  int i, n;                     /* Iterator, number of extensions        */
 
-  Froot *teXTree;               /* Root node of the TeX-related files  */
-  Froot *dirs;                  /* Subdirectories in this directory    */
-  Fnode *pFN;                   /* Running pointer over subdirectories */
-
-  if ((dirs = calloc(2, sizeof(Froot))) == 0) {
-    noMemory();
-  }
-  dirs->extension = "subs";
+  if (output_level >= DEBUG)
+    printf("Initialising the rules.\n");
 
-  if ((teXTree = buildTree(dirName, dirs)) != 0) {
+  if (home != 0) {
+    size_t needed = strlen(home) + strlen("/.lintexrc.cache") + 1;
 
-    if (output_level >= DEBUG) {
-      printTree(teXTree);
+    if ((cfg_file = malloc(needed)) == 0 ||
+        (cache_file = malloc(needed)) == 0) {
+      noMemory();
     }
+    sprintf(cfg_file, "%s/.lintexrc", home);
+    sprintf(cache_file, "%s.cache", cfg_file);
+    if (output_level >= DEBUG)
+      printf("Using config file %s.\n", cfg_file);
 
-    examineTree(teXTree, dirName);
-    releaseTree(teXTree);
+    if (stat(cfg_file, &st) == 0) {
+      sprintf(stamp, "lintex %s rc=%lu:%lu:%lo:%ld:%ld.%09ld k=%d b=%s",
+              VERSION, (unsigned long) st.st_dev, (unsigned long) st.st_ino,
+              (unsigned long) st.st_mode, (long) st.st_size,
+              (long) st.st_mtim.tv_sec, (long) st.st_mtim.tv_nsec, keep,
+              bExt);
+      stamped = TRUE;
+      if ((rules = lintexRulesLoad(cache_file, stamp)) != 0) {
+        if (output_level >= DEBUG)
+          printf("Using the compiled rules in %s.\n", cache_file);
+        free(cfg_file);
+        free(cache_file);
+        return;
+      }
+    }
   }
 
-  for (pFN = dirs->firstNode;   pFN != 0;   pFN = pFN->next) {
-    clean(pFN->name);
+  if ((rules = lintexRulesNew(bExt)) == 0) {
+    noMemory();
+  }
+  for (i = 0; lintexRemoveExts[i] != 0; i++) {
+    if (lintexRulesAdd(rules, lintexRemoveExts[i], RULE_REMOVE) != 0) {
+      noMemory();
+    }
+    if (output_level >= DEBUG)
+      printf("Added %d-th extension %s to the rules\n", i,
+             lintexRemoveExts[i]);
   }
-  releaseTree(dirs);
-}
-
-static Froot *buildTree(
-  char  *dirName,
-  Froot *subDirs
-){
 
   /**
-   | - Opens the required directory;
-   | - allocates a structure to hold the names of the TeX-related files,
-   |   initialized from the global structure "protoTree";
-   | - starts a loop over all the files of the given directory.
+   | Read the config file
   **/
 
-  DIR           *pDir;         /* Pointer returned from opendir()    */
-  struct dirent *pDe;          /* Pointer returned from readdir()    */
-  Froot         *teXTree;      /* Root node of the TeX-related files */
-
-  if (output_level >= DEBUG) {
-    printf("* Scanning directory \"%s\" - confirm = %c, recurse = %c, ",
-         dirName, (confirm ? 'Y' : 'N'), (recurse ? 'Y' : 'N')),
-    printf("keep = %c\n", (keep ? 'Y' : 'N'));
-    printf("* Editor trailer: \"%s\"\n", bExt);
-    puts("------------------------------Phase 1: directory scan");
+  if (stamped) {
+    if (! access(cfg_file, R_OK)) {
+      /* We have read access to the config file */
+      if ((rc = rcOpen(cfg_file)) == 0) {
+        noMemory();
+      }
+      if (rcError(rc) != 0) {
+        fprintf(stderr, "%s\n", rcError(rc));
+        rcClose(rc);
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      /* File exists */
+      fprintf(stderr,
+        "Warning: Insufficient permissions to read config file $HOME/.lintexrc");
+    }
   }
 
-  if ((pDir = opendir(dirName)) == 0) {
-    fprintf(stderr,
-            "%s: \"%s\" cannot be opened (or is not a directory)\n",
-            programName, dirName);
-    return 0;
-  }
+  /* Extensions to remove */
+  n = rc == 0 ? -1 : rcLength(rc, "remove-exts");
+  for (i = 0; i < n; i++) {
+    const char *extension = rcString(rc, "remove-exts", i);
 
-  if ((teXTree = malloc(protoTreeSize * sizeof(Froot))) == 0) {
-    noMemory();
+    if (extension == 0) {
+      continue;
+    }
+    if (lintexRulesAdd(rules, extension, RULE_REMOVE) != 0) {
+      noMemory();
+    }
+    if (output_level >= DEBUG)
+      printf("Added %d-th config extension %s to the rules\n", i,
+             extension);
   }
-  memcpy(teXTree, protoTree, protoTreeSize * sizeof(Froot));
 
-  while ((pDe = readdir(pDir)) != 0) {
-    char    tName[FILENAME_MAX];         /* Fully qualified file name       */
-    struct  stat sStat;                  /* To be filled by stat(2)         */
-    size_t  len;                         /* Lenght of the current file name */
-    size_t  last;                        /* Index of its last character     */
-    char   *pFe;                         /* Pointer to file extension       */
-
-    /**
-     | - Tests for empty inodes (already removed files);
-     | - skips the . and .. (current and previous directory);
-     | - tests the trailing part of the file name against the extension of
-     |   the backup files, to be always deleted.
-    **/
+  /* Extensions to keep, if -k has been given */
+  if (keep) {
+    n = rc == 0 ? -1 : rcLength(rc, "keep-exts");
+    if (n < 0) {
+      for (i = 0; lintexKeepExts[i] != 0; i++) {
+        if (lintexRulesAdd(rules, lintexKeepExts[i], RULE_KEEP) != 0) {
+          noMemory();
+        }
+      }
+    }
+    for (i = 0; i < n; i++) {
+      const char *extension = rcString(rc, "keep-exts", i);
 
-    if (pDe->d_ino == 0)                continue;
-    if (strcmp(pDe->d_name, ".")  == 0) continue;
-    if (strcmp(pDe->d_name, "..") == 0) continue;
+      if (extension == 0) {
+        continue;
+      }
+      if (lintexRulesAdd(rules, extension, RULE_KEEP) != 0) {
+        noMemory();
+      }
+      if (output_level >= DEBUG)
+        printf("Added %d-th config extension %s to the extensions to keep\n",
+               i, extension);
+    }
+  }
 
-    sprintf(tName, "%s/%s", dirName, pDe->d_name);
+  /* Subdirectories not to be visited, by name and by marker file */
+  addPrunes(rc, "prune-dirs", lintexPruneDirs, PRUNE_NAME);
+  addPrunes(rc, "prune-markers", lintexPruneMarkers, PRUNE_MARKER);
 
-    len  = strlen(pDe->d_name);
-    last = len - 1;
+  if (lintexRulesCompile(rules) != 0) {
+    noMemory();
+  }
+  if (rc != 0 && lintexRulesSave(rules, cache_file, stamp) != 0 &&
+      output_level >= DEBUG) {
+    printf("Compiled rules not saved in %s: %s\n", cache_file,
+           strerror(errno));
+  }
+  rcClose(rc);
+  free(cfg_file);
+  free(cache_file);
+}
 
-    if (n_bExt != 0) {                  /* If 0, no backup files to delete */
-      int crit;                         /* What exceeds backup extensions  */
+static int report(
+  void              *arg,
+  const LintexEvent *pE
+){
 
-      crit = len - n_bExt;
-      if (crit > 0   &&   strcmp(pDe->d_name + crit, bExt) == 0) {
-        nuke(tName);
-        continue;
-      }
-    }
+  /**
+   | Tells what the cleaner does, at the required output level; before
+   | a file is removed, in pretend mode tells that it would have been,
+   | and with -i asks the user.
+  **/
 
-    /**
-     | If the file is a directory and the -r option has been given, stores
-     | the directory name in the linked list pointed to by "subDirs", for
-     | recursive calls.
-     |
-     | N.B.: if stat(2) fails, the file is skipped.
-    **/
-
-    if (stat(tName, &sStat) != 0) {
-      fprintf(stderr, "File \"%s", tName);
-      perror("\"");
-      continue;
-    }
+  SinkRecord  rec  = pE->file;
+  const char *dir  = rec.dir;
+  const char *name = rec.name;
 
-    if (S_ISDIR(sStat.st_mode) != 0) {
+  (void) arg;
 
-      if (output_level >= DEBUG) {
-        printf("File %s - is a directory\n", pDe->d_name);
+  switch (pE->type) {
+    case LINTEX_DECIDE:
+      if (pretend) {
+        /* We don't need to continue if we aren't going to remove the file */
+        rec.action = SINK_PRETEND;
+        sinkEvent(sink, &rec, "*** File \"%s/%s\" would have been removed ***\n",
+                  dir, name);
+        return LINTEX_VETO;
       }
 
-      if (recurse) {
-        insertNode(tName, 0, 0, 0, subDirs);
+      if (output_level >= DEBUG) {
+        printf("*** File \"%s/%s\" would have been removed ***\n", dir,
+               name);
       }
-      continue;
-    }
 
-    /**
-     | If the file has an extension (the rightmost dot followed by at
-     | least one character), and if that extension matches one of the
-     | entries in teXTree[i].extension: stores the file name (with the
-     | extension stripped) in the appropriate linked list, together with
-     | its modification time.
-    **/
+      if (confirm) {
+        char yn[LONG_ENOUGH], c;
 
-    if ((pFe = strrchr(pDe->d_name, '.')) != 0) {
-      size_t nameLen;
+        do {
+          printf("Remove %s/%s (y|n) ? ", dir, name);
+          sinkFlush(sink);
+          if (fgets(yn, LONG_ENOUGH, stdin) == 0) return LINTEX_VETO;
+          if (yn[0] == '\0' || (c = tolower((unsigned char) yn[0])) == 'n') {
+            return LINTEX_VETO;
+          }
+        } while (c != 'y');
+      }
+      return LINTEX_GO;
+
+    case LINTEX_DONE:
+      if (pE->err != 0) {
+        fprintf(stderr, "File \"%s/%s\": %s\n", dir, name,
+                strerror(pE->err));
+      } else if (output_level >= WHISPER) {
+        sinkEvent(sink, &rec, "%s/%s has been removed\n", dir, name);
+      }
+      break;
 
-      nameLen = pFe - pDe->d_name;
-      if (nameLen < last) {
-        Froot *pTT;
+    case LINTEX_KEPT:
+      if (output_level < VERBOSE) {
+        break;
+      }
+      switch (rec.reason) {
+        case SINK_KEEP:
+          sinkEvent(sink, &rec, "*** %s not removed; keep activated ***\n",
+                    name);
+          break;
 
-        if (output_level >= DEBUG) {
-          printf("File %s - extension %s", pDe->d_name, pFe);
-        }
+        case SINK_READ_ONLY:
+          sinkEvent(sink, &rec, "*** %s/%s not removed; it is read only ***\n",
+                    dir, name);
+          break;
 
-        /**
-         | Loop on recognized TeX-related file extensions
-        **/
-
-        for (pTT = teXTree;   pTT->extension != 0;   pTT++) {
-          if (strcmp(pFe, pTT->extension) == 0) {
-            int i;
-            if (keep) {
-              i = 0;
-            } else {
-              i = keep_exts_size;
-            }
-            for (i = 0; i < keep_exts_size; i++) {
-              if (strcmp(pFe, keep_exts[i]) == 0) {
-                /**
-                 | The current file's extension is in keep_exts, we want to keep
-                 | it.
-                **/
-                i = -1;
-                break;
-              }
-            }
+        case SINK_TEX_NEWER:
+          sinkEvent(sink, &rec,
+                    "*** %s/%s not removed; %s/%s.tex is newer ***\n",
+                    dir, name, dir, pE->tex);
+          break;
 
-            if ((!keep) | (i != -1)) {
-              /**
-               | Only add the file if we didn't find its extension in keep_exts
-              **/
-              insertNode(pDe->d_name, nameLen, sStat.st_mtime, access(tName, W_OK), pTT);
-              if (output_level >= DEBUG) {
-                printf(" - inserted in tree");
-              }
-            } else if (keep) {
-              if (output_level >= DEBUG) {
-                printf(" - not inserted in tree (extension in keep-exts)");
-              } else if (output_level >= VERBOSE) {
-                printf("*** %s not removed; keep activated ***\n", pDe->d_name);
-              }
-            }
-            break;
-          }
-        } /* loop on known extensions */
+        case SINK_NO_TEX:
+          sinkEvent(sink, &rec,
+                    "*** %s/%s not removed; no .tex file found ***\n",
+                    dir, name);
+          break;
+      }
+      break;
 
-        if (output_level >= DEBUG) {
-          puts("");
-        }
+    case LINTEX_EMPTY:
+      sinkEvent(sink, 0, "File %s - empty extension\n", name);
+      break;
 
+    case LINTEX_ERROR:
+      if (name != 0) {
+        fprintf(stderr, "File \"%s/%s\": %s\n", dir, name,
+                strerror(pE->err));
       } else {
-        if (output_level >= VERBOSE) {
-          printf("File %s - empty extension\n", pDe->d_name);
-        }
+        fprintf(stderr, "Directory \"%s\": %s\n", dir, strerror(pE->err));
       }
+      break;
 
-    } else {
-      if (output_level >= DEBUG) {
-        printf("File %s - without extension\n", pDe->d_name);
-      }
-    }
-  }             /* while (readdir) ... */
-
-  if (closedir(pDir) != 0) {
-    fprintf(stderr, "Directory \"%s", dirName);
-    perror("\"");
+    case LINTEX_NO_DIR:
+      fprintf(stderr,
+              "%s: \"%s\" cannot be opened (or is not a directory)\n",
+              programName, dir);
+      break;
   }
-
-  return teXTree;
+  return LINTEX_GO;
 }
 
-static void printTree(
-  Froot *teXTree
+static int relevantName(
+  void          *arg,
+  const char    *name,
+  unsigned long  len
 ){
 
   /**
-   | Prints all the file names archived in the linked lists (for
-   | debugging purposes).
+   | While watching, tells whether a change to the file "name" may need
+   | a cleanup: with --recorder, only the recorder files matter.
   **/
 
-  if (output_level >= DEBUG) {
-    Froot *pTT;           /* Running pointer over teXTree elements */
-
-    puts("------------------------------Phase 2: tree printout");;
-    for (pTT = teXTree;   pTT->extension != 0;   pTT++) {
-      Fnode *pTeX;              /* Running pointer over TeX-related files */
-      int    nNodes = 0;        /* Counter */
+  (void) arg;
 
-      for (pTeX = pTT->firstNode;   pTeX != 0;   pTeX = pTeX->next) {
-        ++nNodes;
-        printf("%s%s\n", pTeX->name, pTT->extension);
-      }
-      printf("  --> %d file%s with extension %s\n", nNodes,
-             (nNodes == 1 ? "" : "s"), pTT->extension);
-    }
+  if (recorder) {
+    return len > 4 && strcmp(name + len - 4, ".fls") == 0;
   }
+  return lintexRelevant(rules, name, len);
 }
 
-static void examineTree(
-  Froot *teXTree,
-  char  *dirName
+static void addPrunes(
+  RcFile            *rc,
+  const char        *setting,
+  const char *const *defaults,
+  int                what
 ){
 
   /**
-   | Examines the linked lists for this directory doing the effective
-   | cleanup.
-  **/
-
-  Froot *pTT;           /* Pointer over linked list trees      */
-  Fnode *pTeX;          /* Running pointer over the .tex files */
-
-  /**
-   | Looks, for all the .tex files, if a corresponding entry with the same
-   | name exists (with a different extension) in the other lists; if so,
-   | and if its modification time is later than the one of the related
-   | .tex file, removes it from the file system.
+   | Adds to the rules the prune patterns (or markers: "what") in the
+   | list "setting" of the config file, or the defaults if missing.
   **/
-  putsMessage("------------------------------Phase 3: effective cleanup",
-              DEBUG);
 
-  for (pTeX = teXTree->firstNode;   pTeX != 0;   pTeX = pTeX->next) {
-    char tName[FILENAME_MAX];
+  int i, n = rc == 0 ? -1 : rcLength(rc, setting);
 
-    sprintf(tName, "%s/%s.tex", dirName, pTeX->name);
-    pTT = teXTree;
-
-    if (output_level >= DEBUG) {
-      printf("    Finding files related to %s:\n", tName);
-    }
-
-    for (pTT++;   pTT->extension != 0;   pTT++) {
-      Fnode *pComp;
-
-      for (pComp = pTT->firstNode;   pComp != 0;   pComp = pComp->next) {
-        char cName[FILENAME_MAX];
-
-        if (strcmp(pTeX->name, pComp->name) == 0) {
-          sprintf(cName, "%s/%s%s", dirName, pTeX->name, pTT->extension);
-          pComp->name[0] = '\0';
-
-          /**
-           | Remove generated file if more recent than source (default) or if
-           | we permit the removal of files older than source
-          **/
-          if (difftime(pComp->mTime, pTeX->mTime) > 0.0 || older) {
-            if (pComp->write == 0) {
-              nuke(cName);
-            } else {
-              if (output_level >= DEBUG) {
-                printf("*** %s readonly; perms are %d***\n", cName,
-                       pComp->write);
-              }
-              if (output_level >= VERBOSE) {
-                printf("*** %s not removed; it is read only ***\n", cName);
-              }
-            }
-          } else {
-            if (output_level >= VERBOSE) {
-              printf("*** %s not removed; %s is newer ***\n", cName, tName);
-            }
-          }
-          break;
-        }
-      }
+  for (i = 0; n < 0 && defaults[i] != 0; i++) {
+    if (lintexRulesPrune(rules, defaults[i], what) != 0) {
+      noMemory();
     }
   }
+  for (i = 0; i < n; i++) {
+    const char *text = rcString(rc, setting, i);
 
-  /**
-   | If some garbage file has not been deleted, list it
-  **/
-
-  putsMessage("------------------------------Phase 4: left garbage files",
-              DEBUG);
-
-  pTT = teXTree;
-  for (pTT++;  pTT->extension != 0;  pTT++) {
-    Fnode *pComp;
-
-    for (pComp = pTT->firstNode;   pComp != 0;   pComp = pComp->next) {
-      if (pComp->name[0] != '\0') {
-        char cName[FILENAME_MAX];
-
-        sprintf(cName, "%s/%s%s", dirName, pComp->name, pTT->extension);
-        if (output_level >= VERBOSE) {
-          printf("*** %s not removed; no .tex file found ***\n", cName);
-        }
-      }
+    if (text == 0) {
+      continue;
+    }
+    if (lintexRulesPrune(rules, text, what) != 0) {
+      noMemory();
     }
+    if (output_level >= DEBUG)
+      printf("Added %d-th config entry %s to %s\n", i, text, setting);
   }
 }
 
-static void releaseTree(
-  Froot *teXTree
+static void cleanWatched(
+  void       *arg,
+  const char *dirName
 ){
 
   /**
-   | Cleanup of the file name storage structures: an _array_ of Froot's,
-   | terminated by a NULL extension pointer as a sentinel, is assumed.
-   | Every linked list nodes is freed; then releaseTree frees also the
-   | root structure.
+   | While watching, cleans the directory "dirName" that has changed
+   | (its subdirectories are watched, and cleaned, on their own),
+   | reporting at once what has been done.
   **/
 
-  Froot *pFR;
-
-  putsMessage("------------------------------Phase 5: tree cleanup", DEBUG);
-
-  for (pFR = teXTree;   pFR->extension != 0;   pFR++) {
-    Fnode *pFN, *p;
-
-    int nNodes = 0;
-    if (output_level >= DEBUG) {
-      printf("Dealing with extensions %s ...", pFR->extension);
-    }
-
-    for (pFN = pFR->firstNode;   pFN != 0;   pFN = p) {
-      p = pFN->next;
-      free(pFN);
-
-      nNodes++;
-    }
+  (void) arg;
 
-    if (output_level >= DEBUG) {
-      printf("   %d nodes freed\n", nNodes);
-    }
+  if (lintexCleanDir(lintex, dirName) != 0) {
+    noMemory();
   }
-
-  free(teXTree);
+  lintexDrain(lintex);
+  sinkFlush(sink);
 }
 
-static void nuke(
-  char *name
+static void stopWatching(
+  int sig
 ){
 
   /**
-   | Removes "name" (the fully qualified file name) from the file system
+   | Interrupts the watch (SIGINT, SIGTERM), so that the program ends
+   | as usual.
   **/
 
-  if ((output_level >= DEBUG) || pretend) {
-    printf("*** File \"%s\" would have been removed ***\n", name);
-  }
-
-  if (pretend) {
-    /* We don't need to continue if we aren't going to remove the file */
-    return;
-  }
-
-  if (confirm) {
-    char yn[LONG_ENOUGH], c;
-
-    do {
-      printf("Remove %s (y|n) ? ", name);
-      if (fgets(yn, LONG_ENOUGH, stdin) == 0) return;
-      if (yn[0] == '\0' || (c = tolower((unsigned char) yn[0])) == 'n') {
-        return;
-      }
-    } while (c != 'y');
-  }
+  (void) sig;
+}
 
-  if (remove(name) != 0) {
-    fprintf(stderr, "File \"%s", name);
-    perror("\"");
-  } else {
-    if (output_level >= WHISPER) {
-      printf("%s has been removed\n", name);
-    }
+static void noMemory(void)
+{
+  if (sink != 0) {
+    sinkFlush(sink);                    /* What has been done until now */
   }
-
+  fprintf(stderr, "%s: couldn't obtain heap memory\n", programName);
+  exit(EXIT_FAILURE);
 }
 
 static char *baseName(
@@ -946,15 +884,6 @@ static char *baseName(
   return ++p;
 }
 
-static void putsMessage(
-  char *message,
-  int  message_level
-){
-  if (message_level <= output_level) {
-    puts(message);
-  }
-}
-
 static void syntax()
 {
   printf("lintex version %s\n", VERSION);
@@ -984,6 +913,49 @@ static void syntax()
   puts("  -q     : quiet, only print error messages;");
   puts("  -v     : verbose, prints which files were removed and which weren't;");
   puts("  -d     : debug output, prints the answers to all of life's questions.");
+  puts("  --io-uring : gets the file metadata (and, with --async-unlink,");
+  puts("           removes the files) in batches through io_uring, if the");
+  puts("           kernel supports it;");
+  puts("  --stat-threads[=n] : gets the metadata of the files in a directory");
+  puts("           with up to n (default 16) threads, as many as the latency");
+  puts("           of the calls makes worthwhile (e.g. on NFS); ignored with");
+  puts("           --io-uring;");
+  puts("  --async-unlink[=n] : removes the files with n (default 1) threads,");
+  puts("           while the scan goes on; the removals are reported later;");
+  puts("  --follow, --no-follow : with -r, descends (the default) or not into");
+  puts("           the symbolic links to directories; every directory is");
+  puts("           cleaned once, however reached;");
+  puts("  --max-depth=n : with -r, descends at most n levels below the given");
+  puts("           directories; .git, .hg, .svn, node_modules and the");
+  puts("           directories holding a CACHEDIR.TAG or .lintexignore file");
+  puts("           are never visited (see the manpage);");
+  puts("  --one-file-system : with -r, skips the file systems mounted below");
+  puts("           the given directories;");
+  puts("  --fs-policy=type=what[,...] : with -r, skips (what: skip), allows");
+  puts("           (allow) or allows with at most n requests in flight (n)");
+  puts("           the file systems of the given type (e.g. nfs, fuse,");
+  puts("           autofs, or * for all the others) mounted below the");
+  puts("           given directories;");
+  puts("  --recorder : removes, instead, the stale files listed as OUTPUT in");
+  puts("           the recorder files (.fls, written by latex -recorder), in");
+  puts("           the given directories or given themselves; only these");
+  puts("           files are looked at;");
+  puts("  --dir-buffer=n : reads the directories n KiB at a time (default 256);");
+  puts("  --max-memory=n : keeps the files of a directory within about n KiB;");
+  puts("           beyond that, they are sorted in temporary files (in");
+  puts("           $TMPDIR) and decided as these are merged back;");
+  puts("  --index=file : keeps in \"file\" an index of the directories scanned,");
+  puts("           so that those unchanged since the previous run are not");
+  puts("           read again;");
+  puts("  --watch[=s] : after the cleanup, watches the directories and cleans");
+  puts("           again those where TeX-related files are written, once");
+  puts("           quiet for s seconds (default 5); until interrupted;");
+  puts("  --format=f : writes the messages as text (the default), as JSON");
+  puts("           records, one per line (json), or only the names of the");
+  puts("           removed files, each followed by a NUL character (nul);");
+  puts("  --stats[=json] : prints on stderr, at exit, counters, the time of");
+  puts("           each phase, latencies of the stat and unlink calls and");
+  puts("           the peak memory; as a JSON object, if so required.");
 
   exit(EXIT_SUCCESS);
 }
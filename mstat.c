@@ -0,0 +1,606 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Metadata backends: see mstat.h .  An Mstat instance must be used by
+  one thread at a time (the threads of MSTAT_POOL are its own).
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "mstat.h"
+#include "uring.h"
+
+/**
+ | MSTAT_CHUNK: number of requests handed to the ring at a time (and
+ | size of the ring itself); the statx buffers for a chunk are part of
+ | the Mstat structure.
+**/
+
+#define MSTAT_CHUNK 256
+
+/**
+ | MSTAT_POOL:
+ | - MSTAT_ROUND: the requests served between two decisions of the
+ |   controller, so that it steers within a large directory;
+ | - MSTAT_SLICE: the requests taken by a thread at a time; batches
+ |   shorter than two slices are served by the caller alone;
+ | - MSTAT_FAST: the latency (ns) of a stat served from memory: the
+ |   controller wants as many threads as the smoothed latency is
+ |   larger (e.g. 10 for 0.5 ms), changing by no more than a factor of
+ |   two at a time.
+ | - MstatPool: the threads started, the maximum and the wanted number,
+ |   and the smoothed latency; the round being served: the requests,
+ |   their latencies and the first not yet taken; how many threads may
+ |   still join the round ("tickets"), and how many are busy with it.
+**/
+
+#define MSTAT_ROUND   1024
+#define MSTAT_SLICE   32
+#define MSTAT_FAST    50000.0
+
+typedef struct sMstatPool {
+  pthread_t      *threads;
+  unsigned        nThreads;
+  unsigned        maxThreads;
+  unsigned        want;
+  double          latency;
+  pthread_mutex_t lock;
+  pthread_cond_t  start;
+  pthread_cond_t  finish;
+  unsigned long   round;
+  int             dirFd;
+  MstatReq       *reqs;
+  double         *lats;
+  unsigned long   nReqs;
+  unsigned long   next;
+  unsigned        tickets;
+  unsigned        busy;
+  int             quit;
+} MstatPool;
+
+struct sMstat {
+  int           kind;
+  Uring        *ring;
+  Stats        *stats;
+  unsigned long limit;
+  MstatPool    *pool;
+#ifdef STATX_TYPE
+  UringOp       ops[MSTAT_CHUNK];
+  MstatReq     *reqs[MSTAT_CHUNK];
+  struct statx  bufs[MSTAT_CHUNK];
+#endif
+};
+
+static void *helper(void *);
+static void  runPool(Mstat *, int, MstatReq *, unsigned long);
+static void  runSync(Mstat *, int, MstatReq *);
+static void  serve(int, MstatReq *);
+static void  serveSlices(MstatPool *);
+static void  steer(MstatPool *, double);
+
+Mstat *mstatOpen(
+  int kind
+){
+
+  /**
+   | Creates a backend of the given kind; falls back to MSTAT_SYNC if
+   | the io_uring can't be used.  Returns 0 only if out of memory.  The
+   | threads of MSTAT_POOL are started when first wanted.
+  **/
+
+  Mstat *pM;
+
+  if ((pM = calloc(1, sizeof(Mstat))) == 0) {
+    return 0;
+  }
+  pM->kind = MSTAT_SYNC;
+
+  if (kind == MSTAT_POOL) {
+    MstatPool *pP;
+
+    if ((pM->pool = pP = calloc(1, sizeof(MstatPool))) == 0) {
+      free(pM);
+      return 0;
+    }
+    pthread_mutex_init(&pP->lock, 0);
+    pthread_cond_init(&pP->start, 0);
+    pthread_cond_init(&pP->finish, 0);
+    if ((pP->threads = malloc(MSTAT_THREADS * sizeof(pthread_t))) == 0) {
+      mstatClose(pM);
+      return 0;
+    }
+    pP->maxThreads = MSTAT_THREADS;
+    pP->want       = 1;
+    pM->kind = MSTAT_POOL;
+  }
+
+#ifdef STATX_TYPE
+  if (kind == MSTAT_URING && (pM->ring = uringOpen(MSTAT_CHUNK)) != 0) {
+    if (uringSupports(pM->ring, URING_STATX) &&
+        uringSupports(pM->ring, URING_OPENAT)) {
+      pM->kind = MSTAT_URING;
+    } else {
+      uringClose(pM->ring);
+      pM->ring = 0;
+    }
+  }
+#else
+  (void) kind;
+#endif
+
+  return pM;
+}
+
+int mstatKind(
+  Mstat *pM
+){
+  return pM->kind;
+}
+
+void mstatStats(
+  Mstat *pM,
+  Stats *pS
+){
+
+  /**
+   | From now on, the stat calls are counted (and timed) in "pS".
+  **/
+
+  pM->stats = pS;
+}
+
+void mstatLimit(
+  Mstat         *pM,
+  unsigned long  limit
+){
+
+  /**
+   | From now on, no more than "limit" requests are in flight at once
+   | (0: no limit other than the backend's own).  Only two backends
+   | have more than one: MSTAT_URING (up to MSTAT_CHUNK) and MSTAT_POOL
+   | (one per thread, see mstatThreads()).
+  **/
+
+  pM->limit = limit;
+}
+
+void mstatThreads(
+  Mstat    *pM,
+  unsigned  maxThreads
+){
+
+  /**
+   | With MSTAT_POOL, uses no more than "maxThreads" threads (at least
+   | one: the caller); to be called before the first batch.
+  **/
+
+  MstatPool *pP = pM->pool;
+  pthread_t *threads;
+
+  if (pP == 0 || maxThreads < 1 || pP->nThreads > 0) return;
+
+  if ((threads = realloc(pP->threads, maxThreads * sizeof(pthread_t))) != 0) {
+    pP->threads    = threads;
+    pP->maxThreads = maxThreads;
+  }
+}
+
+void mstatClose(
+  Mstat *pM
+){
+
+  /**
+   | Stops the threads of MSTAT_POOL, if any, then releases everything.
+  **/
+
+  MstatPool *pP;
+  unsigned   i;
+
+  if (pM == 0) return;
+  if ((pP = pM->pool) != 0) {
+    pthread_mutex_lock(&pP->lock);
+    pP->quit = 1;
+    pthread_cond_broadcast(&pP->start);
+    pthread_mutex_unlock(&pP->lock);
+    for (i = 0;   i < pP->nThreads;   i++) {
+      pthread_join(pP->threads[i], 0);
+    }
+    pthread_mutex_destroy(&pP->lock);
+    pthread_cond_destroy(&pP->start);
+    pthread_cond_destroy(&pP->finish);
+    free(pP->threads);
+    free(pP->lats);
+    free(pP);
+  }
+  uringClose(pM->ring);
+  free(pM);
+}
+
+static void runSync(
+  Mstat    *pM,
+  int       dirFd,
+  MstatReq *pReq
+){
+
+  /**
+   | Serves a single request with the synchronous system calls, timing
+   | the stat calls if required.
+  **/
+
+  double t0 = 0.0;
+
+  if (pM->stats != 0 && pReq->op != MSTAT_OPEN) {
+    t0 = statsClock();
+  }
+  serve(dirFd, pReq);
+  if (pM->stats != 0 && pReq->op != MSTAT_OPEN) {
+    statsAdd(pM->stats, STATS_STATS, 1.0);
+    statsLatency(pM->stats, STATS_STAT, statsClock() - t0);
+  }
+}
+
+static void serve(
+  int       dirFd,
+  MstatReq *pReq
+){
+
+  /**
+   | Does the system call for a request: statx is asked only for type,
+   | modification time and size (the device comes anyway), and fstatat
+   | is used if the kernel does not know about statx.  Unlike fstatat,
+   | statx triggers an automount unless told not to.
+  **/
+
+  struct stat sStat;
+  int         noFollow = pReq->op == MSTAT_LSTAT ? AT_SYMLINK_NOFOLLOW : 0;
+#ifdef STATX_TYPE
+  struct statx sStx;
+#endif
+
+  switch (pReq->op) {
+    case MSTAT_STAT:   case MSTAT_LSTAT:
+#ifdef STATX_TYPE
+      if (statx(dirFd, pReq->name,
+                AT_STATX_SYNC_AS_STAT | AT_NO_AUTOMOUNT | noFollow,
+                STATX_TYPE | STATX_MTIME | STATX_SIZE, &sStx) == 0) {
+        pReq->result = 0;
+        pReq->isDir  = S_ISDIR(sStx.stx_mode) != 0;
+        pReq->mTime  = sStx.stx_mtime.tv_sec;
+        pReq->size   = sStx.stx_size;
+        pReq->dev    = makedev(sStx.stx_dev_major, sStx.stx_dev_minor);
+        break;
+      }
+      if (errno != ENOSYS) {
+        pReq->result = -errno;
+        break;
+      }
+#endif
+      if (fstatat(dirFd, pReq->name, &sStat, noFollow) == 0) {
+        pReq->result = 0;
+        pReq->isDir  = S_ISDIR(sStat.st_mode) != 0;
+        pReq->mTime  = sStat.st_mtime;
+        pReq->size   = sStat.st_size;
+        pReq->dev    = sStat.st_dev;
+      } else {
+        pReq->result = -errno;
+      }
+      break;
+
+    case MSTAT_OPEN:
+      if ((pReq->result = openat(dirFd, pReq->name,
+                                 O_RDONLY | O_DIRECTORY)) < 0) {
+        pReq->result = -errno;
+      }
+      break;
+  }
+}
+
+void mstatRun(
+  Mstat         *pM,
+  int            dirFd,
+  MstatReq      *reqs,
+  unsigned long  nReqs
+){
+
+  /**
+   | Serves the "nReqs" requests in "reqs", relative to the directory
+   | open as "dirFd".  With the io_uring backend the requests are
+   | queued in chunks of MSTAT_CHUNK (or of the limit); if the ring
+   | breaks down, it is closed once the requests in flight are over,
+   | and those not submitted (and all the following ones) are served by
+   | the synchronous backend.
+  **/
+
+  unsigned long i;
+
+  if (pM->kind == MSTAT_POOL) {
+    runPool(pM, dirFd, reqs, nReqs);
+    return;
+  }
+
+#ifdef STATX_TYPE
+  if (pM->kind == MSTAT_URING) {
+    unsigned long first = 0;
+
+    while (first < nReqs && pM->kind == MSTAT_URING) {
+      unsigned long n = 0, j, chunk = MSTAT_CHUNK;
+      double        t0 = 0.0, batch = 0.0;
+
+      if (pM->limit > 0 && pM->limit < chunk) {
+        chunk = pM->limit;
+      }
+      for (i = first;   i < nReqs && n < chunk;   i++) {
+        UringOp *pOp = &pM->ops[n];
+
+        if (reqs[i].op == MSTAT_NONE) continue;
+
+        pOp->dirFd = dirFd;
+        pOp->name  = reqs[i].name;
+        if (reqs[i].op != MSTAT_OPEN) {
+          pOp->op    = URING_STATX;
+          pOp->flags = AT_STATX_SYNC_AS_STAT | AT_NO_AUTOMOUNT |
+                       (reqs[i].op == MSTAT_LSTAT ? AT_SYMLINK_NOFOLLOW : 0);
+          pOp->mask  = STATX_TYPE | STATX_MTIME | STATX_SIZE;
+          pOp->buf   = &pM->bufs[n];
+        } else {
+          pOp->op    = URING_OPENAT;
+          pOp->flags = O_RDONLY | O_DIRECTORY;
+          pOp->mask  = 0;
+          pOp->buf   = 0;
+        }
+        pM->reqs[n++] = &reqs[i];
+      }
+      first = i;
+
+      if (pM->stats != 0) {
+        t0 = statsClock();
+      }
+      if (n > 0 && uringRun(pM->ring, pM->ops, n) != 0) {
+        uringClose(pM->ring);
+        pM->ring = 0;
+        pM->kind = MSTAT_SYNC;
+      }
+      if (pM->stats != 0) {
+        batch = statsClock() - t0;
+      }
+
+      for (j = 0;   j < n;   j++) {
+        MstatReq *pReq = pM->reqs[j];
+        int       res  = pM->ops[j].result;
+
+        if (res == URING_PENDING) {
+          runSync(pM, dirFd, pReq);
+        } else {
+          if (pReq->op != MSTAT_OPEN && res == 0) {
+            pReq->result = 0;
+            pReq->isDir  = S_ISDIR(pM->bufs[j].stx_mode) != 0;
+            pReq->mTime  = pM->bufs[j].stx_mtime.tv_sec;
+            pReq->size   = pM->bufs[j].stx_size;
+            pReq->dev    = makedev(pM->bufs[j].stx_dev_major,
+                                   pM->bufs[j].stx_dev_minor);
+          } else {
+            pReq->result = res;
+          }
+          if (pM->stats != 0 && pReq->op != MSTAT_OPEN) {
+            statsAdd(pM->stats, STATS_STATS, 1.0);
+            statsLatency(pM->stats, STATS_STAT, batch);
+          }
+        }
+      }
+    }
+
+    if (first >= nReqs) return;
+    reqs  += first;
+    nReqs -= first;
+  }
+#endif
+
+  for (i = 0;   i < nReqs;   i++) {
+    if (reqs[i].op != MSTAT_NONE) {
+      runSync(pM, dirFd, &reqs[i]);
+    }
+  }
+}
+
+static void runPool(
+  Mstat         *pM,
+  int            dirFd,
+  MstatReq      *reqs,
+  unsigned long  nReqs
+){
+
+  /**
+   | Serves the requests a round of MSTAT_ROUND at a time: by the caller
+   | alone, if a single thread is wanted (or the round is short), or by
+   | the caller with up to want-1 threads of the pool, started if
+   | needed (if one can't be, fewer are used).  The latencies of every
+   | round are measured, accounted in the statistics if required, and
+   | given to the controller.
+  **/
+
+  MstatPool     *pP = pM->pool;
+  unsigned long  first, n, i;
+  double        *lats;
+
+  if (nReqs == 0) return;
+  if ((lats = realloc(pP->lats, (nReqs < MSTAT_ROUND ? nReqs : MSTAT_ROUND) *
+                      sizeof(double))) == 0) {
+    for (i = 0;   i < nReqs;   i++) {
+      if (reqs[i].op != MSTAT_NONE) {
+        runSync(pM, dirFd, &reqs[i]);
+      }
+    }
+    return;
+  }
+  pP->lats = lats;
+
+  for (first = 0;   first < nReqs;   first += n) {
+    unsigned      want   = pP->want;
+    double        total  = 0.0;
+    unsigned long served = 0;
+
+    n = nReqs - first < MSTAT_ROUND ? nReqs - first : MSTAT_ROUND;
+    if (pM->limit > 0 && want > pM->limit) {
+      want = pM->limit;
+    }
+    if (n < 2 * MSTAT_SLICE) {
+      want = 1;
+    }
+    while (pP->nThreads < want - 1 &&
+           pthread_create(&pP->threads[pP->nThreads], 0, helper, pP) == 0) {
+      pP->nThreads++;
+    }
+    if (want > pP->nThreads + 1) {
+      want = pP->nThreads + 1;
+    }
+
+    pthread_mutex_lock(&pP->lock);
+    pP->dirFd   = dirFd;
+    pP->reqs    = reqs + first;
+    pP->nReqs   = n;
+    pP->next    = 0;
+    pP->round++;
+    pP->tickets = want - 1;
+    if (want > 1) {
+      pthread_cond_broadcast(&pP->start);
+    }
+    pthread_mutex_unlock(&pP->lock);
+
+    serveSlices(pP);
+
+    pthread_mutex_lock(&pP->lock);
+    pP->tickets = 0;
+    while (pP->busy > 0) {
+      pthread_cond_wait(&pP->finish, &pP->lock);
+    }
+    pthread_mutex_unlock(&pP->lock);
+
+    for (i = 0;   i < n;   i++) {
+      if (reqs[first + i].op == MSTAT_NONE) continue;
+      total += pP->lats[i];
+      served++;
+      if (pM->stats != 0 && reqs[first + i].op != MSTAT_OPEN) {
+        statsAdd(pM->stats, STATS_STATS, 1.0);
+        statsLatency(pM->stats, STATS_STAT, pP->lats[i]);
+      }
+    }
+    if (served > 0) {
+      steer(pP, total / served);
+    }
+  }
+}
+
+static void *helper(
+  void *arg
+){
+
+  /**
+   | A thread of the pool: joins every round for which there is still
+   | a ticket, until told to quit.
+  **/
+
+  MstatPool     *pP   = arg;
+  unsigned long  seen = 0;
+
+  pthread_mutex_lock(&pP->lock);
+  for (;;) {
+    while (!pP->quit && (pP->tickets == 0 || pP->round == seen)) {
+      pthread_cond_wait(&pP->start, &pP->lock);
+    }
+    if (pP->quit) break;
+
+    seen = pP->round;
+    pP->tickets--;
+    pP->busy++;
+    pthread_mutex_unlock(&pP->lock);
+
+    serveSlices(pP);
+
+    pthread_mutex_lock(&pP->lock);
+    if (--pP->busy == 0) {
+      pthread_cond_signal(&pP->finish);
+    }
+  }
+  pthread_mutex_unlock(&pP->lock);
+  return 0;
+}
+
+static void serveSlices(
+  MstatPool *pP
+){
+
+  /**
+   | Takes the requests of the current round MSTAT_SLICE at a time, and
+   | serves them, timing each one, until none is left.
+  **/
+
+  for (;;) {
+    unsigned long  first, last, i;
+    MstatReq      *reqs;
+    int            dirFd;
+
+    pthread_mutex_lock(&pP->lock);
+    first = pP->next;
+    last  = first + MSTAT_SLICE < pP->nReqs ? first + MSTAT_SLICE
+                                            : pP->nReqs;
+    pP->next = last;
+    reqs  = pP->reqs;
+    dirFd = pP->dirFd;
+    pthread_mutex_unlock(&pP->lock);
+
+    if (first >= last) return;
+
+    for (i = first;   i < last;   i++) {
+      if (reqs[i].op != MSTAT_NONE) {
+        double t0 = statsClock();
+
+        serve(dirFd, &reqs[i]);
+        pP->lats[i] = statsClock() - t0;
+      }
+    }
+  }
+}
+
+static void steer(
+  MstatPool *pP,
+  double     latency
+){
+
+  /**
+   | The controller: smooths the mean latency of the last round (ns),
+   | and wants as many threads as it is larger than MSTAT_FAST, within
+   | half and twice the threads wanted so far, and the maximum.
+  **/
+
+  double   target;
+  unsigned want;
+
+  pP->latency = pP->latency == 0.0 ? latency
+                                   : 0.75 * pP->latency + 0.25 * latency;
+  target = pP->latency / MSTAT_FAST;
+
+  if (target < 1.0) {
+    want = 1;
+  } else if (target > pP->maxThreads) {
+    want = pP->maxThreads;
+  } else {
+    want = (unsigned) (target + 0.5);
+  }
+  if (want > 2 * pP->want) want = 2 * pP->want;
+  if (want < pP->want / 2) want = pP->want / 2;
+  pP->want = want < 1 ? 1 : want;
+}
@@ -0,0 +1,87 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Metadata backends.  Both lintex and ltx scan a directory by name
+  first, and then ask for the metadata of the few files that matter
+  as a single batch of requests, all relative to the directory file
+  descriptor; the batch is served by one of the backends below:
+  - MSTAT_SYNC: one synchronous statx(2) / openat(2) per request
+    (the default);
+  - MSTAT_URING: all the requests are queued on an io_uring, so that
+    on network file systems the round trips overlap.  If the kernel
+    lacks io_uring (or the needed operations), the synchronous
+    backend is silently used instead;
+  - MSTAT_POOL: the batch is cut into slices, served concurrently by
+    a pool of threads with the synchronous calls; how many threads
+    is decided, while the batch goes on, from the observed latency:
+    as many as the calls are slower than when served from memory
+    (none but the caller on a local disk, many on NFS), up to a
+    maximum.
+  How many requests may be in flight at once may be limited (e.g. on
+  a file system that suffers from too many).
+*/
+
+#ifndef MSTAT_H_
+#define MSTAT_H_
+
+#include <time.h>
+#include <sys/types.h>
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MSTAT_SYNC  0
+#define MSTAT_URING 1
+#define MSTAT_POOL  2
+
+/**
+ | MSTAT_THREADS: the default maximum number of threads of MSTAT_POOL,
+ | the caller included.
+**/
+
+#define MSTAT_THREADS 16
+
+/**
+ | Requests: MSTAT_NONE is skipped (handy to keep a request for every
+ | directory entry of interest); MSTAT_STAT gets type, modification
+ | time, size and device of "name", following symbolic links, and
+ | MSTAT_LSTAT those of the link itself; MSTAT_OPEN opens the directory
+ | "name", setting "result" to its file descriptor.  "result" is
+ | negative (-errno) on failure.
+**/
+
+#define MSTAT_NONE  0
+#define MSTAT_STAT  1
+#define MSTAT_OPEN  2
+#define MSTAT_LSTAT 3
+
+typedef struct sMstatReq {
+  const char *name;
+  int         op;
+  int         result;
+  int         isDir;
+  time_t      mTime;
+  off_t       size;
+  dev_t       dev;
+} MstatReq;
+
+typedef struct sMstat Mstat;
+
+Mstat *mstatOpen(int);
+int    mstatKind(Mstat *);
+void   mstatStats(Mstat *, Stats *);
+void   mstatLimit(Mstat *, unsigned long);
+void   mstatThreads(Mstat *, unsigned);
+void   mstatRun(Mstat *, int, MstatReq *, unsigned long);
+void   mstatClose(Mstat *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSTAT_H_ */
@@ -0,0 +1,280 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Prune rules: see prune.h .  When compiled, the patterns are sorted by
+  kind: the plain names (the most common rules) in a sorted array, for
+  a binary search; the "*suffix" and "prefix*" patterns, compared as
+  such; only the others are given to fnmatch(3).  The markers are
+  looked for with fstatat(2), relative to the parent directory.
+*/
+
+#define _GNU_SOURCE             /* fstatat() */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "prune.h"
+
+/**
+ | - PruneKind: what a pattern is, once compiled;
+ | - PrunePattern: a pattern, and the length of its literal part (the
+ |   pattern without its leading or trailing star);
+ | - Prune: the patterns (sorted, when compiled, by kind and then by
+ |   name), where every kind starts, and the markers.
+**/
+
+typedef enum { kPlain, kSuffix, kPrefix, kGlob, kKinds } PruneKind;
+
+typedef struct sPrunePattern {
+  char      *text;
+  size_t     len;
+  PruneKind  kind;
+} PrunePattern;
+
+struct sPrune {
+  PrunePattern *patterns;
+  size_t        nPatterns;
+  size_t        mPatterns;
+  size_t        first[kKinds + 1];
+  char        **markers;
+  size_t        nMarkers;
+  size_t        mMarkers;
+  size_t        lMarkers;
+  int           compiled;
+};
+
+static int       comparePatterns(const void *, const void *);
+static PruneKind kindOf(const char *, size_t *);
+
+Prune *pruneNew(void)
+{
+
+  /**
+   | Returns empty rules, or 0 if out of memory.
+  **/
+
+  return calloc(1, sizeof(Prune));
+}
+
+int pruneAdd(
+  Prune      *pP,
+  const char *text,
+  int         what
+){
+  char *copy;
+
+  if (pP->compiled || (copy = malloc(strlen(text) + 1)) == 0) {
+    return -1;
+  }
+  strcpy(copy, text);
+
+  if (what == PRUNE_MARKER) {
+    if (pP->nMarkers == pP->mMarkers) {
+      size_t  m = pP->mMarkers == 0 ? 4 : 2 * pP->mMarkers;
+      char  **grown;
+
+      if ((grown = realloc(pP->markers, m * sizeof(char *))) == 0) {
+        free(copy);
+        return -1;
+      }
+      pP->markers  = grown;
+      pP->mMarkers = m;
+    }
+    pP->markers[pP->nMarkers++] = copy;
+    if (strlen(copy) > pP->lMarkers) {
+      pP->lMarkers = strlen(copy);
+    }
+    return 0;
+  }
+
+  if (pP->nPatterns == pP->mPatterns) {
+    size_t        m = pP->mPatterns == 0 ? 8 : 2 * pP->mPatterns;
+    PrunePattern *grown;
+
+    if ((grown = realloc(pP->patterns, m * sizeof(PrunePattern))) == 0) {
+      free(copy);
+      return -1;
+    }
+    pP->patterns  = grown;
+    pP->mPatterns = m;
+  }
+  pP->patterns[pP->nPatterns].text = copy;
+  pP->patterns[pP->nPatterns].kind = kindOf(copy,
+                                            &pP->patterns[pP->nPatterns].len);
+  pP->nPatterns++;
+  return 0;
+}
+
+int pruneCompile(
+  Prune *pP
+){
+
+  /**
+   | Sorts the patterns, and finds where every kind starts.  Nothing
+   | here may fail, as yet.
+  **/
+
+  size_t i;
+  int    k;
+
+  if (pP->compiled) {
+    return 0;
+  }
+  if (pP->nPatterns > 0) {
+    qsort(pP->patterns, pP->nPatterns, sizeof(PrunePattern),
+          comparePatterns);
+  }
+  for (k = 0, i = 0;   k <= kKinds;   k++) {
+    while (i < pP->nPatterns && (int) pP->patterns[i].kind < k) {
+      i++;
+    }
+    pP->first[k] = i;
+  }
+  pP->compiled = 1;
+  return 0;
+}
+
+int pruneDir(
+  const Prune *pP,
+  int          dirFd,
+  const char  *name
+){
+
+  /**
+   | Tells whether the subdirectory "name", of the directory open as
+   | "dirFd", has to be pruned (PRUNE_NAME or PRUNE_MARKER), or not
+   | (PRUNE_NONE).  The names are looked at first, the markers only
+   | if no pattern matches.
+  **/
+
+  size_t len = strlen(name), lo, hi, i;
+
+  lo = pP->first[kPlain];
+  hi = pP->first[kSuffix];
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int    cmp = strcmp(name, pP->patterns[mid].text);
+
+    if (cmp == 0) {
+      return PRUNE_NAME;
+    }
+    if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  for (i = pP->first[kSuffix];   i < pP->first[kPrefix];   i++) {
+    const PrunePattern *p = &pP->patterns[i];
+
+    if (len >= p->len &&
+        memcmp(name + len - p->len, p->text + 1, p->len) == 0) {
+      return PRUNE_NAME;
+    }
+  }
+  for (i = pP->first[kPrefix];   i < pP->first[kGlob];   i++) {
+    const PrunePattern *p = &pP->patterns[i];
+
+    if (len >= p->len && memcmp(name, p->text, p->len) == 0) {
+      return PRUNE_NAME;
+    }
+  }
+  for (i = pP->first[kGlob];   i < pP->first[kKinds];   i++) {
+    if (fnmatch(pP->patterns[i].text, name, 0) == 0) {
+      return PRUNE_NAME;
+    }
+  }
+
+  if (pP->nMarkers > 0) {
+    char        *path;
+    struct stat  st;
+    int          found = 0;
+
+    if ((path = malloc(len + pP->lMarkers + 2)) == 0) {
+      return PRUNE_NONE;
+    }
+    memcpy(path, name, len);
+    path[len] = '/';
+    for (i = 0;   !found && i < pP->nMarkers;   i++) {
+      strcpy(path + len + 1, pP->markers[i]);
+      found = fstatat(dirFd, path, &st, AT_SYMLINK_NOFOLLOW) == 0;
+    }
+    free(path);
+    if (found) {
+      return PRUNE_MARKER;
+    }
+  }
+  return PRUNE_NONE;
+}
+
+void pruneFree(
+  Prune *pP
+){
+  size_t i;
+
+  if (pP == 0) return;
+  for (i = 0;   i < pP->nPatterns;   i++) {
+    free(pP->patterns[i].text);
+  }
+  for (i = 0;   i < pP->nMarkers;   i++) {
+    free(pP->markers[i]);
+  }
+  free(pP->patterns);
+  free(pP->markers);
+  free(pP);
+}
+
+static PruneKind kindOf(
+  const char *text,
+  size_t     *pLen
+){
+
+  /**
+   | Tells the kind of the pattern "text", and the length of its
+   | literal part.
+  **/
+
+  size_t len  = strlen(text);
+  size_t wild = strcspn(text, "*?[\\");
+
+  if (wild == len) {
+    *pLen = len;
+    return kPlain;
+  }
+  if (wild == 0 && len > 1 && text[0] == '*' &&
+      strcspn(text + 1, "*?[\\") == len - 1) {
+    *pLen = len - 1;
+    return kSuffix;
+  }
+  if (wild == len - 1 && text[wild] == '*') {
+    *pLen = len - 1;
+    return kPrefix;
+  }
+  *pLen = len;
+  return kGlob;
+}
+
+static int comparePatterns(
+  const void *p1,
+  const void *p2
+){
+
+  /**
+   | Orders the patterns by kind, and then by text.
+  **/
+
+  const PrunePattern *pP1 = p1, *pP2 = p2;
+
+  if (pP1->kind != pP2->kind) {
+    return pP1->kind < pP2->kind ? -1 : 1;
+  }
+  return strcmp(pP1->text, pP2->text);
+}
@@ -0,0 +1,48 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Prune rules: the subdirectories that are not worth a visit, because
+  they never hold TeX-related files (version control metadata, vendored
+  dependencies, caches...).  A subdirectory is pruned if its name
+  matches one of the patterns (shell wildcards, as in fnmatch(3): e.g.
+  ".git", "node_modules", "*.cache"), or if it holds one of the marker
+  files (e.g. CACHEDIR.TAG); the check is made on its parent, before
+  the subdirectory is even opened.
+*/
+
+#ifndef PRUNE_H_
+#define PRUNE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - what pruneDir() tells: the subdirectory is not pruned, is pruned
+ |   by its name, or by a marker file;
+ | - pruneAdd() adds a pattern (PRUNE_NAME) or a marker (PRUNE_MARKER),
+ |   and returns -1 if out of memory or if already compiled;
+ | - pruneCompile() returns -1 if out of memory; once compiled, the
+ |   rules are only read, and may be shared by any number of threads.
+**/
+
+#define PRUNE_NONE   0
+#define PRUNE_NAME   1
+#define PRUNE_MARKER 2
+
+typedef struct sPrune Prune;
+
+Prune *pruneNew(void);
+int    pruneAdd(Prune *, const char *, int);
+int    pruneCompile(Prune *);
+int    pruneDir(const Prune *, int, const char *);
+void   pruneFree(Prune *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRUNE_H_ */
@@ -0,0 +1,480 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Configuration file: see rcfile.h .  Without libconfig, the whole file
+  is read in memory, and parsed in place: the strings are unescaped
+  where they are, and the settings point into the text.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+
+#ifndef NO_LIBCONFIG
+#include <libconfig.h>
+#endif
+
+#include "rcfile.h"
+
+static char *newError(const char *, int, const char *);
+
+#ifndef NO_LIBCONFIG
+
+/**
+ | - RcFile: the configuration read by libconfig, and the error, if
+ |   any.
+**/
+
+struct sRcFile {
+  config_t  cfg;
+  char     *error;
+};
+
+RcFile *rcOpen(
+  const char *fileName
+){
+  RcFile *pF;
+
+  if ((pF = calloc(1, sizeof(RcFile))) == 0) {
+    return 0;
+  }
+  config_init(&pF->cfg);
+  if (! config_read_file(&pF->cfg, fileName) &&
+      (pF->error = newError(config_error_file(&pF->cfg),
+                            config_error_line(&pF->cfg),
+                            config_error_text(&pF->cfg))) == 0) {
+    rcClose(pF);
+    return 0;
+  }
+  return pF;
+}
+
+int rcLength(
+  RcFile     *pF,
+  const char *name
+){
+  config_setting_t *setting = config_lookup(&pF->cfg, name);
+
+  return setting == 0 ? -1 : config_setting_length(setting);
+}
+
+const char *rcString(
+  RcFile     *pF,
+  const char *name,
+  int         i
+){
+  config_setting_t *setting = config_lookup(&pF->cfg, name);
+
+  return setting == 0 ? 0 : config_setting_get_string_elem(setting, i);
+}
+
+void rcClose(
+  RcFile *pF
+){
+  if (pF == 0) return;
+  config_destroy(&pF->cfg);
+  free(pF->error);
+  free(pF);
+}
+
+#else
+
+/**
+ | - RcSetting: a list of strings at the top level, named by the first
+ |   lName characters of "name";
+ | - RcFile: the text of the file, the settings found, and the error,
+ |   if any;
+ | - RcParser: where the parser is, and the line it is at; "pF" is the
+ |   file being parsed.
+**/
+
+typedef struct sRcSetting {
+  const char  *name;
+  size_t       lName;
+  const char **strings;
+  int          n;
+  int          m;
+} RcSetting;
+
+struct sRcFile {
+  char      *text;
+  RcSetting *settings;
+  int        n;
+  int        m;
+  char      *error;
+};
+
+typedef struct sRcParser {
+  RcFile *pF;
+  char   *p;
+  int     line;
+} RcParser;
+
+static RcSetting *findSetting(RcFile *, const char *);
+static int        parseSettings(RcParser *, int, int);
+static char      *parseString(RcParser *);
+static int        parseValue(RcParser *, RcSetting *);
+static void       skipBlank(RcParser *);
+
+RcFile *rcOpen(
+  const char *fileName
+){
+  RcFile   *pF;
+  RcParser  parser;
+  FILE     *fp;
+  long      size;
+
+  if ((pF = calloc(1, sizeof(RcFile))) == 0) {
+    return 0;
+  }
+
+  if ((fp = fopen(fileName, "r")) == 0 ||
+      fseek(fp, 0L, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+      fseek(fp, 0L, SEEK_SET) != 0) {
+    pF->error = newError(fileName, 0, strerror(errno));
+  } else if ((pF->text = malloc(size + 1)) == 0) {
+    fclose(fp);
+    rcClose(pF);
+    return 0;
+  } else if (fread(pF->text, 1, size, fp) != (size_t) size) {
+    pF->error = newError(fileName, 0, strerror(errno));
+  }
+  if (fp != 0) {
+    fclose(fp);
+  }
+  if (pF->error != 0) {
+    return pF;
+  }
+  if (pF->text == 0) {
+    rcClose(pF);
+    return 0;
+  }
+  pF->text[size] = '\0';
+
+  parser.pF   = pF;
+  parser.p    = pF->text;
+  parser.line = 1;
+  switch (parseSettings(&parser, '\0', 1)) {
+    case 0:
+      break;
+
+    case 1:
+      if ((pF->error = newError(fileName, parser.line, "syntax error")) != 0) {
+        break;
+      }
+      /* Fall through */
+
+    default:
+      rcClose(pF);
+      return 0;
+  }
+  return pF;
+}
+
+static int parseSettings(
+  RcParser *pP,
+  int       close,
+  int       top
+){
+
+  /**
+   | Parses the settings up to the character "close" (not consumed):
+   | "name = value;" or "name : value,", the separator being optional.
+   | The lists of strings are recorded if at the "top" level.  Returns
+   | 0; 1 on a syntax error; -1 if out of memory.
+  **/
+
+  for (;;) {
+    RcSetting *pS = 0;
+    char      *name;
+    size_t     lName;
+    int        err;
+
+    skipBlank(pP);
+    if (*pP->p == close) {
+      return 0;
+    }
+
+    name = pP->p;
+    if (! isalpha((unsigned char) *pP->p) && *pP->p != '*') {
+      return 1;
+    }
+    while (isalnum((unsigned char) *pP->p) || *pP->p == '_' ||
+           *pP->p == '-' || *pP->p == '*') {
+      pP->p++;
+    }
+    lName = pP->p - name;
+
+    skipBlank(pP);
+    if (*pP->p != '=' && *pP->p != ':') {
+      return 1;
+    }
+    pP->p++;
+    skipBlank(pP);
+
+    if (top && (*pP->p == '[' || *pP->p == '(')) {
+      RcFile *pF = pP->pF;
+
+      if (pF->n == pF->m) {
+        RcSetting *grown;
+        int        m = pF->m == 0 ? 8 : 2 * pF->m;
+
+        if ((grown = realloc(pF->settings, m * sizeof(RcSetting))) == 0) {
+          return -1;
+        }
+        pF->settings = grown;
+        pF->m        = m;
+      }
+      pS = &pF->settings[pF->n++];
+      memset(pS, 0, sizeof(RcSetting));
+      pS->name  = name;
+      pS->lName = lName;
+    }
+
+    if ((err = parseValue(pP, pS)) != 0) {
+      return err;
+    }
+    skipBlank(pP);
+    if (*pP->p == ';' || *pP->p == ',') {
+      pP->p++;
+    }
+  }
+}
+
+static int parseValue(
+  RcParser  *pP,
+  RcSetting *pS
+){
+
+  /**
+   | Parses a value: a list, an array, a group, strings or a scalar.  If
+   | "pS" is not 0, the value is a list (or an array) whose strings are
+   | appended to it.  Returns as parseSettings().
+  **/
+
+  int err;
+
+  switch (*pP->p) {
+    case '[':   case '(': {
+      int close = *pP->p++ == '[' ? ']' : ')';
+
+      for (;;) {
+        skipBlank(pP);
+        if (*pP->p == close) {
+          pP->p++;
+          return 0;
+        }
+        if (pS != 0 && *pP->p == '"') {
+          char *s = parseString(pP);
+
+          if (s == 0) {
+            return 1;
+          }
+          if (pS->n == pS->m) {
+            const char **grown;
+            int          m = pS->m == 0 ? 8 : 2 * pS->m;
+
+            if ((grown = realloc(pS->strings, m * sizeof(char *))) == 0) {
+              return -1;
+            }
+            pS->strings = grown;
+            pS->m       = m;
+          }
+          pS->strings[pS->n++] = s;
+        } else if ((err = parseValue(pP, 0)) != 0) {
+          return err;
+        }
+        skipBlank(pP);
+        if (*pP->p == ',') {
+          pP->p++;
+        } else if (*pP->p != close) {
+          return 1;
+        }
+      }
+    }
+
+    case '{':
+      pP->p++;
+      if ((err = parseSettings(pP, '}', 0)) != 0) {
+        return err;
+      }
+      pP->p++;
+      return 0;
+
+    case '"':
+      return parseString(pP) == 0 ? 1 : 0;
+
+    default: {
+      char *start = pP->p;
+
+      while (isalnum((unsigned char) *pP->p) || *pP->p == '.' ||
+             *pP->p == '+' || *pP->p == '-' || *pP->p == '_') {
+        pP->p++;
+      }
+      return pP->p == start ? 1 : 0;
+    }
+  }
+}
+
+static char *parseString(
+  RcParser *pP
+){
+
+  /**
+   | Parses a string (adjacent strings are joined, as in C), and
+   | returns it, unescaped in place; 0 on a syntax error.
+  **/
+
+  char *start = pP->p, *out = pP->p;
+
+  while (*pP->p == '"') {
+    for (pP->p++;   *pP->p != '"';   pP->p++) {
+      if (*pP->p == '\0' || *pP->p == '\n') {
+        return 0;
+      }
+      if (*pP->p == '\\') {
+        switch (*++pP->p) {
+          case 'n':  *out++ = '\n';    break;
+          case 't':  *out++ = '\t';    break;
+          case 'r':  *out++ = '\r';    break;
+          case 'f':  *out++ = '\f';    break;
+          case '\0': return 0;
+          default:   *out++ = *pP->p;  break;
+        }
+      } else {
+        *out++ = *pP->p;
+      }
+    }
+    pP->p++;
+    skipBlank(pP);
+  }
+  *out = '\0';
+  return start;
+}
+
+static void skipBlank(
+  RcParser *pP
+){
+
+  /**
+   | Skips the blanks and the comments (#, // and C comments), and the
+   | directives (@include), counting the lines.
+  **/
+
+  for (;;) {
+    char *p = pP->p;
+
+    if (*p == '\n') {
+      pP->line++;
+      pP->p++;
+    } else if (isspace((unsigned char) *p)) {
+      pP->p++;
+    } else if (*p == '#' || *p == '@' || (p[0] == '/' && p[1] == '/')) {
+      while (*pP->p != '\n' && *pP->p != '\0') {
+        pP->p++;
+      }
+    } else if (p[0] == '/' && p[1] == '*') {
+      for (pP->p += 2;   *pP->p != '\0';   pP->p++) {
+        if (pP->p[0] == '*' && pP->p[1] == '/') {
+          pP->p += 2;
+          break;
+        }
+        if (*pP->p == '\n') {
+          pP->line++;
+        }
+      }
+    } else {
+      return;
+    }
+  }
+}
+
+static RcSetting *findSetting(
+  RcFile     *pF,
+  const char *name
+){
+
+  /**
+   | The last setting "name", if any (as libconfig, that keeps only
+   | the last one).
+  **/
+
+  size_t l = strlen(name);
+  int    i;
+
+  for (i = pF->n - 1;   i >= 0;   i--) {
+    if (pF->settings[i].lName == l &&
+        strncmp(pF->settings[i].name, name, l) == 0) {
+      return &pF->settings[i];
+    }
+  }
+  return 0;
+}
+
+int rcLength(
+  RcFile     *pF,
+  const char *name
+){
+  RcSetting *pS = findSetting(pF, name);
+
+  return pS == 0 ? -1 : pS->n;
+}
+
+const char *rcString(
+  RcFile     *pF,
+  const char *name,
+  int         i
+){
+  RcSetting *pS = findSetting(pF, name);
+
+  return pS == 0 || i < 0 || i >= pS->n ? 0 : pS->strings[i];
+}
+
+void rcClose(
+  RcFile *pF
+){
+  int i;
+
+  if (pF == 0) return;
+  for (i = 0;   i < pF->n;   i++) {
+    free(pF->settings[i].strings);
+  }
+  free(pF->settings);
+  free(pF->text);
+  free(pF->error);
+  free(pF);
+}
+
+#endif /* NO_LIBCONFIG */
+
+const char *rcError(
+  RcFile *pF
+){
+  return pF->error;
+}
+
+static char *newError(
+  const char *fileName,
+  int         line,
+  const char *text
+){
+
+  /**
+   | Returns the message "file:line - text", as lintex always wrote
+   | the errors of libconfig; or 0 if out of memory.
+  **/
+
+  char *error;
+
+  if (fileName == 0) fileName = "";
+  if (text == 0)     text     = "";
+  if ((error = malloc(strlen(fileName) + strlen(text) + 32)) != 0) {
+    sprintf(error, "%s:%d - %s", fileName, line, text);
+  }
+  return error;
+}
@@ -0,0 +1,44 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Configuration file (~/.lintexrc).  The settings that matter are lists
+  of strings, e.g.
+
+    remove-exts = [".glo", ".gls"];
+
+  The file is read through libconfig; or, if built with NO_LIBCONFIG,
+  by a minimal reader of the same syntax, that keeps only the lists
+  (or arrays) of strings at the top level, and skips anything else.
+*/
+
+#ifndef RCFILE_H_
+#define RCFILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - rcOpen() reads a file; it returns 0 only if out of memory: if the
+ |   file could not be read, rcError() tells why ("file:line - text").
+ | - rcLength() is the number of elements of a setting, -1 if missing;
+ |   rcString() the i-th one, 0 if it is not a string.  The strings are
+ |   valid until rcClose().
+**/
+
+typedef struct sRcFile RcFile;
+
+RcFile     *rcOpen(const char *);
+const char *rcError(RcFile *);
+int         rcLength(RcFile *, const char *);
+const char *rcString(RcFile *, const char *, int);
+void        rcClose(RcFile *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RCFILE_H_ */
@@ -0,0 +1,358 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Compiled file name rules: see rules.h .  While the rules are added,
+  the trie is kept as nodes linked to their first child and to their
+  next sibling (sorted by character); rulesCompile() lays the nodes
+  out in breadth first order, so that the children of every node are
+  contiguous, and builds a direct table for the children of the root.
+  After that, the rules are read only and may be shared by threads.
+  The compiled nodes hold only indices, so that they may be stored in
+  a file as they are, and used in place once mapped (rulesMap()).
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rules.h"
+
+/**
+ | A node of the trie: the character leading to it, the kinds of the
+ | rules ending there, and the RULE_REMOVE identifier.  While building,
+ | "first" and "next" link the first child and the next sibling; once
+ | compiled, the children are nodes[first] ... nodes[first + nKids - 1].
+**/
+
+typedef struct sRuleNode {
+  unsigned       first;
+  unsigned       next;
+  unsigned short nKids;
+  unsigned char  c;
+  unsigned char  kinds;
+  int            id;
+} RuleNode;
+
+struct sRules {
+  RuleNode *nodes;
+  unsigned  nNodes;
+  unsigned  mNodes;
+  int       compiled;
+  int       mapped;
+  unsigned  root[256];
+};
+
+static unsigned newNode(Rules *, unsigned char);
+static void     rootTable(Rules *);
+
+Rules *rulesNew(void)
+{
+
+  /**
+   | Creates an empty rule set; returns 0 if out of memory.
+  **/
+
+  Rules *pR;
+
+  if ((pR = calloc(1, sizeof(Rules))) == 0) {
+    return 0;
+  }
+  if (newNode(pR, 0) != 0) {
+    free(pR);
+    return 0;
+  }
+  return pR;
+}
+
+static unsigned newNode(
+  Rules         *pR,
+  unsigned char  c
+){
+
+  /**
+   | Appends a node; returns its index, or 0 if out of memory (0 is the
+   | root, that is never a child).
+  **/
+
+  RuleNode *pN;
+
+  if (pR->nNodes == pR->mNodes) {
+    unsigned  m = pR->mNodes == 0 ? 64 : 2 * pR->mNodes;
+    RuleNode *nodes;
+
+    if ((nodes = realloc(pR->nodes, m * sizeof(RuleNode))) == 0) {
+      return 0;
+    }
+    pR->nodes  = nodes;
+    pR->mNodes = m;
+  }
+
+  pN = &pR->nodes[pR->nNodes];
+  memset(pN, 0, sizeof(RuleNode));
+  pN->c  = c;
+  pN->id = -1;
+  return pR->nNodes++;
+}
+
+int rulesAdd(
+  Rules      *pR,
+  const char *suffix,
+  int         kind,
+  int         id
+){
+
+  /**
+   | Adds the rule "suffix" of the given kind.  Returns 0; 1 if the rule
+   | is not acceptable (and is ignored); -1 if out of memory.
+  **/
+
+  size_t   len = strlen(suffix);
+  unsigned node = 0;
+
+  if (pR->compiled) return 1;
+  if (len == 0)     return 1;
+  if (kind != RULE_BACKUP && (suffix[0] != '.' || len < 2)) return 1;
+
+  while (len > 0) {
+    unsigned char  c    = suffix[--len];
+    unsigned      *link = &pR->nodes[node].first;
+    unsigned       kid;
+
+    while (*link != 0 && pR->nodes[*link].c < c) {
+      link = &pR->nodes[*link].next;
+    }
+    if (*link != 0 && pR->nodes[*link].c == c) {
+      node = *link;
+      continue;
+    }
+
+    if ((kid = newNode(pR, c)) == 0) return -1;
+    link = &pR->nodes[node].first;            /* The array may have moved */
+    while (*link != 0 && pR->nodes[*link].c < c) {
+      link = &pR->nodes[*link].next;
+    }
+    pR->nodes[kid].next = *link;
+    *link               = kid;
+    pR->nodes[node].nKids++;
+    node = kid;
+  }
+
+  if (kind == RULE_REMOVE && (pR->nodes[node].kinds & RULE_REMOVE) == 0) {
+    pR->nodes[node].id = id;
+  }
+  pR->nodes[node].kinds |= kind;
+  return 0;
+}
+
+int rulesCompile(
+  Rules *pR
+){
+
+  /**
+   | Lays out the trie for the lookups.  Returns 0, or -1 if out of
+   | memory.
+  **/
+
+  RuleNode *flat;
+  unsigned *order, *where;
+  unsigned  head, tail, i;
+
+  if (pR->compiled) return 0;
+
+  flat  = malloc(pR->nNodes * sizeof(RuleNode));
+  order = malloc(pR->nNodes * sizeof(unsigned));
+  where = malloc(pR->nNodes * sizeof(unsigned));
+  if (flat == 0 || order == 0 || where == 0) {
+    free(flat);
+    free(order);
+    free(where);
+    return -1;
+  }
+
+  /**
+   | Breadth first visit: "order" is the queue of the old indices, and
+   | "where" maps them to the new ones.
+  **/
+
+  head = tail = 0;
+  order[tail++] = 0;
+  while (head < tail) {
+    unsigned old = order[head];
+    unsigned kid;
+
+    where[old] = head++;
+    for (kid = pR->nodes[old].first;   kid != 0;   kid = pR->nodes[kid].next) {
+      order[tail++] = kid;
+    }
+  }
+
+  for (i = 0;   i < pR->nNodes;   i++) {
+    RuleNode *pOld = &pR->nodes[order[i]];
+    RuleNode *pNew = &flat[i];
+
+    *pNew       = *pOld;
+    pNew->first = pOld->first == 0 ? 0 : where[pOld->first];
+    pNew->next  = 0;
+  }
+
+  free(pR->nodes);
+  free(order);
+  free(where);
+  pR->nodes    = flat;
+  pR->mNodes   = pR->nNodes;
+  pR->compiled = 1;
+  rootTable(pR);
+  return 0;
+}
+
+static void rootTable(
+  Rules *pR
+){
+
+  /**
+   | Builds the direct table of the children of the root.
+  **/
+
+  unsigned i;
+
+  memset(pR->root, 0, sizeof(pR->root));
+  for (i = 0;   i < pR->nodes[0].nKids;   i++) {
+    unsigned kid = pR->nodes[0].first + i;
+
+    pR->root[pR->nodes[kid].c] = kid;
+  }
+}
+
+size_t rulesImage(
+  const Rules *pR,
+  void        *image
+){
+
+  /**
+   | Copies the compiled rules in "image", if not 0; returns their size
+   | in bytes.  The image is in the byte order of the machine, and may
+   | only be used by a program built alike.
+  **/
+
+  if (image != 0) {
+    memcpy(image, pR->nodes, pR->nNodes * sizeof(RuleNode));
+  }
+  return pR->nNodes * sizeof(RuleNode);
+}
+
+Rules *rulesMap(
+  const void *image,
+  size_t      size,
+  int         nIds
+){
+
+  /**
+   | Returns the compiled rules in "image", of "size" bytes, as written
+   | by rulesImage(): the image is used in place, and must stay valid
+   | (and aligned as an int) until rulesFree().  Returns 0 if the image
+   | is not valid, or if out of memory.  The children of every node
+   | must come after it, and fit in the image, so that no lookup may
+   | loop or get out of it; the RULE_REMOVE identifiers must be from 0
+   | to nIds - 1.
+  **/
+
+  const RuleNode *nodes = image;
+  unsigned        n, i;
+  Rules          *pR;
+
+  if (size == 0 || size % sizeof(RuleNode) != 0) {
+    return 0;
+  }
+  n = size / sizeof(RuleNode);
+  for (i = 0;   i < n;   i++) {
+    if (nodes[i].nKids != 0 &&
+        (nodes[i].first <= i || nodes[i].first > n ||
+         nodes[i].nKids > n - nodes[i].first)) {
+      return 0;
+    }
+    if ((nodes[i].kinds & RULE_REMOVE) &&
+        (nodes[i].id < 0 || nodes[i].id >= nIds)) {
+      return 0;
+    }
+  }
+
+  if ((pR = calloc(1, sizeof(Rules))) == 0) {
+    return 0;
+  }
+  pR->nodes    = (RuleNode *) nodes;
+  pR->nNodes   = n;
+  pR->mNodes   = n;
+  pR->compiled = 1;
+  pR->mapped   = 1;
+  rootTable(pR);
+  return pR;
+}
+
+void rulesMatch(
+  const Rules *pR,
+  const char  *name,
+  size_t       len,
+  RulesMatch  *pM
+){
+
+  /**
+   | Looks up the name "name", of length "len"; the set must have been
+   | compiled.  A suffix as long as the whole name matches too.
+  **/
+
+  const RuleNode *nodes = pR->nodes;
+  const RuleNode *pN;
+  size_t          depth = 1;
+
+  pM->id     = -1;
+  pM->keep   = 0;
+  pM->len    = 0;
+  pM->backup = 0;
+
+  if (len == 0 || pR->root[(unsigned char) name[len - 1]] == 0) return;
+  pN = &nodes[pR->root[(unsigned char) name[len - 1]]];
+
+  for (;;) {
+    if (pN->kinds & RULE_BACKUP) {
+      pM->backup = depth;
+    }
+    if (pN->kinds & RULE_REMOVE) {
+      pM->id   = pN->id;
+      pM->keep = (pN->kinds & RULE_KEEP) != 0;
+      pM->len  = depth;
+    }
+
+    if (depth == len || pN->nKids == 0) break;
+
+    {
+      unsigned char   c   = name[len - 1 - depth];
+      const RuleNode *pK  = &nodes[pN->first];
+      unsigned        lo  = 0, hi = pN->nKids;
+
+      while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (pK[mid].c < c) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      if (lo == pN->nKids || pK[lo].c != c) break;
+      pN = &pK[lo];
+      depth++;
+    }
+  }
+}
+
+void rulesFree(
+  Rules *pR
+){
+  if (pR == 0) return;
+  if (! pR->mapped) {
+    free(pR->nodes);
+  }
+  free(pR);
+}
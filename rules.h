@@ -0,0 +1,69 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Compiled file name rules.  All the suffixes that matter (extensions
+  of the files to be removed, extensions to be kept, the trailer of
+  the editor backup files) are merged in a single trie of reversed
+  strings, compiled once into flat arrays; a file name is looked up
+  walking back from its last character, in time proportional to the
+  length of the longest matching suffix.  Extensions may contain more
+  than one dot (".synctex.gz", ".toc.old").  The compiled rules may be
+  saved as an image, to be mapped from a file by later runs.
+*/
+
+#ifndef RULES_H_
+#define RULES_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | Kinds of rules:
+ | - RULE_REMOVE: an extension of the files to be removed, with an
+ |   identifier chosen by the caller (the first one given wins, if the
+ |   same extension is added twice).  An extension must start with a
+ |   dot, and have at least one more character;
+ | - RULE_KEEP: an extension to be kept: it matters only if it is also
+ |   the extension of a RULE_REMOVE;
+ | - RULE_BACKUP: the trailer of the backup files (any string).
+**/
+
+#define RULE_REMOVE 1
+#define RULE_KEEP   2
+#define RULE_BACKUP 4
+
+/**
+ | Result of a lookup: "id" is the identifier of the longest RULE_REMOVE
+ | suffix of the name, or -1; "len" its length, and "keep" is set if it
+ | is a RULE_KEEP too; "backup" is the length of the RULE_BACKUP suffix,
+ | 0 if the name does not end with the trailer.
+**/
+
+typedef struct sRulesMatch {
+  int    id;
+  int    keep;
+  size_t len;
+  size_t backup;
+} RulesMatch;
+
+typedef struct sRules Rules;
+
+Rules *rulesNew(void);
+int    rulesAdd(Rules *, const char *, int, int);
+int    rulesCompile(Rules *);
+void   rulesMatch(const Rules *, const char *, size_t, RulesMatch *);
+size_t rulesImage(const Rules *, void *);
+Rules *rulesMap(const void *, size_t, int);
+void   rulesFree(Rules *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RULES_H_ */
@@ -0,0 +1,503 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Persistent scan index: see scanidx.h .  A ScanIdx must be used by one
+  thread at a time.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "scanidx.h"
+
+/**
+ | The index file, in the byte order of the machine that wrote it:
+ | - IdxHeader: a magic string (with the format version), a known
+ |   value telling the byte order, the fingerprint, and the number of
+ |   directories, of entries and of bytes of names that follow;
+ | - IdxDir: for every directory, sorted by device and inode, its
+ |   timestamps and the position and number of its entries;
+ | - IdxEntry: for every entry, its inode and type, and where its name
+ |   (null terminated) is in the names that come last.
+ | Every name is preceded by at least DENTS_BEHIND bytes of the file,
+ | as the names returned by a directory reader (see dents.h).
+**/
+
+#define IDX_MAGIC "LTXIDX\0\1"
+#define IDX_ORDER 0x01020304UL
+
+typedef struct sIdxHeader {
+  char     magic[8];
+  uint32_t order;
+  uint32_t print;
+  uint32_t nDirs;
+  uint32_t nEntries;
+  uint32_t lNames;
+  uint32_t unused;
+} IdxHeader;
+
+typedef struct sIdxDir {
+  uint64_t dev;
+  uint64_t ino;
+  int64_t  mSec;
+  int64_t  cSec;
+  uint32_t mNsec;
+  uint32_t cNsec;
+  uint32_t first;
+  uint32_t count;
+} IdxDir;
+
+typedef struct sIdxEntry {
+  uint64_t ino;
+  uint32_t nameOff;
+  uint16_t len;
+  uint16_t type;
+} IdxEntry;
+
+/**
+ | - path, print: the index file and the fingerprint;
+ | - map, mapSize: the old index, if any (and valid), mapped; "oDirs",
+ |   "oEnts" and "oNames" point into it;
+ | - found: the entries of the directory last found, as handed out;
+ | - dirs, ents, names: the new index, as it is recorded; "current"
+ |   tells whether a directory is being recorded, and "now" when its
+ |   recording began.
+**/
+
+struct sScanIdx {
+  char            *path;
+  uint32_t         print;
+
+  void            *map;
+  size_t           mapSize;
+  const IdxHeader *oHdr;
+  const IdxDir    *oDirs;
+  const IdxEntry  *oEnts;
+  const char      *oNames;
+
+  DentsEntry      *found;
+  size_t           mFound;
+
+  IdxDir          *dirs;
+  size_t           nDirs;
+  size_t           mDirs;
+  IdxEntry        *ents;
+  size_t           nEnts;
+  size_t           mEnts;
+  char            *names;
+  size_t           lNames;
+  size_t           mNames;
+  int              current;
+  struct timespec  now;
+};
+
+static int  compareDirs(const void *, const void *);
+static void mapOld(ScanIdx *);
+static int  sameTimes(const IdxDir *, const struct stat *);
+
+ScanIdx *scanidxOpen(
+  const char    *path,
+  unsigned long  print
+){
+
+  /**
+   | Opens the index kept in the file "path", for the configuration
+   | whose fingerprint is "print".  A missing, invalid or unreadable
+   | file is taken as an empty index.  Returns 0 if out of memory.
+  **/
+
+  ScanIdx *pI;
+
+  if ((pI = calloc(1, sizeof(ScanIdx))) == 0) {
+    return 0;
+  }
+  if ((pI->path = malloc(strlen(path) + 1)) == 0) {
+    free(pI);
+    return 0;
+  }
+  strcpy(pI->path, path);
+  pI->print = (uint32_t) print;
+
+  mapOld(pI);
+  return pI;
+}
+
+static void mapOld(
+  ScanIdx *pI
+){
+
+  /**
+   | Maps the old index, and checks that its parts fit in the file;
+   | the entries are checked when they are used.
+  **/
+
+  struct stat      st;
+  const IdxHeader *pH;
+  size_t           size;
+  int              fd;
+
+  if ((fd = open(pI->path, O_RDONLY)) < 0) {
+    return;
+  }
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(IdxHeader)) {
+    close(fd);
+    return;
+  }
+  pI->mapSize = st.st_size;
+  pI->map     = mmap(0, pI->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pI->map == MAP_FAILED) {
+    pI->map = 0;
+    return;
+  }
+
+  pH   = pI->map;
+  size = sizeof(IdxHeader) + pH->nDirs * sizeof(IdxDir) +
+         pH->nEntries * sizeof(IdxEntry) + pH->lNames;
+
+  if (memcmp(pH->magic, IDX_MAGIC, sizeof(pH->magic)) != 0 ||
+      pH->order != IDX_ORDER || pH->print != pI->print ||
+      size != pI->mapSize) {
+    munmap(pI->map, pI->mapSize);
+    pI->map = 0;
+    return;
+  }
+
+  pI->oHdr   = pH;
+  pI->oDirs  = (const IdxDir *) (pH + 1);
+  pI->oEnts  = (const IdxEntry *) (pI->oDirs + pH->nDirs);
+  pI->oNames = (const char *) (pI->oEnts + pH->nEntries);
+}
+
+long scanidxFind(
+  ScanIdx            *pI,
+  const struct stat  *pSt,
+  const DentsEntry  **pEnts
+){
+
+  /**
+   | Looks for the directory whose metadata are "pSt" in the old index:
+   | if it is there, with the same timestamps, stores in "*pEnts" its
+   | recorded entries (valid until the next call) and returns their
+   | number.  Otherwise returns -1.
+  **/
+
+  const IdxDir *pD = 0;
+  size_t        lo = 0, hi, i;
+  IdxDir        key;
+
+  if (pI->oHdr == 0) {
+    return -1;
+  }
+
+  key.dev = pSt->st_dev;
+  key.ino = pSt->st_ino;
+  hi      = pI->oHdr->nDirs;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int    c   = compareDirs(&key, pI->oDirs + mid);
+
+    if (c == 0) {
+      pD = pI->oDirs + mid;
+      break;
+    }
+    if (c < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  if (pD == 0 || !sameTimes(pD, pSt) ||
+      pD->first > pI->oHdr->nEntries ||
+      pD->count > pI->oHdr->nEntries - pD->first) {
+    return -1;
+  }
+
+  if (pD->count > pI->mFound) {
+    DentsEntry *p = realloc(pI->found, pD->count * sizeof(DentsEntry));
+
+    if (p == 0) {
+      return -1;
+    }
+    pI->found  = p;
+    pI->mFound = pD->count;
+  }
+
+  for (i = 0;   i < pD->count;   i++) {
+    const IdxEntry *pE = pI->oEnts + pD->first + i;
+
+    if (pE->nameOff >= pI->oHdr->lNames ||
+        pE->len >= pI->oHdr->lNames - pE->nameOff ||
+        pI->oNames[pE->nameOff + pE->len] != '\0') {
+      return -1;
+    }
+    pI->found[i].name = pI->oNames + pE->nameOff;
+    pI->found[i].len  = pE->len;
+    pI->found[i].ino  = pE->ino;
+    pI->found[i].type = pE->type;
+  }
+
+  *pEnts = pI->found;
+  return pD->count;
+}
+
+void scanidxBegin(
+  ScanIdx           *pI,
+  const struct stat *pSt
+){
+
+  /**
+   | Starts recording the directory whose metadata are "pSt"; if out
+   | of memory, the directory is not recorded.
+  **/
+
+  IdxDir *pD;
+
+  pI->current = 0;
+
+  if (pI->nDirs == pI->mDirs) {
+    size_t  m = pI->mDirs == 0 ? 64 : 2 * pI->mDirs;
+    IdxDir *p = realloc(pI->dirs, m * sizeof(IdxDir));
+
+    if (p == 0) {
+      return;
+    }
+    pI->dirs  = p;
+    pI->mDirs = m;
+  }
+
+  pD        = pI->dirs + pI->nDirs;
+  pD->dev   = pSt->st_dev;
+  pD->ino   = pSt->st_ino;
+  pD->mSec  = pSt->st_mtim.tv_sec;
+  pD->mNsec = pSt->st_mtim.tv_nsec;
+  pD->cSec  = pSt->st_ctim.tv_sec;
+  pD->cNsec = pSt->st_ctim.tv_nsec;
+  pD->first = pI->nEnts;
+  pD->count = 0;
+
+  clock_gettime(CLOCK_REALTIME, &pI->now);
+  pI->current = 1;
+}
+
+int scanidxEntry(
+  ScanIdx       *pI,
+  const char    *name,
+  size_t         len,
+  unsigned long  ino,
+  int            type
+){
+
+  /**
+   | Records the entry "name" (of length "len") of the directory being
+   | recorded, if any.  Returns 0, or -1 if out of memory.
+  **/
+
+  IdxEntry *pE;
+
+  if (!pI->current) {
+    return 0;
+  }
+
+  if (pI->nEnts == pI->mEnts) {
+    size_t    m = pI->mEnts == 0 ? 1024 : 2 * pI->mEnts;
+    IdxEntry *p = realloc(pI->ents, m * sizeof(IdxEntry));
+
+    if (p == 0) {
+      return -1;
+    }
+    pI->ents  = p;
+    pI->mEnts = m;
+  }
+  if (pI->lNames + len + 1 > pI->mNames) {
+    size_t  m = pI->mNames == 0 ? 16384 : 2 * pI->mNames;
+    char   *p;
+
+    while (pI->lNames + len + 1 > m) {
+      m *= 2;
+    }
+    if ((p = realloc(pI->names, m)) == 0) {
+      return -1;
+    }
+    pI->names  = p;
+    pI->mNames = m;
+  }
+
+  pE          = pI->ents + pI->nEnts++;
+  pE->ino     = ino;
+  pE->nameOff = pI->lNames;
+  pE->len     = len;
+  pE->type    = type;
+  memcpy(pI->names + pI->lNames, name, len + 1);
+  pI->lNames += len + 1;
+
+  pI->dirs[pI->nDirs].count++;
+  return 0;
+}
+
+void scanidxEnd(
+  ScanIdx *pI,
+  int      complete
+){
+
+  /**
+   | Ends the recording of the current directory: it is kept only if
+   | "complete" (all of its entries have been seen), and if both its
+   | timestamps are older than SCANIDX_RACY seconds before the
+   | recording began, so that any later change will show up in them.
+   | Otherwise its entries are dropped.
+  **/
+
+  IdxDir *pD;
+  long    limit;
+
+  if (!pI->current) {
+    return;
+  }
+  pI->current = 0;
+
+  pD    = pI->dirs + pI->nDirs;
+  limit = (long) pI->now.tv_sec - SCANIDX_RACY;
+
+  if (complete && pD->mSec < limit && pD->cSec < limit) {
+    pI->nDirs++;
+  } else {
+    if (pD->count > 0) {
+      pI->lNames = pI->ents[pD->first].nameOff;
+    }
+    pI->nEnts = pD->first;
+  }
+}
+
+int scanidxClose(
+  ScanIdx *pI
+){
+
+  /**
+   | Writes the new index, in a temporary file renamed over the old
+   | one, and frees everything.  Returns 0, or -1 (with errno set) if
+   | the index could not be written.
+  **/
+
+  IdxHeader  header;
+  char      *tmp;
+  size_t     i, n;
+  int        fd, err = 0;
+  FILE      *fp;
+
+  if (pI == 0) {
+    return 0;
+  }
+
+  /**
+   | A directory recorded more than once (reached through different
+   | paths) is written once.
+  **/
+
+  qsort(pI->dirs, pI->nDirs, sizeof(IdxDir), compareDirs);
+  for (i = n = 0;   i < pI->nDirs;   i++) {
+    if (n == 0 || compareDirs(pI->dirs + i, pI->dirs + n - 1) != 0) {
+      pI->dirs[n++] = pI->dirs[i];
+    }
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IDX_MAGIC, sizeof(header.magic));
+  header.order    = IDX_ORDER;
+  header.print    = pI->print;
+  header.nDirs    = n;
+  header.nEntries = pI->nEnts;
+  header.lNames   = pI->lNames;
+
+  if ((tmp = malloc(strlen(pI->path) + 8)) == 0) {
+    err = ENOMEM;
+  } else {
+    sprintf(tmp, "%s.XXXXXX", pI->path);
+    if ((fd = mkstemp(tmp)) < 0) {
+      err = errno;
+    } else if ((fp = fdopen(fd, "wb")) == 0) {
+      err = errno;
+      close(fd);
+      unlink(tmp);
+    } else {
+      if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+          fwrite(pI->dirs, sizeof(IdxDir), n, fp) != n ||
+          fwrite(pI->ents, sizeof(IdxEntry), pI->nEnts, fp) != pI->nEnts ||
+          fwrite(pI->names, 1, pI->lNames, fp) != pI->lNames) {
+        err = errno;
+      }
+      if (fclose(fp) != 0 && err == 0) {
+        err = errno;
+      }
+      if (err == 0 && rename(tmp, pI->path) != 0) {
+        err = errno;
+      }
+      if (err != 0) {
+        unlink(tmp);
+      }
+    }
+    free(tmp);
+  }
+
+  if (pI->map != 0) {
+    munmap(pI->map, pI->mapSize);
+  }
+  free(pI->found);
+  free(pI->dirs);
+  free(pI->ents);
+  free(pI->names);
+  free(pI->path);
+  free(pI);
+
+  if (err != 0) {
+    errno = err;
+    return -1;
+  }
+  return 0;
+}
+
+static int compareDirs(
+  const void *p1,
+  const void *p2
+){
+
+  /**
+   | Orders the directories by device and inode.
+  **/
+
+  const IdxDir *pD1 = p1, *pD2 = p2;
+
+  if (pD1->dev != pD2->dev) {
+    return pD1->dev < pD2->dev ? -1 : 1;
+  }
+  if (pD1->ino != pD2->ino) {
+    return pD1->ino < pD2->ino ? -1 : 1;
+  }
+  return 0;
+}
+
+static int sameTimes(
+  const IdxDir      *pD,
+  const struct stat *pSt
+){
+  return pD->mSec  == pSt->st_mtim.tv_sec  &&
+         pD->mNsec == (uint32_t) pSt->st_mtim.tv_nsec &&
+         pD->cSec  == pSt->st_ctim.tv_sec  &&
+         pD->cNsec == (uint32_t) pSt->st_ctim.tv_nsec;
+}
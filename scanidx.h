@@ -0,0 +1,58 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Persistent scan index.  For every directory scanned, the index keeps
+  its identity and timestamps (device, inode, modification and change
+  times, to the nanosecond) and the directory entries that the scan
+  had to act upon: usually a small part of them.  Adding, removing or
+  renaming an entry changes the timestamps of the directory; so, on
+  the next run, a directory whose timestamps did not change can be
+  "read" from the index, without reading the whole directory again.
+
+  The index is a file, memory mapped when opened; a new one is written
+  (and renamed over the old one) when closed, with the directories
+  recorded in the meantime.  It holds a fingerprint of whatever decides
+  which entries are recorded: an index with another fingerprint is
+  ignored.  A directory whose timestamps are too close to the time of
+  the scan is not recorded, since it might still change without its
+  timestamps changing.
+*/
+
+#ifndef SCANIDX_H_
+#define SCANIDX_H_
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "dents.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - SCANIDX_RACY: a directory modified less than these seconds before
+ |   it is scanned is not recorded;
+ | - ScanIdx: the index.  Lookups are answered from the old index file;
+ |   one directory at a time may be recorded, between scanidxBegin()
+ |   and scanidxEnd(), for the new one.
+**/
+
+#define SCANIDX_RACY 2
+
+typedef struct sScanIdx ScanIdx;
+
+ScanIdx *scanidxOpen(const char *, unsigned long);
+long     scanidxFind(ScanIdx *, const struct stat *, const DentsEntry **);
+void     scanidxBegin(ScanIdx *, const struct stat *);
+int      scanidxEntry(ScanIdx *, const char *, size_t, unsigned long, int);
+void     scanidxEnd(ScanIdx *, int);
+int      scanidxClose(ScanIdx *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCANIDX_H_ */
@@ -0,0 +1,284 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Output sink: see sink.h .  A Sink must be used by one thread at a
+  time; memory sinks let several threads write their own output, to
+  be appended in order to the real one.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "sink.h"
+
+/**
+ | - fp: the stream written to; for a memory sink, the one returned by
+ |   open_memstream(3), that keeps in "buf" the "size" bytes written.
+**/
+
+struct sSink {
+  FILE   *fp;
+  int     format;
+  int     memory;
+  char   *buf;
+  size_t  size;
+};
+
+static const char *actions[] = {
+  "removed", "would-remove", "kept"
+};
+
+static const char *reasons[] = {
+  "stale", "backup", "tex-newer", "no-tex", "read-only", "keep"
+};
+
+static void putJson(FILE *, const char *);
+static void putNumber(FILE *, double);
+static void putPath(FILE *, const SinkRecord *, int);
+
+Sink *sinkOpen(
+  FILE *fp,
+  int   format
+){
+
+  /**
+   | Opens a sink writing in "format" on "fp", or in memory if "fp" is
+   | 0.  Returns 0 if out of memory.
+  **/
+
+  Sink *pS;
+
+  if ((pS = calloc(1, sizeof(Sink))) == 0) {
+    return 0;
+  }
+  pS->format = format;
+
+  if (fp == 0) {
+    if ((pS->fp = open_memstream(&pS->buf, &pS->size)) == 0) {
+      free(pS);
+      return 0;
+    }
+    pS->memory = 1;
+
+  } else {
+    char *buf;
+
+    /**
+     | The buffer is used by the stream until the program exits: it is
+     | never freed.
+    **/
+
+    pS->fp = fp;
+    if (!isatty(fileno(fp)) && (buf = malloc(SINK_BUFFER)) != 0) {
+      setvbuf(fp, buf, _IOFBF, SINK_BUFFER);
+    }
+  }
+
+  return pS;
+}
+
+int sinkFormat(
+  const char *name
+){
+
+  /**
+   | Returns the format called "name" ("text", "json" or "nul"), or -1.
+  **/
+
+  if (strcmp(name, "text") == 0) return SINK_TEXT;
+  if (strcmp(name, "json") == 0) return SINK_JSON;
+  if (strcmp(name, "nul")  == 0) return SINK_NUL;
+  return -1;
+}
+
+void sinkInit(
+  SinkRecord *pR,
+  const char *dir,
+  const char *name,
+  int         action,
+  int         reason
+){
+
+  /**
+   | Fills "pR" for the file "name" in "dir", with size and times
+   | unknown.
+  **/
+
+  pR->dir      = dir;
+  pR->name     = name;
+  pR->action   = action;
+  pR->reason   = reason;
+  pR->size     = -1;
+  pR->mTime    = -1;
+  pR->texMtime = -1;
+}
+
+void sinkEvent(
+  Sink             *pS,
+  const SinkRecord *pR,
+  const char       *fmt,
+  ...
+){
+
+  /**
+   | Writes the file "pR" in the format of the sink; in text format,
+   | the message "fmt" (formatted as printf(3) does) is written
+   | instead.  Either may be 0: a message without a file is written in
+   | text format only.
+  **/
+
+  va_list ap;
+
+  switch (pS->format) {
+    case SINK_TEXT:
+      if (fmt != 0) {
+        va_start(ap, fmt);
+        vfprintf(pS->fp, fmt, ap);
+        va_end(ap);
+      }
+      break;
+
+    case SINK_JSON:
+      if (pR != 0) {
+        fputs("{\"path\":\"", pS->fp);
+        putPath(pS->fp, pR, 1);
+        fputs("\",\"action\":\"", pS->fp);
+        fputs(actions[pR->action], pS->fp);
+        fputs("\",\"reason\":\"", pS->fp);
+        fputs(reasons[pR->reason], pS->fp);
+        fputs("\",\"size\":", pS->fp);
+        putNumber(pS->fp, (double) pR->size);
+        fputs(",\"mtime\":", pS->fp);
+        putNumber(pS->fp, (double) pR->mTime);
+        fputs(",\"tex_mtime\":", pS->fp);
+        putNumber(pS->fp, (double) pR->texMtime);
+        fputs("}\n", pS->fp);
+      }
+      break;
+
+    case SINK_NUL:
+      if (pR != 0 && pR->action != SINK_KEPT) {
+        putPath(pS->fp, pR, 0);
+        putc('\0', pS->fp);
+      }
+      break;
+  }
+}
+
+void sinkAppend(
+  Sink *pS,
+  Sink *pMem
+){
+
+  /**
+   | Appends to "pS" what has been written so far in the memory sink
+   | "pMem".
+  **/
+
+  fflush(pMem->fp);
+  if (pMem->size > 0) {
+    fwrite(pMem->buf, 1, pMem->size, pS->fp);
+  }
+}
+
+int sinkFlush(
+  Sink *pS
+){
+  return fflush(pS->fp) == 0 && !ferror(pS->fp) ? 0 : -1;
+}
+
+int sinkClose(
+  Sink *pS
+){
+
+  /**
+   | Flushes and closes the sink; the stream of a sink that is not in
+   | memory stays open.  Returns -1 if something could not be written.
+  **/
+
+  int ret;
+
+  if (pS == 0) {
+    return 0;
+  }
+  ret = sinkFlush(pS);
+  if (pS->memory) {
+    fclose(pS->fp);
+    free(pS->buf);
+  }
+  free(pS);
+  return ret;
+}
+
+static void putJson(
+  FILE       *fp,
+  const char *s
+){
+
+  /**
+   | Writes "s" as the contents of a JSON string.
+  **/
+
+  const char *p;
+
+  for (p = s;   *p != '\0';   p++) {
+    unsigned char c = (unsigned char) *p;
+
+    if (c == '"' || c == '\\') {
+      putc('\\', fp);
+      putc(c, fp);
+    } else if (c < 0x20) {
+      fprintf(fp, "\\u%04x", c);
+    } else {
+      putc(c, fp);
+    }
+  }
+}
+
+static void putNumber(
+  FILE   *fp,
+  double  n
+){
+
+  /**
+   | Writes the integer "n", or null if negative.  A double holds
+   | exactly any size or time that may be met.
+  **/
+
+  if (n < 0.0) {
+    fputs("null", fp);
+  } else {
+    fprintf(fp, "%.0f", n);
+  }
+}
+
+static void putPath(
+  FILE             *fp,
+  const SinkRecord *pR,
+  int               json
+){
+  size_t lDir = pR->dir != 0 ? strlen(pR->dir) : 0;
+
+  if (lDir > 0) {
+    if (json) {
+      putJson(fp, pR->dir);
+    } else {
+      fputs(pR->dir, fp);
+    }
+    if (pR->dir[lDir - 1] != '/') {
+      putc('/', fp);
+    }
+  }
+  if (json) {
+    putJson(fp, pR->name);
+  } else {
+    fputs(pR->name, fp);
+  }
+}
@@ -0,0 +1,94 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Output sink.  What is done with the files (removed, would be removed,
+  not removed, and why) is written through a sink, in one of the
+  formats below:
+  - SINK_TEXT: the human readable messages given by the caller;
+  - SINK_JSON: one JSON object per line (NDJSON) for every file, with
+    its path, the action, the reason and, when known, the size and the
+    modification times of the file and of its .tex source (null when
+    unknown); the path is written byte by byte, with only the quotes,
+    the backslashes and the control characters escaped;
+  - SINK_NUL: the path of every removed file (or of every file that
+    would be removed) followed by a NUL character, as find -print0
+    does, for xargs -0 and the like.
+  A sink writes on a stdio stream, given a large buffer unless it is a
+  terminal, so that nothing is written until the buffer is full or the
+  sink is flushed; or in memory, to be appended later to another sink.
+*/
+
+#ifndef SINK_H_
+#define SINK_H_
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - SINK_BUFFER: size of the buffer given to the stream;
+ | - the formats;
+ | - the actions: removed, would have been removed (pretend), not
+ |   removed;
+ | - the reasons: for the removals, a file newer than its .tex source
+ |   (or older, if so allowed) and an editor backup; for the files not
+ |   removed, a .tex source newer than the file, a missing .tex source,
+ |   a read only file and an extension to keep.
+**/
+
+#define SINK_BUFFER (1024 * 1024)
+
+#define SINK_TEXT 0
+#define SINK_JSON 1
+#define SINK_NUL  2
+
+#define SINK_REMOVED 0
+#define SINK_PRETEND 1
+#define SINK_KEPT    2
+
+#define SINK_STALE     0
+#define SINK_BACKUP    1
+#define SINK_TEX_NEWER 2
+#define SINK_NO_TEX    3
+#define SINK_READ_ONLY 4
+#define SINK_KEEP      5
+
+/**
+ | - Sink: the sink;
+ | - SinkRecord: a file, "name" in the directory "dir" (joined with a
+ |   slash, unless "dir" is empty or already ends with one); the size
+ |   and the times are negative when unknown.
+**/
+
+typedef struct sSink Sink;
+
+typedef struct sSinkRecord {
+  const char *dir;
+  const char *name;
+  int         action;
+  int         reason;
+  off_t       size;
+  time_t      mTime;
+  time_t      texMtime;
+} SinkRecord;
+
+Sink *sinkOpen(FILE *, int);
+int   sinkFormat(const char *);
+void  sinkInit(SinkRecord *, const char *, const char *, int, int);
+void  sinkEvent(Sink *, const SinkRecord *, const char *, ...);
+void  sinkAppend(Sink *, Sink *);
+int   sinkFlush(Sink *);
+int   sinkClose(Sink *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SINK_H_ */
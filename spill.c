@@ -0,0 +1,550 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Spilled entries: see spill.h .  The budget is split between the
+  entries and their names, both allocated once; no memory is obtained
+  afterwards, but for the (small) buffers of the runs and of a family.
+  The runs are merged by picking, every time, the smallest of their
+  first entries: a linear search, as they are at most SPILL_FANIN;
+  when that many have been written, they are merged into a single one
+  before the next is.
+*/
+
+#define _GNU_SOURCE             /* mkstemp(), fdopen() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "spill.h"
+
+/**
+ | - SPILL_FANIN: the most runs kept at once;
+ | - SpillHead: an entry, as written in a run, followed by the "len"
+ |   characters of its name;
+ | - SpillRun: a run, its first entry not yet merged (if "live") and
+ |   where the name of the latter has been read;
+ | - Spill: the budget; the entries in memory and their names, with
+ |   their number, length and allocated sizes; the runs written, and
+ |   the count of those written since the set was emptied.  Then the
+ |   state of the set: while merging, "next" is the next entry in
+ |   memory (if no run has been written); "family" the entries of the
+ |   current family, whose basename is in "base"; "err" the error
+ |   that made the set unusable, if any.
+**/
+
+#define SPILL_FANIN 32
+
+#define SPILL_ADDING  0
+#define SPILL_MEMORY  1
+#define SPILL_MERGING 2
+
+typedef struct sSpillHead {
+  time_t mTime;
+  off_t  size;
+  int    ext;
+  int    tag;
+  size_t len;
+} SpillHead;
+
+typedef struct sSpillRun {
+  FILE       *file;
+  SpillEntry  head;
+  char       *name;
+  size_t      mName;
+  int         live;
+} SpillRun;
+
+struct sSpill {
+  size_t         budget;
+  SpillEntry    *ents;
+  size_t         nEnts;
+  size_t         mEnts;
+  char          *names;
+  size_t         lNames;
+  size_t         mNames;
+  SpillRun       runs[SPILL_FANIN];
+  int            nRuns;
+  unsigned long  written;
+  int            state;
+  size_t         next;
+  SpillEntry    *family;
+  size_t         mFamily;
+  char          *base;
+  size_t         mBase;
+  int            err;
+};
+
+static int       begin(Spill *);
+static int       collapse(Spill *);
+static int       compareEntries(const void *, const void *);
+static int       fail(Spill *);
+static int       flush(Spill *);
+static void     *grow(void *, size_t *, size_t, size_t);
+static FILE     *newRun(Spill *);
+static int       nextEntry(Spill *, SpillRun *);
+static SpillRun *pickRun(Spill *);
+static int       putEntry(FILE *, const SpillEntry *);
+static int       startRuns(Spill *);
+
+Spill *spillOpen(
+  size_t budget
+){
+  Spill *pS;
+
+  if ((pS = calloc(1, sizeof(Spill))) == 0) {
+    return 0;
+  }
+  pS->budget = budget < SPILL_MIN ? SPILL_MIN : budget;
+  return pS;
+}
+
+int spillAdd(
+  Spill      *pS,
+  const char *name,
+  size_t      len,
+  int         ext,
+  time_t      mTime,
+  off_t       size,
+  int         tag
+){
+
+  /**
+   | Half of the budget goes to the entries, the rest to their names:
+   | when either is full, the entries are written to a run.
+  **/
+
+  SpillEntry *pE;
+
+  if (pS->err != 0) {
+    errno = pS->err;
+    return -1;
+  }
+  if (pS->ents == 0) {
+    pS->mEnts  = pS->budget / 2 / sizeof(SpillEntry);
+    pS->mNames = pS->budget - pS->mEnts * sizeof(SpillEntry);
+    if ((pS->ents = malloc(pS->mEnts * sizeof(SpillEntry))) == 0 ||
+        (pS->names = malloc(pS->mNames)) == 0) {
+      free(pS->ents);
+      pS->ents = 0;
+      return fail(pS);
+    }
+  }
+  if (len >= pS->mNames) {
+    errno = ENAMETOOLONG;
+    return fail(pS);
+  }
+  if ((pS->nEnts == pS->mEnts || pS->lNames + len + 1 > pS->mNames) &&
+      flush(pS) != 0) {
+    return -1;
+  }
+
+  pE = &pS->ents[pS->nEnts++];
+  memcpy(pS->names + pS->lNames, name, len);
+  pS->names[pS->lNames + len] = '\0';
+  pE->name  = pS->names + pS->lNames;
+  pE->ext   = ext;
+  pE->tag   = tag;
+  pE->mTime = mTime;
+  pE->size  = size;
+  pS->lNames += len + 1;
+  return 0;
+}
+
+long spillFamily(
+  Spill             *pS,
+  const SpillEntry **pFamily
+){
+  size_t n;
+
+  if (pS->err == 0 && pS->state == SPILL_ADDING) {
+    begin(pS);
+  }
+  if (pS->err != 0) {
+    errno = pS->err;
+    return -1;
+  }
+
+  for (n = 0;   ;   n++) {
+    const SpillEntry *pE;
+    SpillRun         *pR = 0;
+
+    if (pS->state == SPILL_MEMORY) {
+      pE = pS->next < pS->nEnts ? &pS->ents[pS->next] : 0;
+    } else {
+      pE = (pR = pickRun(pS)) != 0 ? &pR->head : 0;
+    }
+    if (pE == 0 || (n > 0 && strcmp(pE->name, pS->base) != 0)) {
+      break;
+    }
+
+    if (n == pS->mFamily) {
+      void *p = grow(pS->family, &pS->mFamily, n + 1, sizeof(SpillEntry));
+
+      if (p == 0) {
+        return fail(pS);
+      }
+      pS->family = p;
+    }
+    if (n == 0) {
+      size_t len = strlen(pE->name);
+
+      if (len + 1 > pS->mBase) {
+        void *p = grow(pS->base, &pS->mBase, len + 1, 1);
+
+        if (p == 0) {
+          return fail(pS);
+        }
+        pS->base = p;
+      }
+      memcpy(pS->base, pE->name, len + 1);
+    }
+    pS->family[n]      = *pE;
+    pS->family[n].name = pS->base;
+
+    if (pR == 0) {
+      pS->next++;
+    } else if (nextEntry(pS, pR) != 0) {
+      return -1;
+    }
+  }
+
+  *pFamily = pS->family;
+  return (long) n;
+}
+
+unsigned long spillRuns(
+  const Spill *pS
+){
+  return pS->written;
+}
+
+void spillReset(
+  Spill *pS
+){
+
+  /**
+   | The buffers are kept, for the next directory that needs them.
+  **/
+
+  int i;
+
+  for (i = 0;   i < pS->nRuns;   i++) {
+    fclose(pS->runs[i].file);
+    pS->runs[i].file = 0;
+  }
+  pS->nRuns   = 0;
+  pS->nEnts   = 0;
+  pS->lNames  = 0;
+  pS->written = 0;
+  pS->state   = SPILL_ADDING;
+  pS->next    = 0;
+  pS->err     = 0;
+}
+
+void spillClose(
+  Spill *pS
+){
+  int i;
+
+  if (pS == 0) return;
+
+  spillReset(pS);
+  for (i = 0;   i < SPILL_FANIN;   i++) {
+    free(pS->runs[i].name);
+  }
+  free(pS->ents);
+  free(pS->names);
+  free(pS->family);
+  free(pS->base);
+  free(pS);
+}
+
+static int begin(
+  Spill *pS
+){
+
+  /**
+   | Ends the additions: if no run has been written, the entries are
+   | merged straight from memory; otherwise they are written too, and
+   | all the runs are read back from their start.
+  **/
+
+  if (pS->nRuns == 0) {
+    qsort(pS->ents, pS->nEnts, sizeof(SpillEntry), compareEntries);
+    pS->state = SPILL_MEMORY;
+    pS->next  = 0;
+    return 0;
+  }
+  if (pS->nEnts > 0 && flush(pS) != 0) {
+    return -1;
+  }
+  pS->state = SPILL_MERGING;
+  return startRuns(pS);
+}
+
+static int collapse(
+  Spill *pS
+){
+
+  /**
+   | Merges all the runs into a new one, that takes their place.
+  **/
+
+  FILE     *pF;
+  SpillRun *pR;
+
+  if ((pF = newRun(pS)) == 0 || startRuns(pS) != 0) {
+    if (pF != 0) fclose(pF);
+    return -1;
+  }
+  while ((pR = pickRun(pS)) != 0) {
+    if (putEntry(pF, &pR->head) != 0) {
+      fclose(pF);
+      return fail(pS);
+    }
+    if (nextEntry(pS, pR) != 0) {
+      fclose(pF);
+      return -1;
+    }
+  }
+  if (pS->err != 0 || fflush(pF) != 0) {
+    fclose(pF);
+    return pS->err != 0 ? -1 : fail(pS);
+  }
+
+  while (pS->nRuns > 0) {
+    fclose(pS->runs[--pS->nRuns].file);
+    pS->runs[pS->nRuns].file = 0;
+  }
+  pS->runs[pS->nRuns++].file = pF;
+  pS->written++;
+  return 0;
+}
+
+static int compareEntries(
+  const void *p1,
+  const void *p2
+){
+  const SpillEntry *pE1 = p1;
+  const SpillEntry *pE2 = p2;
+  int               c   = strcmp(pE1->name, pE2->name);
+
+  return c != 0 ? c : (pE1->ext > pE2->ext) - (pE1->ext < pE2->ext);
+}
+
+static int fail(
+  Spill *pS
+){
+
+  /**
+   | Makes the set unusable, remembering why (errno): returns -1.
+  **/
+
+  pS->err = errno != 0 ? errno : EIO;
+  errno   = pS->err;
+  return -1;
+}
+
+static int flush(
+  Spill *pS
+){
+
+  /**
+   | Writes the entries in memory, sorted, to a new run.
+  **/
+
+  FILE   *pF;
+  size_t  i;
+
+  if (pS->nRuns == SPILL_FANIN && collapse(pS) != 0) {
+    return -1;
+  }
+  if ((pF = newRun(pS)) == 0) {
+    return -1;
+  }
+  qsort(pS->ents, pS->nEnts, sizeof(SpillEntry), compareEntries);
+  for (i = 0;   i < pS->nEnts;   i++) {
+    if (putEntry(pF, &pS->ents[i]) != 0) {
+      break;
+    }
+  }
+  if (i < pS->nEnts || fflush(pF) != 0) {
+    fclose(pF);
+    return fail(pS);
+  }
+
+  pS->runs[pS->nRuns++].file = pF;
+  pS->written++;
+  pS->nEnts  = 0;
+  pS->lNames = 0;
+  return 0;
+}
+
+static void *grow(
+  void   *buf,
+  size_t *pSize,
+  size_t  wanted,
+  size_t  unit
+){
+
+  /**
+   | Enlarges "buf", of "*pSize" elements of "unit" bytes, to at least
+   | "wanted" of them: returns the new buffer, or 0 (and "buf" is left
+   | alone) if out of memory.
+  **/
+
+  size_t  size = *pSize == 0 ? 16 : *pSize;
+  void   *p;
+
+  while (size < wanted) {
+    size *= 2;
+  }
+  if ((p = realloc(buf, size * unit)) != 0) {
+    *pSize = size;
+  }
+  return p;
+}
+
+static FILE *newRun(
+  Spill *pS
+){
+
+  /**
+   | A new run, open for writing and reading; it has no name, so that
+   | it goes away when closed.
+  **/
+
+  const char *dir = getenv("TMPDIR");
+  char       *path;
+  FILE       *pF = 0;
+  int         fd;
+
+  if (dir == 0 || *dir == '\0') {
+    dir = "/tmp";
+  }
+  if ((path = malloc(strlen(dir) + sizeof("/lintexXXXXXX"))) == 0) {
+    fail(pS);
+    return 0;
+  }
+  sprintf(path, "%s/lintexXXXXXX", dir);
+  if ((fd = mkstemp(path)) >= 0) {
+    unlink(path);
+    if ((pF = fdopen(fd, "w+b")) == 0) {
+      close(fd);
+    }
+  }
+  free(path);
+  if (pF == 0) {
+    fail(pS);
+  }
+  return pF;
+}
+
+static int nextEntry(
+  Spill    *pS,
+  SpillRun *pR
+){
+
+  /**
+   | Reads the next entry of the run "pR", if any.
+  **/
+
+  SpillHead head;
+
+  if (fread(&head, sizeof(SpillHead), 1, pR->file) != 1) {
+    if (ferror(pR->file)) {
+      return fail(pS);
+    }
+    pR->live = 0;
+    return 0;
+  }
+  if (head.len + 1 > pR->mName) {
+    void *p = grow(pR->name, &pR->mName, head.len + 1, 1);
+
+    if (p == 0) {
+      return fail(pS);
+    }
+    pR->name = p;
+  }
+  if (fread(pR->name, 1, head.len, pR->file) != head.len) {
+    if (!ferror(pR->file)) {
+      errno = EIO;              /* Truncated */
+    }
+    return fail(pS);
+  }
+  pR->name[head.len] = '\0';
+
+  pR->head.name  = pR->name;
+  pR->head.ext   = head.ext;
+  pR->head.tag   = head.tag;
+  pR->head.mTime = head.mTime;
+  pR->head.size  = head.size;
+  pR->live       = 1;
+  return 0;
+}
+
+static SpillRun *pickRun(
+  Spill *pS
+){
+
+  /**
+   | The run whose first entry comes first, 0 if all are exhausted.
+  **/
+
+  SpillRun *pMin = 0;
+  int       i;
+
+  for (i = 0;   i < pS->nRuns;   i++) {
+    SpillRun *pR = &pS->runs[i];
+
+    if (pR->live &&
+        (pMin == 0 || compareEntries(&pR->head, &pMin->head) < 0)) {
+      pMin = pR;
+    }
+  }
+  return pMin;
+}
+
+static int putEntry(
+  FILE             *pF,
+  const SpillEntry *pE
+){
+  SpillHead head;
+
+  memset(&head, 0, sizeof(SpillHead));
+  head.mTime = pE->mTime;
+  head.size  = pE->size;
+  head.ext   = pE->ext;
+  head.tag   = pE->tag;
+  head.len   = strlen(pE->name);
+
+  return fwrite(&head, sizeof(SpillHead), 1, pF) == 1 &&
+         fwrite(pE->name, 1, head.len, pF) == head.len ? 0 : -1;
+}
+
+static int startRuns(
+  Spill *pS
+){
+
+  /**
+   | Goes back to the start of every run, and reads its first entry.
+  **/
+
+  int i;
+
+  for (i = 0;   i < pS->nRuns;   i++) {
+    if (fseek(pS->runs[i].file, 0L, SEEK_SET) != 0) {
+      return fail(pS);
+    }
+    if (nextEntry(pS, &pS->runs[i]) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Spilled entries: the TeX-related files of a directory too large to
+  be held in memory, within a fixed budget.  The entries are gathered
+  in a buffer; when it is full, they are sorted by basename (then by
+  extension) and written to a temporary file, a "run".  Once the whole
+  directory has been read, the runs are merged, and the entries come
+  back one family (all those with the same basename) at a time.
+
+  The runs are created in $TMPDIR (/tmp if not set), and removed as
+  soon as created: nothing is left behind, however the program ends.
+*/
+
+#ifndef SPILL_H_
+#define SPILL_H_
+
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - SPILL_MIN: the smallest budget, in bytes (a smaller one is raised
+ |   to it);
+ | - SpillEntry: a file, as its basename, the identifier of its
+ |   extension (the entries of a family come in increasing order of
+ |   it), modification time and size, and a value the caller may use
+ |   (e.g. whether the file may be written);
+ | - spillOpen() returns a new, empty, set of entries that will use
+ |   about "budget" bytes of memory, or 0 if out of memory (the memory
+ |   is only allocated when the first entry is added);
+ | - spillAdd() adds an entry, whose basename is the first "len"
+ |   characters of the string given;
+ | - spillFamily() stops the additions and returns the number of the
+ |   entries of the next family, 0 when there are no more, pointing the
+ |   second argument to them: they are valid until the next call;
+ | - spillRuns() is the number of runs written since the set was
+ |   emptied;
+ | - spillReset() empties the set, that may be used again.
+ |
+ | spillAdd() and spillFamily() return -1, with errno set, if out of
+ | memory or if a run can't be written or read: the set is then
+ | unusable until reset.  A set may only be used by a thread at once.
+**/
+
+#define SPILL_MIN 4096
+
+typedef struct sSpill Spill;
+
+typedef struct sSpillEntry {
+  const char *name;
+  int         ext;
+  int         tag;
+  time_t      mTime;
+  off_t       size;
+} SpillEntry;
+
+Spill        *spillOpen(size_t);
+int           spillAdd(Spill *, const char *, size_t, int, time_t, off_t,
+                       int);
+long          spillFamily(Spill *, const SpillEntry **);
+unsigned long spillRuns(const Spill *);
+void          spillReset(Spill *);
+void          spillClose(Spill *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPILL_H_ */
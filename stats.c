@@ -0,0 +1,281 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Run statistics: see stats.h .
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+
+/**
+ | - phase: the current phase, entered at "since" (nanoseconds);
+ | - start: when the Stats was opened, for the total wall time.
+**/
+
+typedef struct sStatsHist {
+  double count;
+  double total;
+  double max;
+  double buckets[STATS_BUCKETS];
+} StatsHist;
+
+struct sStats {
+  double     counters[STATS_COUNTERS];
+  double     phases[STATS_PHASES];
+  StatsHist  hists[STATS_HISTS];
+  int        phase;
+  double     since;
+  double     start;
+};
+
+static const char *counterNames[STATS_COUNTERS] = {
+  "dirs", "entries", "stat_calls", "unlink_calls", "access_calls",
+  "removed", "bytes_removed", "kept_tex_newer", "kept_no_tex",
+  "kept_read_only", "kept_keep"
+};
+
+static const char *counterTitles[STATS_COUNTERS] = {
+  "Directories opened", "Entries read", "stat calls", "unlink calls",
+  "access calls", "Files removed", "Bytes removed",
+  "Not removed, .tex newer", "Not removed, no .tex",
+  "Not removed, read only", "Not removed, kept (-k)"
+};
+
+static const char *phaseNames[STATS_PHASES] = {
+  "scan", "classify", "examine", "delete"
+};
+
+static const char *histNames[STATS_HISTS] = {
+  "stat", "unlink"
+};
+
+Stats *statsOpen(void)
+{
+
+  /**
+   | Returns a new Stats, with all the counters at zero and no current
+   | phase; or 0 if out of memory.
+  **/
+
+  Stats *pS;
+
+  if ((pS = calloc(1, sizeof(Stats))) == 0) {
+    return 0;
+  }
+  pS->phase = STATS_NONE;
+  pS->start = statsClock();
+  return pS;
+}
+
+void statsAdd(
+  Stats  *pS,
+  int     counter,
+  double  n
+){
+  if (pS != 0) {
+    pS->counters[counter] += n;
+  }
+}
+
+int statsEnter(
+  Stats *pS,
+  int    phase
+){
+
+  /**
+   | Charges the time elapsed to the current phase, and enters "phase".
+   | Returns the phase left, to be entered again when "phase" is over.
+  **/
+
+  double now;
+  int    left;
+
+  if (pS == 0) {
+    return STATS_NONE;
+  }
+  now = statsClock();
+  if (pS->phase != STATS_NONE) {
+    pS->phases[pS->phase] += now - pS->since;
+  }
+  left      = pS->phase;
+  pS->phase = phase;
+  pS->since = now;
+  return left;
+}
+
+double statsClock(void)
+{
+
+  /**
+   | The monotonic clock, in nanoseconds.
+  **/
+
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void statsLatency(
+  Stats  *pS,
+  int     hist,
+  double  ns
+){
+
+  /**
+   | Records a call to "hist" that lasted "ns" nanoseconds.
+  **/
+
+  StatsHist *pH;
+  double     upper;
+  int        i;
+
+  if (pS == 0) {
+    return;
+  }
+  pH = &pS->hists[hist];
+  for (i = 0, upper = 2.0;   i < STATS_BUCKETS - 1 && ns >= upper;   i++) {
+    upper *= 2.0;
+  }
+  pH->buckets[i] += 1.0;
+  pH->count      += 1.0;
+  pH->total      += ns;
+  if (ns > pH->max) {
+    pH->max = ns;
+  }
+}
+
+void statsMerge(
+  Stats *pS,
+  Stats *pFrom
+){
+
+  /**
+   | Adds everything "pFrom" collected (its current phase included,
+   | up to now) to "pS".
+  **/
+
+  int i, j;
+
+  if (pS == 0 || pFrom == 0) {
+    return;
+  }
+  statsEnter(pFrom, pFrom->phase);
+
+  for (i = 0;   i < STATS_COUNTERS;   i++) {
+    pS->counters[i] += pFrom->counters[i];
+  }
+  for (i = 0;   i < STATS_PHASES;   i++) {
+    pS->phases[i] += pFrom->phases[i];
+  }
+  for (i = 0;   i < STATS_HISTS;   i++) {
+    StatsHist *pH = &pS->hists[i], *pF = &pFrom->hists[i];
+
+    pH->count += pF->count;
+    pH->total += pF->total;
+    if (pF->max > pH->max) {
+      pH->max = pF->max;
+    }
+    for (j = 0;   j < STATS_BUCKETS;   j++) {
+      pH->buckets[j] += pF->buckets[j];
+    }
+  }
+}
+
+void statsPrint(
+  Stats *pS,
+  FILE  *fp,
+  int    json
+){
+
+  /**
+   | Writes the statistics on "fp": as text, or as a single JSON object
+   | on one line if "json".  The times are in seconds in the text, in
+   | nanoseconds in JSON; a histogram bucket is written as its upper
+   | bound and count, and only if not empty.
+  **/
+
+  struct rusage ru;
+  double        wall, upper;
+  int           i, j;
+
+  if (pS == 0) {
+    return;
+  }
+  statsEnter(pS, pS->phase);
+  wall = statsClock() - pS->start;
+  if (getrusage(RUSAGE_SELF, &ru) != 0) {
+    ru.ru_maxrss = 0;
+  }
+
+  if (json) {
+    fprintf(fp, "{\"wall_ns\":%.0f,\"counters\":{", wall);
+    for (i = 0;   i < STATS_COUNTERS;   i++) {
+      fprintf(fp, "%s\"%s\":%.0f", i > 0 ? "," : "", counterNames[i],
+              pS->counters[i]);
+    }
+    fputs("},\"phases_ns\":{", fp);
+    for (i = 0;   i < STATS_PHASES;   i++) {
+      fprintf(fp, "%s\"%s\":%.0f", i > 0 ? "," : "", phaseNames[i],
+              pS->phases[i]);
+    }
+    fputs("},\"latency\":{", fp);
+    for (i = 0;   i < STATS_HISTS;   i++) {
+      StatsHist *pH = &pS->hists[i];
+      int        first = 1;
+
+      fprintf(fp, "%s\"%s\":{\"count\":%.0f,\"total_ns\":%.0f,"
+              "\"max_ns\":%.0f,\"buckets\":[", i > 0 ? "," : "",
+              histNames[i], pH->count, pH->total, pH->max);
+      for (j = 0, upper = 2.0;   j < STATS_BUCKETS;   j++, upper *= 2.0) {
+        if (pH->buckets[j] > 0.0) {
+          fprintf(fp, "%s{\"lt_ns\":%.0f,\"count\":%.0f}",
+                  first ? "" : ",", upper, pH->buckets[j]);
+          first = 0;
+        }
+      }
+      fputs("]}", fp);
+    }
+    fprintf(fp, "},\"peak_rss_kib\":%ld}\n", (long) ru.ru_maxrss);
+    return;
+  }
+
+  fputs("------------------------------Statistics\n", fp);
+  for (i = 0;   i < STATS_COUNTERS;   i++) {
+    fprintf(fp, "%-24s %12.0f\n", counterTitles[i], pS->counters[i]);
+  }
+  fprintf(fp, "%-24s %12.6f s\n", "Wall time", wall / 1e9);
+  for (i = 0;   i < STATS_PHASES;   i++) {
+    fprintf(fp, "  %-22s %12.6f s\n", phaseNames[i], pS->phases[i] / 1e9);
+  }
+  for (i = 0;   i < STATS_HISTS;   i++) {
+    StatsHist *pH = &pS->hists[i];
+
+    if (pH->count == 0.0) {
+      continue;
+    }
+    fprintf(fp, "Latency of %s: %.0f calls, mean %.0f ns, max %.0f ns\n",
+            histNames[i], pH->count, pH->total / pH->count, pH->max);
+    for (j = 0, upper = 2.0;   j < STATS_BUCKETS;   j++, upper *= 2.0) {
+      if (pH->buckets[j] > 0.0) {
+        fprintf(fp, "  < %12.0f ns %12.0f\n", upper, pH->buckets[j]);
+      }
+    }
+  }
+  fprintf(fp, "%-24s %12ld KiB\n", "Peak memory", (long) ru.ru_maxrss);
+}
+
+void statsClose(
+  Stats *pS
+){
+  free(pS);
+}
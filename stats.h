@@ -0,0 +1,85 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Run statistics (--stats).  A Stats collects:
+  - counters: the directories opened, the entries read, the stat,
+    unlink and access calls, the files removed and their bytes, and
+    the files not removed, for each reason;
+  - the time spent in each phase of the cleanup: reading the
+    directories and the file metadata (scan), classifying the files by
+    name (classify), comparing them with their .tex sources (examine)
+    and removing them (delete).  The time is charged to one phase at a
+    time: entering a phase leaves the current one;
+  - latency histograms of the stat and unlink calls, in power of two
+    buckets of nanoseconds.  For the calls served together through an
+    io_uring, the latency of each one is taken to be the time of the
+    whole batch;
+  - the peak memory (resident set size) of the process, when printed.
+  A Stats must be used by one thread at a time: every thread may have
+  its own, to be merged at the end (the phase times are then summed
+  over the threads, and may exceed the wall time).  All the functions
+  do nothing when given a null Stats, so that the callers need not
+  check.
+*/
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - the counters;
+ | - the phases (STATS_NONE: none of them, e.g. before starting);
+ | - the histograms, and STATS_BUCKETS the number of their buckets:
+ |   bucket "i" counts the latencies from 2^i up to 2^(i+1)
+ |   nanoseconds, the last one everything above.
+**/
+
+#define STATS_DIRS       0
+#define STATS_ENTRIES    1
+#define STATS_STATS      2
+#define STATS_UNLINKS    3
+#define STATS_ACCESS     4
+#define STATS_REMOVED    5
+#define STATS_BYTES      6
+#define STATS_TEX_NEWER  7
+#define STATS_NO_TEX     8
+#define STATS_READ_ONLY  9
+#define STATS_KEEP      10
+#define STATS_COUNTERS  11
+
+#define STATS_NONE     -1
+#define STATS_SCAN      0
+#define STATS_CLASSIFY  1
+#define STATS_EXAMINE   2
+#define STATS_DELETE    3
+#define STATS_PHASES    4
+
+#define STATS_STAT      0
+#define STATS_UNLINK    1
+#define STATS_HISTS     2
+#define STATS_BUCKETS  40
+
+typedef struct sStats Stats;
+
+Stats  *statsOpen(void);
+void    statsAdd(Stats *, int, double);
+int     statsEnter(Stats *, int);
+double  statsClock(void);
+void    statsLatency(Stats *, int, double);
+void    statsMerge(Stats *, Stats *);
+void    statsPrint(Stats *, FILE *, int);
+void    statsClose(Stats *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H_ */
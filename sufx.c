@@ -0,0 +1,237 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Suffix classifier: see sufx.h .  The vector kernels load the 16
+  bytes that end with the last character of a name: for names shorter
+  than that, the load starts in the DENTS_BEHIND bytes that precede it
+  in the reader buffer, and the lanes before the name are masked out.
+  Two bit masks come out of the kernel for every name (dots, and bytes
+  equal to the trailer aligned at the end); the rest is scalar.
+*/
+
+#include <string.h>
+
+#include "sufx.h"
+
+#if defined(__GNUC__) && !defined(NO_SIMD) && \
+    (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define HAVE_SSE2 1
+#include <emmintrin.h>
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+static void finish(const DentsEntry *, unsigned, unsigned, const char *,
+                   size_t, SufxInfo *);
+
+static void finish(
+  const DentsEntry *pE,
+  unsigned          dots,
+  unsigned          same,
+  const char       *trailer,
+  size_t            lTrailer,
+  SufxInfo         *pI
+){
+
+  /**
+   | Completes the result for "pE", given the masks of the dots and of
+   | the bytes matching the trailer among the last 16 of the name (bit
+   | 15 for the last character).  Names or trailers longer than that
+   | are finished by scalar code.
+  **/
+
+  size_t len = pE->len;
+
+  if (dots != 0) {
+    int high = 15;
+
+    while ((dots & (1U << high)) == 0) high--;
+    pI->lastDot = (int) len - 16 + high;
+  } else if (len > 16) {
+    const char *p = pE->name + len - 16;
+
+    while (p > pE->name && *--p != '.') ;
+    pI->lastDot = *p == '.' ? (int) (p - pE->name) : -1;
+  } else {
+    pI->lastDot = -1;
+  }
+
+  if (lTrailer == 0 || lTrailer > len) {
+    pI->backup = 0;
+  } else if (lTrailer <= 16) {
+    unsigned want = (0xFFFFU << (16 - lTrailer)) & 0xFFFFU;
+
+    pI->backup = (same & want) == want;
+  } else {
+    pI->backup = memcmp(pE->name + len - lTrailer, trailer, lTrailer) == 0;
+  }
+}
+
+#if !defined(HAVE_SSE2)
+
+static void classifyScalar(
+  const DentsEntry *ents,
+  size_t            n,
+  const char       *trailer,
+  size_t            lTrailer,
+  SufxInfo         *infos
+){
+  size_t i;
+
+  for (i = 0;   i < n;   i++) {
+    const char *end  = ents[i].name + ents[i].len;
+    size_t      k    = ents[i].len < 16 ? ents[i].len : 16;
+    unsigned    dots = 0, same = 0;
+    size_t      j;
+
+    for (j = 1;   j <= k;   j++) {
+      if (end[-(long) j] == '.') dots |= 1U << (16 - j);
+      if (j <= lTrailer && end[-(long) j] == trailer[lTrailer - j]) {
+        same |= 1U << (16 - j);
+      }
+    }
+    finish(&ents[i], dots, same, trailer, lTrailer, &infos[i]);
+  }
+}
+
+#else  /* HAVE_SSE2 */
+
+/**
+ | - valid(len): the lanes that belong to a name of length "len";
+ | - trailerVector: the trailer, aligned at the end of 16 bytes.
+**/
+
+static unsigned valid(
+  size_t len
+){
+  return len >= 16 ? 0xFFFFU : (0xFFFFU << (16 - len)) & 0xFFFFU;
+}
+
+static void trailerBytes(
+  const char *trailer,
+  size_t      lTrailer,
+  char       *tBuf
+){
+  memset(tBuf, 0, 16);
+  if (lTrailer > 0 && lTrailer <= 16) {
+    memcpy(tBuf + 16 - lTrailer, trailer, lTrailer);
+  }
+}
+
+static void classifySse2(
+  const DentsEntry *ents,
+  size_t            n,
+  const char       *trailer,
+  size_t            lTrailer,
+  SufxInfo         *infos
+){
+  char    tBuf[16];
+  __m128i dot, tv;
+  size_t  i;
+
+  trailerBytes(trailer, lTrailer, tBuf);
+  dot = _mm_set1_epi8('.');
+  tv  = _mm_loadu_si128((const __m128i *) tBuf);
+
+  for (i = 0;   i < n;   i++) {
+    const char *end = ents[i].name + ents[i].len;
+    __m128i     v   = _mm_loadu_si128((const __m128i *) (end - 16));
+    unsigned    ok  = valid(ents[i].len);
+    unsigned    dots, same;
+
+    dots = _mm_movemask_epi8(_mm_cmpeq_epi8(v, dot)) & ok;
+    same = _mm_movemask_epi8(_mm_cmpeq_epi8(v, tv))  & ok;
+    finish(&ents[i], dots, same, trailer, lTrailer, &infos[i]);
+  }
+}
+
+#if defined(HAVE_AVX2)
+
+__attribute__((target("avx2")))
+static void classifyAvx2(
+  const DentsEntry *ents,
+  size_t            n,
+  const char       *trailer,
+  size_t            lTrailer,
+  SufxInfo         *infos
+){
+
+  /**
+   | Two names at a time: one in each 128 bit lane.
+  **/
+
+  char    tBuf[16];
+  __m256i dot, tv;
+  size_t  i;
+
+  trailerBytes(trailer, lTrailer, tBuf);
+  dot = _mm256_set1_epi8('.');
+  tv  = _mm256_broadcastsi128_si256(
+          _mm_loadu_si128((const __m128i *) tBuf));
+
+  for (i = 0;   i + 1 < n;   i += 2) {
+    const char *end0 = ents[i].name     + ents[i].len;
+    const char *end1 = ents[i + 1].name + ents[i + 1].len;
+    __m256i     v;
+    unsigned    dots, same;
+
+    v = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(
+            _mm_loadu_si128((const __m128i *) (end0 - 16))),
+          _mm_loadu_si128((const __m128i *) (end1 - 16)), 1);
+    dots = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, dot));
+    same = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, tv));
+
+    finish(&ents[i], dots & valid(ents[i].len),
+           same & valid(ents[i].len), trailer, lTrailer, &infos[i]);
+    finish(&ents[i + 1], (dots >> 16) & valid(ents[i + 1].len),
+           (same >> 16) & valid(ents[i + 1].len), trailer, lTrailer,
+           &infos[i + 1]);
+  }
+
+  if (i < n) {
+    classifySse2(ents + i, n - i, trailer, lTrailer, infos + i);
+  }
+}
+
+#endif /* HAVE_AVX2 */
+#endif /* ! HAVE_SSE2 */
+
+void sufxClassify(
+  const DentsEntry *ents,
+  size_t            n,
+  const char       *trailer,
+  size_t            lTrailer,
+  SufxInfo         *infos
+){
+
+  /**
+   | Classifies the "n" entries in "ents", given the trailer of the
+   | backup files ("lTrailer" may be 0), filling "infos".
+  **/
+
+#if defined(HAVE_AVX2)
+  static int avx2 = -1;             /* Unknown yet: set by the first call */
+  int        has  = __atomic_load_n(&avx2, __ATOMIC_RELAXED);
+
+  if (has < 0) {
+    __builtin_cpu_init();
+    has = __builtin_cpu_supports("avx2") != 0;
+    __atomic_store_n(&avx2, has, __ATOMIC_RELAXED);
+  }
+  if (has) {
+    classifyAvx2(ents, n, trailer, lTrailer, infos);
+    return;
+  }
+#endif
+#if defined(HAVE_SSE2)
+  classifySse2(ents, n, trailer, lTrailer, infos);
+#else
+  classifyScalar(ents, n, trailer, lTrailer, infos);
+#endif
+}
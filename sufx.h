@@ -0,0 +1,44 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Suffix classifier.  A batch of directory entries, as returned by
+  dentsBatch(), is looked at in a single pass: for every name, the
+  position of the last dot, and whether it ends with the trailer of
+  the editor backup files.  On x86 processors the last 16 bytes of
+  each name are examined at once, with SSE2 or (two names at a time)
+  AVX2, chosen at run time; elsewhere, or if compiled with NO_SIMD, a
+  scalar loop does the same.
+*/
+
+#ifndef SUFX_H_
+#define SUFX_H_
+
+#include <stddef.h>
+
+#include "dents.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | Result for a name: "lastDot" is the position of its last dot, or
+ | -1; "backup" is set if the name ends with the trailer.
+**/
+
+typedef struct sSufxInfo {
+  int lastDot;
+  int backup;
+} SufxInfo;
+
+void sufxClassify(const DentsEntry *, size_t, const char *, size_t,
+                  SufxInfo *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUFX_H_ */
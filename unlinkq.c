@@ -0,0 +1,452 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Asynchronous deletion queue: see unlinkq.h .  The queue is a ring of
+  UQ_CAPACITY slots; three running counters split it into the removals
+  already claimed by a worker (from "head" to "next", some of them
+  maybe already done but not yet reported) and those waiting for a
+  worker (from "next" to "tail").  Only the thread that queues the
+  files reports them, so the callback is never called concurrently.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "unlinkq.h"
+#include "uring.h"
+
+/**
+ | - UQ_CAPACITY: number of removals that can be queued (or done and
+ |   not yet reported) before the scanning thread has to wait;
+ | - UQ_BATCH: number of removals claimed by a worker at a time, and
+ |   submitted together to its io_uring.
+**/
+
+#define UQ_CAPACITY 4096
+#define UQ_BATCH      64
+
+#define UQ_QUEUED  0
+#define UQ_CLAIMED 1
+#define UQ_DONE    2
+
+struct sUqDir {
+  int            fd;
+  unsigned long  refs;
+  char          *name;
+};
+
+typedef struct sUqItem {
+  UqDir *dir;
+  char  *name;
+  int    tag;
+  int    state;
+  int    err;
+  double ns;
+} UqItem;
+
+struct sUnlinkQ {
+  pthread_mutex_t  lock;
+  pthread_cond_t   work;          /* Signalled when files are queued */
+  pthread_cond_t   done;          /* Signalled when files are removed */
+  UqItem           items[UQ_CAPACITY];
+  unsigned long    head;
+  unsigned long    next;
+  unsigned long    tail;
+  int              stop;
+  int              nWorkers;
+  pthread_t       *workers;
+  int              useUring;
+  UqReport        *report;
+  void            *arg;
+  Stats           *stats;
+};
+
+static void  dropDir(UnlinkQ *, UqDir *);
+static void  flushDone(UnlinkQ *, int);
+static void *worker(void *);
+
+int removeAt(
+  int         dirFd,
+  const char *name
+){
+
+  /**
+   | Removes "name" from the directory open as "dirFd"; as remove(3)
+   | does, an empty directory is removed too.  Returns 0 or errno.
+  **/
+
+  if (unlinkat(dirFd, name, 0) == 0) return 0;
+  if (errno == EISDIR && unlinkat(dirFd, name, AT_REMOVEDIR) == 0) return 0;
+  return errno;
+}
+
+UnlinkQ *unlinkqOpen(
+  int       nWorkers,
+  int       useUring,
+  UqReport *report,
+  void     *arg
+){
+
+  /**
+   | Creates the queue and starts "nWorkers" threads; each of them will
+   | use its own io_uring, if "useUring" is set and the kernel allows.
+   | Returns 0 if the resources can't be obtained.
+  **/
+
+  UnlinkQ *pQ;
+  int      i;
+
+  if (nWorkers < 1) nWorkers = 1;
+
+  if ((pQ = calloc(1, sizeof(UnlinkQ))) == 0) {
+    return 0;
+  }
+  if ((pQ->workers = calloc(nWorkers, sizeof(pthread_t))) == 0) {
+    free(pQ);
+    return 0;
+  }
+
+  pthread_mutex_init(&pQ->lock, 0);
+  pthread_cond_init(&pQ->work, 0);
+  pthread_cond_init(&pQ->done, 0);
+  pQ->useUring = useUring;
+  pQ->report   = report;
+  pQ->arg      = arg;
+
+  for (i = 0;   i < nWorkers;   i++) {
+    if (pthread_create(&pQ->workers[i], 0, worker, pQ) != 0) break;
+  }
+  pQ->nWorkers = i;
+
+  if (i == 0) {
+    unlinkqClose(pQ);
+    return 0;
+  }
+  return pQ;
+}
+
+UqDir *unlinkqDir(
+  UnlinkQ    *pQ,
+  int         dirFd,
+  const char *dirName
+){
+
+  /**
+   | Registers the directory "dirName", open as "dirFd", duplicating
+   | its descriptor.  Returns 0 if the resources can't be obtained.
+  **/
+
+  UqDir *pD;
+
+  (void) pQ;
+
+  if ((pD = malloc(sizeof(UqDir))) == 0) {
+    return 0;
+  }
+  if ((pD->name = malloc(strlen(dirName) + 1)) == 0) {
+    free(pD);
+    return 0;
+  }
+  strcpy(pD->name, dirName);
+
+  if (dirFd == AT_FDCWD) {
+    pD->fd = AT_FDCWD;
+  } else if ((pD->fd = fcntl(dirFd, F_DUPFD_CLOEXEC, 0)) < 0) {
+    free(pD->name);
+    free(pD);
+    return 0;
+  }
+
+  pD->refs = 1;
+  return pD;
+}
+
+static void dropDir(
+  UnlinkQ *pQ,
+  UqDir   *pD
+){
+  unsigned long refs;
+
+  pthread_mutex_lock(&pQ->lock);
+  refs = --pD->refs;
+  pthread_mutex_unlock(&pQ->lock);
+
+  if (refs == 0) {
+    if (pD->fd != AT_FDCWD) close(pD->fd);
+    free(pD->name);
+    free(pD);
+  }
+}
+
+void unlinkqRelease(
+  UnlinkQ *pQ,
+  UqDir   *pD
+){
+
+  /**
+   | The caller won't queue any more files from "pD": the directory is
+   | closed when the last of its queued files has been reported.
+  **/
+
+  dropDir(pQ, pD);
+}
+
+int unlinkqPut(
+  UnlinkQ    *pQ,
+  UqDir      *pD,
+  const char *name,
+  int         tag
+){
+
+  /**
+   | Queues the removal of "name" from "pD", waiting if the queue is
+   | full; the removals already done are reported in the meantime.
+   | "tag" is handed back, untouched, to the callback.  Returns -1 if
+   | out of memory.
+  **/
+
+  UqItem *pI;
+  char   *copy;
+
+  if ((copy = malloc(strlen(name) + 1)) == 0) {
+    return -1;
+  }
+  strcpy(copy, name);
+
+  flushDone(pQ, 0);
+
+  pthread_mutex_lock(&pQ->lock);
+  while (pQ->tail - pQ->head == UQ_CAPACITY) {
+    if (pQ->items[pQ->head % UQ_CAPACITY].state == UQ_DONE) {
+      pthread_mutex_unlock(&pQ->lock);
+      flushDone(pQ, 0);
+      pthread_mutex_lock(&pQ->lock);
+    } else {
+      pthread_cond_wait(&pQ->done, &pQ->lock);
+    }
+  }
+
+  pI = &pQ->items[pQ->tail % UQ_CAPACITY];
+  pI->dir   = pD;
+  pI->name  = copy;
+  pI->tag   = tag;
+  pI->state = UQ_QUEUED;
+  pI->err   = 0;
+  pD->refs++;
+  pQ->tail++;
+
+  pthread_cond_signal(&pQ->work);
+  pthread_mutex_unlock(&pQ->lock);
+  return 0;
+}
+
+void unlinkqDrain(
+  UnlinkQ *pQ
+){
+
+  /**
+   | Waits until every queued file has been removed, and reports all
+   | of them.
+  **/
+
+  flushDone(pQ, 1);
+}
+
+void unlinkqStats(
+  UnlinkQ *pQ,
+  Stats   *pS
+){
+
+  /**
+   | From now on, the unlink calls are counted (and timed) in "pS", as
+   | they are reported.
+  **/
+
+  pQ->stats = pS;
+}
+
+static void flushDone(
+  UnlinkQ *pQ,
+  int      wait
+){
+
+  /**
+   | Reports, in order, the removals already done; if "wait" is set,
+   | waits for all the queued ones.
+  **/
+
+  for (;;) {
+    UqItem item;
+
+    pthread_mutex_lock(&pQ->lock);
+    if (pQ->head == pQ->tail) {
+      pthread_mutex_unlock(&pQ->lock);
+      return;
+    }
+    while (wait && pQ->items[pQ->head % UQ_CAPACITY].state != UQ_DONE) {
+      pthread_cond_wait(&pQ->done, &pQ->lock);
+    }
+    item = pQ->items[pQ->head % UQ_CAPACITY];
+    if (item.state != UQ_DONE) {
+      pthread_mutex_unlock(&pQ->lock);
+      return;
+    }
+    pQ->head++;
+    pthread_cond_broadcast(&pQ->done);      /* Room for unlinkqPut() */
+    pthread_mutex_unlock(&pQ->lock);
+
+    statsAdd(pQ->stats, STATS_UNLINKS, 1.0);
+    statsLatency(pQ->stats, STATS_UNLINK, item.ns);
+    pQ->report(pQ->arg, item.dir->name, item.name, item.tag, item.err);
+    free(item.name);
+    dropDir(pQ, item.dir);
+  }
+}
+
+static void *worker(
+  void *arg
+){
+
+  /**
+   | A worker thread: claims up to UQ_BATCH queued removals at a time,
+   | and performs them (all together, through its io_uring, if any).
+  **/
+
+  UnlinkQ *pQ   = arg;
+  Uring   *ring = 0;
+  UringOp  ops[UQ_BATCH];
+  double   ns[UQ_BATCH];
+
+  if (pQ->useUring) {
+    ring = uringOpen(UQ_BATCH);
+    if (ring != 0 && !uringSupports(ring, URING_UNLINKAT)) {
+      uringClose(ring);
+      ring = 0;
+    }
+  }
+
+  for (;;) {
+    unsigned long first, n, i;
+    int           failed = 0;
+
+    pthread_mutex_lock(&pQ->lock);
+    while (!pQ->stop && pQ->next == pQ->tail) {
+      pthread_cond_wait(&pQ->work, &pQ->lock);
+    }
+    if (pQ->next == pQ->tail) {
+      pthread_mutex_unlock(&pQ->lock);
+      break;
+    }
+
+    first = pQ->next;
+    n     = pQ->tail - first;
+    if (n > UQ_BATCH) n = UQ_BATCH;
+    for (i = 0;   i < n;   i++) {
+      UqItem *pI = &pQ->items[(first + i) % UQ_CAPACITY];
+
+      pI->state     = UQ_CLAIMED;
+      ops[i].op     = URING_UNLINKAT;
+      ops[i].dirFd  = pI->dir->fd;
+      ops[i].name   = pI->name;
+      ops[i].flags  = 0;
+      ops[i].mask   = 0;
+      ops[i].buf    = 0;
+      ops[i].result = URING_PENDING;
+    }
+    pQ->next += n;
+    pthread_mutex_unlock(&pQ->lock);
+
+    /**
+     | The claimed slots can't be reused before they are marked done,
+     | so they can be read here without holding the lock.  Directories
+     | (-EISDIR) and whatever the ring could not do are handled by the
+     | synchronous call; after a failure of the ring, a removal it may
+     | have done after all (-ECANCELED) is tried again too, and a file
+     | no longer there is not an error.  Every removal is timed: those
+     | done through the ring take as long as the whole batch.
+    **/
+
+    if (ring != 0) {
+      double t0 = statsClock(), batch;
+
+      if (uringRun(ring, ops, n) != 0) {
+        uringClose(ring);
+        ring   = 0;
+        failed = 1;
+      }
+      batch = statsClock() - t0;
+      for (i = 0;   i < n;   i++) {
+        ns[i] = batch;
+      }
+    }
+
+    for (i = 0;   i < n;   i++) {
+      int retry = failed && (ops[i].result == URING_PENDING ||
+                             ops[i].result == -ECANCELED);
+
+      if (retry || ops[i].result == URING_PENDING ||
+          ops[i].result == -EISDIR) {
+        double t0 = statsClock();
+
+        ops[i].result = -removeAt(ops[i].dirFd, ops[i].name);
+        ns[i]         = statsClock() - t0;
+        if (retry && ops[i].result == -ENOENT) {
+          ops[i].result = 0;
+        }
+      }
+    }
+
+    pthread_mutex_lock(&pQ->lock);
+    for (i = 0;   i < n;   i++) {
+      UqItem *pI = &pQ->items[(first + i) % UQ_CAPACITY];
+
+      pI->err   = -ops[i].result;
+      pI->ns    = ns[i];
+      pI->state = UQ_DONE;
+    }
+    pthread_cond_broadcast(&pQ->done);
+    pthread_mutex_unlock(&pQ->lock);
+  }
+
+  uringClose(ring);
+  return 0;
+}
+
+void unlinkqClose(
+  UnlinkQ *pQ
+){
+
+  /**
+   | Drains the queue, stops the workers and frees everything.
+  **/
+
+  int i;
+
+  if (pQ == 0) return;
+
+  flushDone(pQ, 1);
+
+  pthread_mutex_lock(&pQ->lock);
+  pQ->stop = 1;
+  pthread_cond_broadcast(&pQ->work);
+  pthread_mutex_unlock(&pQ->lock);
+
+  for (i = 0;   i < pQ->nWorkers;   i++) {
+    pthread_join(pQ->workers[i], 0);
+  }
+
+  pthread_cond_destroy(&pQ->done);
+  pthread_cond_destroy(&pQ->work);
+  pthread_mutex_destroy(&pQ->lock);
+  free(pQ->workers);
+  free(pQ);
+}
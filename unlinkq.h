@@ -0,0 +1,55 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Asynchronous deletion queue.  The scanning thread puts the files to
+  be removed in a bounded queue, and goes on with its work while one
+  or more worker threads call unlinkat(2) (or, with an io_uring,
+  submit batches of IORING_OP_UNLINKAT).  The outcome of every removal
+  is handed back to the scanning thread, through a callback, in the
+  same order in which the files were queued: when further files are
+  queued, and when the queue is drained.
+*/
+
+#ifndef UNLINKQ_H_
+#define UNLINKQ_H_
+
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - UnlinkQ: the queue;
+ | - UqDir: a directory where files are removed from.  It holds its
+ |   own duplicate of the directory file descriptor (or AT_FDCWD, for
+ |   names relative to the current directory), so that the caller may
+ |   close its descriptor as soon as it has finished with it;
+ | - UqReport: the callback, that receives the directory name, the
+ |   file name, the tag given when the file was queued and 0 or the
+ |   errno value of the failed removal.
+**/
+
+typedef struct sUnlinkQ UnlinkQ;
+typedef struct sUqDir   UqDir;
+
+typedef void UqReport(void *, const char *, const char *, int, int);
+
+UnlinkQ *unlinkqOpen(int, int, UqReport *, void *);
+UqDir   *unlinkqDir(UnlinkQ *, int, const char *);
+int      unlinkqPut(UnlinkQ *, UqDir *, const char *, int);
+void     unlinkqRelease(UnlinkQ *, UqDir *);
+void     unlinkqDrain(UnlinkQ *);
+void     unlinkqStats(UnlinkQ *, Stats *);
+void     unlinkqClose(UnlinkQ *);
+
+int      removeAt(int, const char *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNLINKQ_H_ */
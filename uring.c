@@ -0,0 +1,387 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Raw io_uring support: see uring.h .  The ring is driven by a single
+  thread; the memory ordering between our side and the kernel side is
+  enforced with the GCC __atomic builtins on the ring head and tail.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "uring.h"
+
+#if defined(__linux__) && !defined(NO_URING)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup)
+#define HAVE_URING 1
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if defined(HAVE_URING)
+
+/**
+ | The ring: pointers into the three shared memory areas (submission
+ | queue ring, completion queue ring, submission queue entries), and
+ | the operations that the kernel says to support.
+**/
+
+struct sUring {
+  int                   fd;
+  unsigned             *sqHead;
+  unsigned             *sqTail;
+  unsigned              sqMask;
+  unsigned              sqEntries;
+  unsigned             *sqArray;
+  struct io_uring_sqe  *sqes;
+  unsigned             *cqHead;
+  unsigned             *cqTail;
+  unsigned              cqMask;
+  struct io_uring_cqe  *cqes;
+  void                 *sqRing;
+  size_t                sqRingSize;
+  void                 *cqRing;
+  size_t                cqRingSize;
+  size_t                sqesSize;
+  int                   hasStatx;
+  int                   hasOpenat;
+  int                   hasUnlinkat;
+};
+
+static void   drain(Uring *, UringOp *, unsigned long, unsigned);
+static unsigned long reap(Uring *, UringOp *);
+
+static void probeOps(
+  Uring *pR
+){
+
+  /**
+   | Asks the kernel which operations are supported; kernels without
+   | IORING_REGISTER_PROBE also lack the operations we need.
+  **/
+
+  struct io_uring_probe *probe;
+  size_t                 size;
+  unsigned               i;
+
+  size = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+  if ((probe = calloc(1, size)) == 0) return;
+
+  if (syscall(__NR_io_uring_register, pR->fd, IORING_REGISTER_PROBE,
+              probe, 256) == 0) {
+    for (i = 0;   i < probe->ops_len;   i++) {
+      if ((probe->ops[i].flags & IO_URING_OP_SUPPORTED) == 0) continue;
+      switch (probe->ops[i].op) {
+        case IORING_OP_STATX:     pR->hasStatx    = 1;   break;
+        case IORING_OP_OPENAT:    pR->hasOpenat   = 1;   break;
+        case IORING_OP_UNLINKAT:  pR->hasUnlinkat = 1;   break;
+      }
+    }
+  }
+
+  free(probe);
+}
+
+Uring *uringOpen(
+  unsigned entries
+){
+
+  /**
+   | Sets up a ring with (at least) "entries" submission slots; returns
+   | 0 if the kernel does not support io_uring (or forbids it).
+  **/
+
+  struct io_uring_params  params;
+  Uring                  *pR;
+  char                   *sq, *cq;
+  int                     fd;
+
+  memset(&params, 0, sizeof(params));
+  if ((fd = syscall(__NR_io_uring_setup, entries, &params)) < 0) {
+    return 0;
+  }
+
+  if ((pR = calloc(1, sizeof(Uring))) == 0) {
+    close(fd);
+    return 0;
+  }
+  pR->fd = fd;
+
+  pR->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  pR->cqRingSize = params.cq_off.cqes +
+                   params.cq_entries * sizeof(struct io_uring_cqe);
+  pR->sqesSize   = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (pR->cqRingSize > pR->sqRingSize) pR->sqRingSize = pR->cqRingSize;
+    pR->cqRingSize = pR->sqRingSize;
+  }
+
+  pR->sqRing = mmap(0, pR->sqRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (pR->sqRing == MAP_FAILED) {
+    close(fd);
+    free(pR);
+    return 0;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    pR->cqRing = pR->sqRing;
+  } else {
+    pR->cqRing = mmap(0, pR->cqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (pR->cqRing == MAP_FAILED) {
+      munmap(pR->sqRing, pR->sqRingSize);
+      close(fd);
+      free(pR);
+      return 0;
+    }
+  }
+
+  pR->sqes = mmap(0, pR->sqesSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (pR->sqes == MAP_FAILED) {
+    if (pR->cqRing != pR->sqRing) munmap(pR->cqRing, pR->cqRingSize);
+    munmap(pR->sqRing, pR->sqRingSize);
+    close(fd);
+    free(pR);
+    return 0;
+  }
+
+  sq = pR->sqRing;
+  cq = pR->cqRing;
+  pR->sqHead    = (unsigned *) (sq + params.sq_off.head);
+  pR->sqTail    = (unsigned *) (sq + params.sq_off.tail);
+  pR->sqMask    = *(unsigned *) (sq + params.sq_off.ring_mask);
+  pR->sqEntries = *(unsigned *) (sq + params.sq_off.ring_entries);
+  pR->sqArray   = (unsigned *) (sq + params.sq_off.array);
+  pR->cqHead    = (unsigned *) (cq + params.cq_off.head);
+  pR->cqTail    = (unsigned *) (cq + params.cq_off.tail);
+  pR->cqMask    = *(unsigned *) (cq + params.cq_off.ring_mask);
+  pR->cqes      = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+  probeOps(pR);
+  return pR;
+}
+
+int uringSupports(
+  Uring *pR,
+  int    op
+){
+  if (pR == 0) return 0;
+
+  switch (op) {
+    case URING_STATX:     return pR->hasStatx;
+    case URING_OPENAT:    return pR->hasOpenat;
+    case URING_UNLINKAT:  return pR->hasUnlinkat;
+  }
+  return 0;
+}
+
+static void prepare(
+  struct io_uring_sqe *sqe,
+  UringOp             *pOp
+){
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd   = pOp->dirFd;
+  sqe->addr = (unsigned long) pOp->name;
+
+  switch (pOp->op) {
+    case URING_STATX:
+      sqe->opcode      = IORING_OP_STATX;
+      sqe->len         = pOp->mask;
+      sqe->off         = (unsigned long) pOp->buf;
+      sqe->statx_flags = pOp->flags;
+      break;
+
+    case URING_OPENAT:
+      sqe->opcode     = IORING_OP_OPENAT;
+      sqe->len        = pOp->mask;              /* The creation mode */
+      sqe->open_flags = pOp->flags;
+      break;
+
+    case URING_UNLINKAT:
+      sqe->opcode       = IORING_OP_UNLINKAT;
+      sqe->unlink_flags = pOp->flags;
+      break;
+  }
+}
+
+int uringRun(
+  Uring         *pR,
+  UringOp       *ops,
+  unsigned long  nOps
+){
+
+  /**
+   | Submits the "nOps" operations in "ops", keeping the submission
+   | queue as full as possible, and waits for all of them.  Returns 0
+   | on success; -1 if the ring failed, in which case the operations
+   | not submitted still have their result set to URING_PENDING, and
+   | may be carried out otherwise: those already submitted are waited
+   | for first (see drain()).  The ring should not be used any more.
+  **/
+
+  unsigned long next = 0, done = 0, i;
+  unsigned      toSubmit = 0, inFlight = 0;
+
+  for (i = 0;   i < nOps;   i++) {
+    ops[i].result = URING_PENDING;
+  }
+
+  while (done < nOps) {
+    unsigned      tail = *pR->sqTail;
+    unsigned long n;
+    int           ret;
+
+    while (next < nOps && inFlight + toSubmit < pR->sqEntries) {
+      unsigned             idx = tail & pR->sqMask;
+      struct io_uring_sqe *sqe = &pR->sqes[idx];
+
+      prepare(sqe, &ops[next]);
+      sqe->user_data   = next;
+      pR->sqArray[idx] = idx;
+      tail++;
+      next++;
+      toSubmit++;
+    }
+    __atomic_store_n(pR->sqTail, tail, __ATOMIC_RELEASE);
+
+    ret = syscall(__NR_io_uring_enter, pR->fd, toSubmit, 1,
+                  IORING_ENTER_GETEVENTS, (void *) 0, 0);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      drain(pR, ops, next - toSubmit, inFlight);
+      return -1;
+    }
+    toSubmit -= ret;
+    inFlight += ret;
+
+    n         = reap(pR, ops);
+    inFlight -= n;
+    done     += n;
+  }
+
+  return 0;
+}
+
+static unsigned long reap(
+  Uring   *pR,
+  UringOp *ops
+){
+
+  /**
+   | Collects the completions arrived, setting the results of their
+   | operations; returns how many they were.
+  **/
+
+  unsigned      head = *pR->cqHead;
+  unsigned long n    = 0;
+
+  while (head != __atomic_load_n(pR->cqTail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe *cqe = &pR->cqes[head & pR->cqMask];
+
+    ops[cqe->user_data].result = cqe->res;
+    head++;
+    n++;
+  }
+  __atomic_store_n(pR->cqHead, head, __ATOMIC_RELEASE);
+  return n;
+}
+
+static void drain(
+  Uring         *pR,
+  UringOp       *ops,
+  unsigned long  nSubmitted,
+  unsigned       inFlight
+){
+
+  /**
+   | After a failure of the ring, waits for the operations still in
+   | flight, among the first "nSubmitted" ones: until they complete,
+   | the kernel may still write into their buffers (and an open would
+   | leave a descriptor behind).  If even waiting fails, those not
+   | completed are given -ECANCELED, so that they are not done twice.
+  **/
+
+  unsigned long i;
+
+  while (inFlight > 0) {
+    unsigned long n = reap(pR, ops);
+
+    inFlight -= n;
+    if (n > 0 || inFlight == 0) continue;
+    if (syscall(__NR_io_uring_enter, pR->fd, 0, 1, IORING_ENTER_GETEVENTS,
+                (void *) 0, 0) < 0 && errno != EINTR) {
+      break;
+    }
+  }
+
+  for (i = 0;   i < nSubmitted;   i++) {
+    if (ops[i].result == URING_PENDING) {
+      ops[i].result = -ECANCELED;
+    }
+  }
+}
+
+void uringClose(
+  Uring *pR
+){
+  if (pR == 0) return;
+
+  munmap(pR->sqes, pR->sqesSize);
+  if (pR->cqRing != pR->sqRing) munmap(pR->cqRing, pR->cqRingSize);
+  munmap(pR->sqRing, pR->sqRingSize);
+  close(pR->fd);
+  free(pR);
+}
+
+#else  /* ! HAVE_URING */
+
+struct sUring {
+  int fd;
+};
+
+Uring *uringOpen(
+  unsigned entries
+){
+  (void) entries;
+  return 0;
+}
+
+int uringSupports(
+  Uring *pR,
+  int    op
+){
+  (void) pR;
+  (void) op;
+  return 0;
+}
+
+int uringRun(
+  Uring         *pR,
+  UringOp       *ops,
+  unsigned long  nOps
+){
+  (void) pR;
+  (void) ops;
+  (void) nOps;
+  return -1;
+}
+
+void uringClose(
+  Uring *pR
+){
+  (void) pR;
+}
+
+#endif /* HAVE_URING */
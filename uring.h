@@ -0,0 +1,57 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  A minimal interface to the Linux io_uring, through the raw system
+  calls (no liburing is needed): a batch of file system operations,
+  all relative to directory file descriptors, is submitted to the
+  kernel as a whole and the results are collected as they complete.
+  Elsewhere uringOpen() just returns a NULL pointer.
+*/
+
+#ifndef URING_H_
+#define URING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | Operations: URING_STATX fills the struct statx pointed to by "buf",
+ | asking for the fields in "mask"; URING_OPENAT opens "name" with the
+ | given "flags"; URING_UNLINKAT removes it.  "result" is set as for
+ | the corresponding system call, but with -errno in case of error;
+ | it is left to URING_PENDING if the operation could not be carried
+ | out by the kernel ring.
+**/
+
+#define URING_STATX    1
+#define URING_OPENAT   2
+#define URING_UNLINKAT 3
+
+#define URING_PENDING  (-0x7fffffff - 1)
+
+typedef struct sUringOp {
+  int          op;
+  int          dirFd;
+  const char  *name;
+  int          flags;
+  unsigned     mask;
+  void        *buf;
+  int          result;
+} UringOp;
+
+typedef struct sUring Uring;
+
+Uring *uringOpen(unsigned);
+int    uringSupports(Uring *, int);
+int    uringRun(Uring *, UringOp *, unsigned long);
+void   uringClose(Uring *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* URING_H_ */
@@ -0,0 +1,163 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Set of the visited directories: see visited.h .  An open addressing
+  hash table, with linear probing, doubled when half full; every call
+  holds the lock for the lookup alone.
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "visited.h"
+
+/**
+ | - VISITED_SIZE: initial number of slots (a power of two);
+ | - VisitedSlot: a directory, "used" if the slot holds one;
+ | - Visited: the "size" slots, "n" of them used.
+**/
+
+#define VISITED_SIZE 256
+
+typedef struct sVisitedSlot {
+  dev_t dev;
+  ino_t ino;
+  int   used;
+} VisitedSlot;
+
+struct sVisited {
+  pthread_mutex_t  lock;
+  VisitedSlot     *slots;
+  size_t           size;
+  size_t           n;
+};
+
+static unsigned long hashId(dev_t, ino_t);
+static VisitedSlot  *lookUp(VisitedSlot *, size_t, dev_t, ino_t);
+
+Visited *visitedOpen(void)
+{
+
+  /**
+   | Returns an empty set, or 0 if out of memory.
+  **/
+
+  Visited *pV;
+
+  if ((pV = calloc(1, sizeof(Visited))) == 0) {
+    return 0;
+  }
+  if ((pV->slots = calloc(VISITED_SIZE, sizeof(VisitedSlot))) == 0) {
+    free(pV);
+    return 0;
+  }
+  pV->size = VISITED_SIZE;
+  pthread_mutex_init(&pV->lock, 0);
+  return pV;
+}
+
+int visitedAdd(
+  Visited *pV,
+  dev_t    dev,
+  ino_t    ino
+){
+  VisitedSlot *pS;
+  int          result = 1;
+
+  pthread_mutex_lock(&pV->lock);
+
+  if (2 * (pV->n + 1) > pV->size) {
+    size_t       size = 2 * pV->size, i;
+    VisitedSlot *slots;
+
+    if ((slots = calloc(size, sizeof(VisitedSlot))) == 0) {
+      pthread_mutex_unlock(&pV->lock);
+      return -1;
+    }
+    for (i = 0;   i < pV->size;   i++) {
+      if (pV->slots[i].used) {
+        *lookUp(slots, size, pV->slots[i].dev, pV->slots[i].ino) =
+          pV->slots[i];
+      }
+    }
+    free(pV->slots);
+    pV->slots = slots;
+    pV->size  = size;
+  }
+
+  pS = lookUp(pV->slots, pV->size, dev, ino);
+  if (pS->used) {
+    result = 0;
+  } else {
+    pS->dev  = dev;
+    pS->ino  = ino;
+    pS->used = 1;
+    pV->n++;
+  }
+
+  pthread_mutex_unlock(&pV->lock);
+  return result;
+}
+
+void visitedClear(
+  Visited *pV
+){
+  size_t i;
+
+  pthread_mutex_lock(&pV->lock);
+  for (i = 0;   i < pV->size;   i++) {
+    pV->slots[i].used = 0;
+  }
+  pV->n = 0;
+  pthread_mutex_unlock(&pV->lock);
+}
+
+void visitedClose(
+  Visited *pV
+){
+  if (pV == 0) return;
+  pthread_mutex_destroy(&pV->lock);
+  free(pV->slots);
+  free(pV);
+}
+
+static VisitedSlot *lookUp(
+  VisitedSlot *slots,
+  size_t       size,
+  dev_t        dev,
+  ino_t        ino
+){
+
+  /**
+   | The slot of the directory (dev, ino) among the "size" ones in
+   | "slots": where it is, or the free one where it would be put.
+  **/
+
+  size_t i = hashId(dev, ino) & (size - 1);
+
+  while (slots[i].used && (slots[i].dev != dev || slots[i].ino != ino)) {
+    i = (i + 1) & (size - 1);
+  }
+  return &slots[i];
+}
+
+static unsigned long hashId(
+  dev_t dev,
+  ino_t ino
+){
+
+  /**
+   | Mixes the device and inode numbers: the inodes of a directory tree
+   | are often consecutive, and the low bits have to spread.
+  **/
+
+  unsigned long h = (unsigned long) ino ^ ((unsigned long) dev * 0x9e3779b1UL);
+
+  h ^= h >> 16;
+  h *= 0x85ebca6bUL;
+  h ^= h >> 13;
+  return h;
+}
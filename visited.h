@@ -0,0 +1,39 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Set of the directories already visited, known by device and inode
+  number: a directory reached again, through a symbolic link, a bind
+  mount or overlapping targets, is recognized whatever its name, and
+  loops are cut.  A Visited may be shared by any number of threads.
+*/
+
+#ifndef VISITED_H_
+#define VISITED_H_
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - visitedAdd() records a directory: it returns 1 if it was not yet
+ |   recorded, 0 if it was, -1 if out of memory;
+ | - visitedClear() forgets all the directories recorded.
+**/
+
+typedef struct sVisited Visited;
+
+Visited *visitedOpen(void);
+int      visitedAdd(Visited *, dev_t, ino_t);
+void     visitedClear(Visited *);
+void     visitedClose(Visited *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VISITED_H_ */
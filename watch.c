@@ -0,0 +1,421 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Watch mode: see watch.h .  A Watch must be used by one thread at a
+  time; the callbacks are called from watchRun().
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "watch.h"
+
+#if defined(__linux__) && !defined(NO_INOTIFY)
+
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+/**
+ | - WATCH_MASK: the events watched for;
+ | - WATCH_EVENTS: size of the buffer the events are read into.
+**/
+
+#define WATCH_MASK   (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR)
+#define WATCH_EVENTS 65536
+
+/**
+ | - fd: the inotify instance;
+ | - settle: how long (in milliseconds) a directory must be quiet
+ |   before it is cleaned; "recursive": whether the subdirectories are
+ |   watched too;
+ | - paths, due: indexed by watch descriptor, the path of the directory
+ |   (0 if not watched) and, if dirty, when it is to be cleaned;
+ | - dirty: the watch descriptors of the dirty directories.
+**/
+
+struct sWatch {
+  int            fd;
+  unsigned long  settle;
+  int            recursive;
+  WatchName     *name;
+  WatchDir      *dir;
+  void          *arg;
+
+  char         **paths;
+  long          *due;
+  size_t         nPaths;
+  int           *dirty;
+  size_t         nDirty;
+  size_t         mDirty;
+};
+
+static int   addTree(Watch *, const char *, int);
+static void  markDirty(Watch *, int, long);
+static long  msNow(void);
+static char *joinPath(const char *, const char *);
+
+Watch *watchOpen(
+  unsigned long  settle,
+  int            recursive,
+  WatchName     *name,
+  WatchDir      *dir,
+  void          *arg
+){
+
+  /**
+   | Creates an empty set of watched directories: the directories will
+   | be cleaned by "dir" after "settle" milliseconds without changes to
+   | the files accepted by "name" (all of them, if 0).  Returns 0 (with
+   | errno set) on failure.
+  **/
+
+  Watch *pW;
+
+  if ((pW = calloc(1, sizeof(Watch))) == 0) {
+    return 0;
+  }
+  if ((pW->fd = inotify_init1(IN_CLOEXEC)) < 0) {
+    free(pW);
+    return 0;
+  }
+  pW->settle    = settle;
+  pW->recursive = recursive;
+  pW->name      = name;
+  pW->dir       = dir;
+  pW->arg       = arg;
+  return pW;
+}
+
+int watchAdd(
+  Watch      *pW,
+  const char *path
+){
+
+  /**
+   | Watches the directory "path" (and its subdirectories, if so
+   | required).  Returns 0, or -1 (with errno set) if some directory
+   | could not be watched: the others are.
+  **/
+
+  return addTree(pW, path, 0);
+}
+
+static int addTree(
+  Watch      *pW,
+  const char *path,
+  int         dirty
+){
+
+  /**
+   | Watches "path" and, if recursive, its subdirectories (symbolic
+   | links are not followed); if "dirty", they are all marked dirty, as
+   | they may have been filled before being watched.
+  **/
+
+  DIR           *pD;
+  struct dirent *pE;
+  int            wd, ret = 0, err = 0;
+
+  if ((wd = inotify_add_watch(pW->fd, path, WATCH_MASK)) < 0) {
+    return -1;
+  }
+
+  if ((size_t) wd >= pW->nPaths) {
+    size_t   n = 2 * (size_t) wd + 16;
+    char   **p = realloc(pW->paths, n * sizeof(char *));
+    long    *d;
+
+    if (p == 0) {
+      errno = ENOMEM;
+      return -1;
+    }
+    pW->paths = p;
+    if ((d = realloc(pW->due, n * sizeof(long))) == 0) {
+      errno = ENOMEM;
+      return -1;
+    }
+    pW->due = d;
+    memset(pW->paths + pW->nPaths, 0, (n - pW->nPaths) * sizeof(char *));
+    memset(pW->due + pW->nPaths, 0, (n - pW->nPaths) * sizeof(long));
+    pW->nPaths = n;
+  }
+
+  if (pW->paths[wd] != 0) {
+    return 0;                   /* Already watched, through another path */
+  }
+  if ((pW->paths[wd] = joinPath(path, 0)) == 0) {
+    errno = ENOMEM;
+    return -1;
+  }
+  if (dirty) {
+    markDirty(pW, wd, msNow());
+  }
+
+  if (!pW->recursive || (pD = opendir(path)) == 0) {
+    return 0;
+  }
+  while ((pE = readdir(pD)) != 0) {
+    char        *sub;
+    struct stat  st;
+
+    if (strcmp(pE->d_name, ".") == 0 || strcmp(pE->d_name, "..") == 0) {
+      continue;
+    }
+    if (pE->d_type != DT_DIR && pE->d_type != DT_UNKNOWN) {
+      continue;
+    }
+    if ((sub = joinPath(path, pE->d_name)) == 0) {
+      ret = -1;
+      err = ENOMEM;
+      continue;
+    }
+    if (pE->d_type == DT_DIR ||
+        (lstat(sub, &st) == 0 && S_ISDIR(st.st_mode))) {
+      if (addTree(pW, sub, dirty) != 0) {
+        ret = -1;
+        err = errno;
+      }
+    }
+    free(sub);
+  }
+  closedir(pD);
+
+  errno = err;
+  return ret;
+}
+
+int watchRun(
+  Watch *pW
+){
+
+  /**
+   | Waits for the events, and cleans the dirty directories when they
+   | have been quiet long enough.  Returns 0 when interrupted by a
+   | signal, -1 (with errno set) on failure.
+  **/
+
+  union {
+    struct inotify_event event;
+    char                 buf[WATCH_EVENTS];
+  } u;
+
+  for (;;) {
+    struct pollfd  pfd;
+    long           now = msNow(), first = -1;
+    size_t         i;
+    int            n;
+
+    /**
+     | Cleans the directories whose time has come; the others tell how
+     | long to wait.
+    **/
+
+    for (i = 0;   i < pW->nDirty;   ) {
+      int wd = pW->dirty[i];
+
+      if (pW->paths[wd] == 0) {
+        pW->dirty[i] = pW->dirty[--pW->nDirty];
+      } else if (pW->due[wd] <= now) {
+        pW->dirty[i] = pW->dirty[--pW->nDirty];
+        pW->due[wd]  = 0;
+        pW->dir(pW->arg, pW->paths[wd]);
+      } else {
+        if (first < 0 || pW->due[wd] < first) {
+          first = pW->due[wd];
+        }
+        i++;
+      }
+    }
+
+    pfd.fd     = pW->fd;
+    pfd.events = POLLIN;
+    if ((n = poll(&pfd, 1, first < 0 ? -1 : (int) (first - now))) < 0) {
+      return errno == EINTR ? 0 : -1;
+    }
+    if (n == 0) {
+      continue;
+    }
+
+    if ((n = read(pW->fd, u.buf, sizeof(u.buf))) < 0) {
+      if (errno == EINTR) {
+        return 0;
+      }
+      return -1;
+    }
+
+    now = msNow();
+    for (i = 0;   i < (size_t) n;   ) {
+      struct inotify_event *pE = (struct inotify_event *) (u.buf + i);
+      int                   wd = pE->wd;
+
+      i += sizeof(struct inotify_event) + pE->len;
+
+      if (pE->mask & IN_Q_OVERFLOW) {
+        size_t j;
+
+        for (j = 0;   j < pW->nPaths;   j++) {
+          if (pW->paths[j] != 0) {
+            markDirty(pW, j, now + pW->settle);
+          }
+        }
+        continue;
+      }
+
+      if (wd < 0 || (size_t) wd >= pW->nPaths || pW->paths[wd] == 0) {
+        continue;
+      }
+
+      if (pE->mask & IN_IGNORED) {
+        free(pW->paths[wd]);
+        pW->paths[wd] = 0;
+        pW->due[wd]   = 0;
+
+      } else if (pE->mask & IN_ISDIR) {
+        if (pW->recursive && (pE->mask & (IN_CREATE | IN_MOVED_TO))) {
+          char *sub = joinPath(pW->paths[wd], pE->name);
+
+          if (sub != 0) {
+            addTree(pW, sub, 1);
+            free(sub);
+          }
+        }
+
+      } else if ((pE->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) &&
+                 (pW->name == 0 ||
+                  pW->name(pW->arg, pE->name, strlen(pE->name)))) {
+        markDirty(pW, wd, now + pW->settle);
+      }
+    }
+  }
+}
+
+void watchClose(
+  Watch *pW
+){
+  size_t i;
+
+  if (pW == 0) {
+    return;
+  }
+  close(pW->fd);
+  for (i = 0;   i < pW->nPaths;   i++) {
+    free(pW->paths[i]);
+  }
+  free(pW->paths);
+  free(pW->due);
+  free(pW->dirty);
+  free(pW);
+}
+
+static void markDirty(
+  Watch *pW,
+  int    wd,
+  long   due
+){
+
+  /**
+   | The directory "wd" is to be cleaned at "due", unless it changes
+   | again in the meantime.
+  **/
+
+  if (pW->due[wd] == 0) {
+    if (pW->nDirty == pW->mDirty) {
+      size_t  m = pW->mDirty == 0 ? 64 : 2 * pW->mDirty;
+      int    *p = realloc(pW->dirty, m * sizeof(int));
+
+      if (p == 0) {
+        return;
+      }
+      pW->dirty  = p;
+      pW->mDirty = m;
+    }
+    pW->dirty[pW->nDirty++] = wd;
+  }
+  pW->due[wd] = due;
+}
+
+static long msNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000 + 1;
+}
+
+static char *joinPath(
+  const char *dir,
+  const char *name
+){
+
+  /**
+   | Returns, in a buffer obtained from malloc(), "dir/name" (or a
+   | copy of "dir", if "name" is 0); 0 if out of memory.
+  **/
+
+  size_t  lDir = strlen(dir), lName = name != 0 ? strlen(name) : 0;
+  char   *p;
+
+  if ((p = malloc(lDir + lName + 2)) == 0) {
+    return 0;
+  }
+  memcpy(p, dir, lDir + 1);
+  if (name != 0) {
+    p[lDir] = '/';
+    memcpy(p + lDir + 1, name, lName + 1);
+  }
+  return p;
+}
+
+#else  /* !__linux__ || NO_INOTIFY */
+
+Watch *watchOpen(
+  unsigned long  settle,
+  int            recursive,
+  WatchName     *name,
+  WatchDir      *dir,
+  void          *arg
+){
+  (void) settle;   (void) recursive;   (void) name;
+  (void) dir;      (void) arg;
+
+  errno = ENOSYS;
+  return 0;
+}
+
+int watchAdd(
+  Watch      *pW,
+  const char *path
+){
+  (void) pW;   (void) path;
+
+  errno = ENOSYS;
+  return -1;
+}
+
+int watchRun(
+  Watch *pW
+){
+  (void) pW;
+
+  errno = ENOSYS;
+  return -1;
+}
+
+void watchClose(
+  Watch *pW
+){
+  (void) pW;
+}
+
+#endif /* __linux__ && !NO_INOTIFY */
@@ -0,0 +1,45 @@
+/*
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Watch mode.  The target directories (and, recursively, their
+  subdirectories) are watched through inotify(7): when a file is
+  written and closed, or moved in, the directory is marked dirty; once
+  it has been quiet for a while (so that a running latexmk, or the like,
+  has finished its work) a callback is asked to clean it.  The
+  directories created later are watched too, and cleaned once.
+*/
+
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ | - Watch: the set of watched directories;
+ | - WatchName: tells whether a change to the file "name" (of the given
+ |   length) may need a cleanup: the others are ignored;
+ | - WatchDir: cleans the directory "path", that has been quiet for the
+ |   required time.
+ | Both receive the pointer given to watchOpen().
+**/
+
+typedef struct sWatch Watch;
+
+typedef int  WatchName(void *, const char *, unsigned long);
+typedef void WatchDir(void *, const char *);
+
+Watch *watchOpen(unsigned long, int, WatchName *, WatchDir *, void *);
+int    watchAdd(Watch *, const char *);
+int    watchRun(Watch *);
+void   watchClose(Watch *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WATCH_H_ */